@@ -60,7 +60,8 @@ public:
                 const sv_fit_ana::FitResults fit_results(event.SVfit_is_valid.at(n),
                                                          LorentzVectorM(event.SVfit_p4.at(n)),
                                                          LorentzVectorM(event.SVfit_p4_error.at(n)),
-                                                         event.SVfit_mt.at(n), event.SVfit_mt_error.at(n));
+                                                         event.SVfit_mt.at(n), event.SVfit_mt_error.at(n),
+                                                         GetSVfitMode(event, n));
                 AddSVfitResults(event.SVfit_htt_index.at(n),
                                 static_cast<UncertaintySource>(event.SVfit_unc_source.at(n)),
                                 static_cast<UncertaintyScale>(event.SVfit_unc_scale.at(n)), fit_results);
@@ -105,6 +106,7 @@ public:
             event.SVfit_mt_error.clear();
             event.SVfit_unc_source.clear();
             event.SVfit_unc_scale.clear();
+            event.SVfit_mode.clear();
             for(const auto& [key, result] : SVFit_map){
                 event.SVfit_htt_index.push_back(static_cast<UInt_t>(key.htt_index));
                 event.SVfit_is_valid.push_back(result.has_valid_momentum);
@@ -114,6 +116,7 @@ public:
                 event.SVfit_mt_error.push_back(static_cast<Float_t>(result.transverseMass_error));
                 event.SVfit_unc_source.push_back(static_cast<Int_t>(key.unc_source));
                 event.SVfit_unc_scale.push_back(static_cast<Int_t>(key.unc_scale));
+                event.SVfit_mode.push_back(static_cast<Int_t>(result.mode));
             }
         }
 
@@ -160,6 +163,18 @@ public:
                                                       UncertaintyScale unc_scale) const;
     boost::optional<float> TryGetHHbtag(size_t htt_index, size_t jet_index, UncertaintySource unc_source,
                                         UncertaintyScale unc_scale) const;
+    // HH-btag scores of all jets for the given H->tautau candidate and variation, indexed by the jet index.
+    std::map<size_t, float> GetHHbtagResults(size_t htt_index, UncertaintySource unc_source,
+                                             UncertaintyScale unc_scale) const;
+
+private:
+    // Caches produced before the SVfit mode was stored contain only the classic SVfit results.
+    template<typename Event>
+    static sv_fit_ana::SVfitMode GetSVfitMode(const Event& event, size_t n)
+    {
+        if(n >= event.SVfit_mode.size()) return sv_fit_ana::SVfitMode::Classic;
+        return static_cast<sv_fit_ana::SVfitMode>(event.SVfit_mode.at(n));
+    }
 
 private:
     std::map<SVFitKey, sv_fit_ana::FitResults> SVFit_map;
@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include "h-tautau/Core/include/DeltaRMatcher.h"
 #include "h-tautau/Core/include/SummaryTuple.h"
 #include "h-tautau/Core/include/TriggerResults.h"
 #include "h-tautau/JetTools/include/BTagger.h"
@@ -85,7 +86,8 @@ public:
 
     boost::optional<LorentzVector> GetResonanceMomentum(bool useSVfit, bool addMET, bool allow_calc = false);
     double GetHT(bool includeHbbJets, bool includeVBFJets) const;
-    const sv_fit_ana::FitResults& GetSVFitResults(bool allow_calc = false, int verbosity = 0);
+    const sv_fit_ana::FitResults& GetSVFitResults(bool allow_calc = false, int verbosity = 0,
+                                                  const sv_fit_ana::FitSettings& settings = {});
     const kin_fit::FitResults& GetKinFitResults(bool allow_calc = false, int verbosity = 0);
     double GetMT2();
 
@@ -96,10 +98,17 @@ public:
     void SetMvaScore(double _mva_score);
     double GetMvaScore() const;
 
+    // The weights are stored together with the id of their producer, so that the weights set by one producer are
+    // never interpreted using the layout of another one.
+    bool HasWeights(size_t owner_id) const;
+    void SetWeights(size_t owner_id, std::vector<double>&& _weights);
+    const std::vector<double>& GetWeights() const;
+
     bool PassNormalTriggers();
     bool PassVbfTriggers();
 
     boost::optional<size_t> FindGenMatch(const JetCandidate& jet) const;
+    std::vector<boost::optional<size_t>> FindGenMatches(const std::vector<JetCandidate>& jets) const;
 
     [[ noreturn ]] void ThrowException(const std::string& message) const;
 
@@ -119,9 +128,10 @@ public:
 
 private:
     std::vector<std::string> FilterTriggers(const std::vector<std::string>& trigger_names) const;
+    const DeltaRMatcher<ntuple::LorentzVectorE>& GetGenJetMatcher() const;
 
 private:
-    Mutex mutex;
+    mutable Mutex mutex;
     const std::shared_ptr<EventCandidate> event_candidate;
     const SummaryInfoPtr summaryInfo;
     const TriggerResults triggerResults;
@@ -135,8 +145,11 @@ private:
     boost::optional<kin_fit::FitResults> kinfit_results;
     boost::optional<sv_fit_ana::FitResults> svfit_results;
     boost::optional<double> mt2, mva_score;
+    boost::optional<std::vector<double>> weights;
+    size_t weights_owner_id{0};
     boost::optional<std::vector<const JetCandidate*>> central_jets, forward_jets, all_jets;
     boost::optional<bool> pass_triggers, pass_vbf_triggers;
+    mutable std::unique_ptr<DeltaRMatcher<ntuple::LorentzVectorE>> gen_jet_matcher;
 };
 
 } // namespace analysis
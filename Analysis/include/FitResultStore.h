@@ -0,0 +1,105 @@
+/*! Persistent store of the fit results shared between jobs.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace analysis {
+
+// Hash of the exact fit inputs. Two independent 64-bit streams are combined to make accidental collisions negligible.
+class FitInputHash {
+public:
+    struct Key {
+        uint64_t first{0}, second{0};
+        bool operator==(const Key& other) const { return first == other.first && second == other.second; }
+    };
+
+    explicit FitInputHash(uint64_t salt);
+    FitInputHash& Add(double value);
+    FitInputHash& Add(int64_t value);
+    const Key& GetKey() const { return key; }
+
+private:
+    void AddWord(uint64_t word);
+
+private:
+    Key key;
+};
+
+// Key-value store of fit results in a local file that can be shared by several processes on the same machine.
+// The file consists of a header and fixed-size records that are only appended. Appends and compactions hold an
+// exclusive flock on the file, reads hold a shared one, and the records appended by other processes are picked up on
+// a lookup miss. When the file would exceed max_size bytes, it is compacted, keeping the newest records that fit
+// into half of max_size. The compacted store is written into a new file that atomically replaces the original one.
+// The key covers the fit inputs and settings, but not the version of the fit code: a different file should be used
+// after a change of the fit algorithms.
+class FitResultStore {
+public:
+    static constexpr size_t n_values = 12;
+    using Key = FitInputHash::Key;
+    using Values = std::array<double, n_values>;
+
+    struct Stats {
+        size_t n_hits{0}, n_misses{0}, n_stored{0}, n_compactions{0};
+    };
+
+    FitResultStore(const std::string& _file_name, size_t _max_size);
+    FitResultStore(const FitResultStore&) = delete;
+    FitResultStore& operator=(const FitResultStore&) = delete;
+    ~FitResultStore();
+
+    bool TryGet(const Key& key, Values& values);
+    void Put(const Key& key, const Values& values);
+
+    Stats GetStats() const;
+    size_t GetNumberOfRecords() const;
+    void PrintStats(std::ostream& os) const;
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t generation;
+    };
+
+    struct Record {
+        Key key;
+        Values values;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.first ^ key.second); }
+    };
+
+    class FileLock;
+
+    Header ReadHeader() const;
+    void WriteHeader(const Header& header);
+    size_t GetFileSize() const;
+    // Reopens the store if the file was replaced by a compaction in another process. Returns true if reopened.
+    bool ReopenIfReplaced();
+    // Loads the records that were added to the file since the last refresh. Should be called under the file lock.
+    void Refresh();
+    // Keeps the newest records within half of max_size. Should be called under the exclusive file lock, which is
+    // moved to the new file.
+    void Compact();
+
+private:
+    const std::string file_name;
+    const size_t max_size;
+    int fd;
+    uint64_t generation;
+    size_t n_loaded_records;
+    std::unordered_map<Key, Values, KeyHash> index;
+    Stats stats;
+    mutable std::mutex mutex;
+};
+
+} // namespace analysis
@@ -3,6 +3,9 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <mutex>
 #include <set>
 #include "h-tautau/Core/include/EventTuple.h"
 #include "h-tautau/Analysis/include/GenStatusFlags.h"
@@ -17,7 +20,6 @@ class GenParticle;
 using GenParticleVector = std::vector<GenParticle>;
 using GenParticleSet = std::set<const GenParticle*>;
 using GenParticlePtrVector = std::vector<const GenParticle*>;
-using ParticleCodeMap = std::map<int,GenParticleSet>;
 
 class GenParticle {
 public:
@@ -26,26 +28,74 @@ public:
     int status;
     GenStatusFlags genStatusFlags;
     LorentzVectorM momentum;
-    GenParticlePtrVector mothers;
-    GenParticlePtrVector daughters;
+    // Mothers and daughters are stored by GenEvent, see GenEvent::GetMothers and GenEvent::GetDaughters.
     Point3D vertex;
 
 public:
     GenParticle(const ntuple::Event& events, size_t n);
 };
 
+// Contiguous range of particle indices inside one of the GenEvent index arrays.
+class GenIndexRange {
+public:
+    GenIndexRange(const size_t* _begin, const size_t* _end) : begin_(_begin), end_(_end) {}
+
+    const size_t* begin() const { return begin_; }
+    const size_t* end() const { return end_; }
+    size_t size() const { return static_cast<size_t>(end_ - begin_); }
+    bool empty() const { return begin_ == end_; }
+    size_t at(size_t n) const
+    {
+        if(n >= size())
+            throw exception("GenIndexRange: index is out of range.");
+        return begin_[n];
+    }
+
+private:
+    const size_t* begin_;
+    const size_t* end_;
+};
+
 class GenEvent {
 private:
     GenParticleVector genParticles;
-    ParticleCodeMap particleCodeMap;
-    GenParticleSet primaryParticles;
+    // Compressed sparse row adjacency: mothers of the particle i are
+    // mother_indices[mother_offsets[i]] ... mother_indices[mother_offsets[i + 1] - 1], the same for daughters.
+    std::vector<size_t> mother_offsets, mother_indices, daughter_offsets, daughter_indices;
+    // Indices of the prompt particles sorted by (|pdg|, index) and the corresponding |pdg| values.
+    std::vector<size_t> prompt_indices;
+    std::vector<int> prompt_pdgs;
+    std::vector<size_t> primary_indices;
+    // Ancestors of each particle as a bitset of n_ancestor_words 64-bit words per particle. They are computed once,
+    // at the first parentage or final-state query, and are not modified afterwards.
+    mutable std::once_flag ancestors_flag;
+    mutable size_t n_ancestor_words{0};
+    mutable std::vector<uint64_t> ancestor_bits;
+    // Final-state descendants of a particle sorted by index and their summed momenta for each combination of the
+    // GetFinalStateMomentum flags. They are computed at the first final-state query for the given particle and
+    // never modified afterwards, so the references returned by GetFinalState stay valid.
+    struct FinalState {
+        std::vector<size_t> indices;
+        std::array<LorentzVectorM, 4> p4;
+    };
+    mutable std::mutex final_state_mutex;
+    mutable std::vector<std::unique_ptr<const FinalState>> final_states;
 
 public:
     GenEvent(const ntuple::Event& event);
+    GenEvent(const GenEvent&) = delete;
+    GenEvent& operator=(const GenEvent&) = delete;
+
+    const GenParticleVector& GetGenParticles() const;
+    GenIndexRange GetMothers(size_t index) const;
+    GenIndexRange GetDaughters(size_t index) const;
 
     GenParticleSet GetParticles(int particle_pgd, bool requireIsLastCopy) const;
+    // Same as GetParticles, but without building a set. The particles are ordered by index.
+    GenParticlePtrVector FindParticles(int particle_pgd, bool requireIsLastCopy) const;
 
-    void GetChosenParticlesTypes(const std::set<particles::ParticleType>& type_names, const GenParticle* mother, GenParticleSet& result) const;
+    void GetChosenParticlesTypes(const std::set<particles::ParticleType>& type_names, const GenParticle* mother,
+                                 GenParticleSet& result) const;
 
     bool areParented(const GenParticle* daughter, const GenParticle* mother) const;
 
@@ -58,13 +108,18 @@ public:
     void Print() const;
 
     void FindFinalStateDaughters(const GenParticle& particle, std::set<const GenParticle*>& daughters,
-                                 const std::set<int>& pdg_to_exclude);
+                                 const std::set<int>& pdg_to_exclude) const;
     LorentzVectorM GetFinalStateMomentum(const GenParticle& particle, std::vector<const GenParticle*>& visible_daughters,
-                                       bool excludeInvisible, bool excludeLightLeptons);
+                                       bool excludeInvisible, bool excludeLightLeptons) const;
 
     static int GetParticleCharge(int pdg);
     static particles::ParticleType GetParticleType(int pdg);
 
+private:
+    void BuildAncestors() const;
+    bool IsAncestor(size_t ancestor, size_t index) const;
+    const FinalState& GetFinalState(size_t index) const;
+
 private:
     static const std::unique_ptr<std::map<int, std::string>> particle_names;
     static const std::unique_ptr<std::map<int, particles::ParticleType>> particle_types;
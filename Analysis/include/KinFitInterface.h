@@ -3,7 +3,9 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <memory>
 #include "AnalysisTools/Core/include/AnalysisMath.h"
+#include "h-tautau/Analysis/include/FitResultStore.h"
 
 namespace analysis {
 
@@ -14,11 +16,27 @@ struct FitResults {
     int convergence;
     bool HasValidMass() const { return convergence > 0; }
 
-    FitResults() : convergence(std::numeric_limits<int>::lowest()) {}
+    // The mass, chi2 and probability are zero if the fit has not converged, as in the fit result store.
+    FitResults() : mass(0), chi2(0), probability(0), convergence(std::numeric_limits<int>::lowest()) {}
     FitResults(double _mass, double _chi2, double _probability, int _convergence) :
         mass(_mass), chi2(_chi2), probability(_probability), convergence(_convergence) {}
 };
 
+struct FitInput {
+    TLorentzVector lepton1_p4, lepton2_p4, jet1_p4, jet2_p4;
+    TVector2 met;
+    TMatrixD met_cov;
+    double resolution_1, resolution_2;
+
+    template<typename LVector1, typename LVector2, typename LVector3, typename LVector4, typename Met>
+    FitInput(const LVector1& _lepton1_p4, const LVector2& _lepton2_p4, const LVector3& _jet1_p4,
+             const LVector4& _jet2_p4, const Met& _met, double _resolution_1, double _resolution_2) :
+        lepton1_p4(ConvertVector(_lepton1_p4)), lepton2_p4(ConvertVector(_lepton2_p4)),
+        jet1_p4(ConvertVector(_jet1_p4)), jet2_p4(ConvertVector(_jet2_p4)),
+        met(_met.GetMomentum().Px(), _met.GetMomentum().Py()), met_cov(ConvertMatrix(_met.GetCovMatrix())),
+        resolution_1(_resolution_1), resolution_2(_resolution_2) {}
+};
+
 class FitProducer {
 public:
     template<typename LVector1, typename LVector2, typename LVector3, typename LVector4, typename Met>
@@ -26,17 +44,13 @@ public:
                           const LVector3& jet1_p4, const LVector4& jet2_p4, const Met& met,
                           double resolution_1, double resolution_2, int verbosity = 0)
     {
-        const auto& met_p4 = met.GetMomentum();
-        const TMatrixD& met_cov = ConvertMatrix(met.GetCovMatrix());
-        return FitImpl(ConvertVector(lepton1_p4), ConvertVector(lepton2_p4), ConvertVector(jet1_p4),
-                       ConvertVector(jet2_p4), TVector2(met_p4.Px(), met_p4.Py()), met_cov,
-                       resolution_1, resolution_2, verbosity);
+        return Fit(FitInput(lepton1_p4, lepton2_p4, jet1_p4, jet2_p4, met, resolution_1, resolution_2), verbosity);
     }
 
-private:
-    static FitResults FitImpl(const TLorentzVector& lepton1_p4, const TLorentzVector& lepton2_p4,
-                              const TLorentzVector& jet1_p4, const TLorentzVector& jet2_p4, const TVector2& met,
-                              const TMatrixD& met_cov, double resolution_1, double resolution_2, int verbosity);
+    static FitResults Fit(const FitInput& input, int verbosity = 0);
+
+    // If set, the results are taken from the store when available, and the new results are added to it.
+    static void SetResultStore(const std::shared_ptr<FitResultStore>& store);
 };
 
 } // namespace kin_fit
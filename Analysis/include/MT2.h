@@ -3,13 +3,13 @@ This file is part of https://github.com/hh-italian-group/hh-bbtautau. */
 
 #pragma once
 
+#include <vector>
 #include "h-tautau/Instruments/include/Lester_mt2_bisect.h"
 
 namespace  analysis {
 template<typename LVector1, typename LVector2, typename LVector3, typename LVector4, typename LVector5 >
 double Calculate_MT2_old(const LVector1& lepton1_p4, const LVector2& lepton2_p4, const LVector3& bjet_1, const LVector4& bjet_2, const LVector5& met_p4)
 {
-    asymm_mt2_lester_bisect::disableCopyrightMessage();
     const auto sideA = lepton1_p4 + bjet_1;
     const auto sideB = lepton2_p4 + bjet_2;
     const double mVisA = sideA.mass();
@@ -29,21 +29,44 @@ double Calculate_MT2_old(const LVector1& lepton1_p4, const LVector2& lepton2_p4,
 
 //implementation as LLR and as article
 namespace  analysis {
+
+// Inputs of asymm_mt2_lester_bisect::get_mT2 for a single event.
+struct MT2Input {
+    double mVisA, pxA, pyA, mVisB, pxB, pyB, pxMiss, pyMiss, chiA, chiB;
+};
+
+template<typename LVector1, typename LVector2, typename LVector3, typename LVector4, typename LVector5 >
+MT2Input MakeMT2Input(const LVector1& lepton1_p4, const LVector2& lepton2_p4, const LVector3& bjet_1, const LVector4& bjet_2, const LVector5& met_p4)
+{
+    MT2Input input;
+    input.mVisA = bjet_1.mass();
+    input.pxA = bjet_1.px();
+    input.pyA = bjet_1.py();
+    input.mVisB = bjet_2.mass();
+    input.pxB = bjet_2.px();
+    input.pyB = bjet_2.py();
+    input.pxMiss = lepton1_p4.px() + lepton2_p4.px() + met_p4.px();
+    input.pyMiss = lepton1_p4.py() + lepton2_p4.py() + met_p4.py();
+    input.chiA = lepton1_p4.mass(); // hypothesised mass of invisible on side A.  Must be >=0.
+    input.chiB = lepton2_p4.mass(); // hypothesised mass of invisible on side B.  Must be >=0.
+    return input;
+}
+
+inline double Calculate_MT2(const MT2Input& input)
+{
+    return asymm_mt2_lester_bisect::get_mT2(input.mVisA, input.pxA, input.pyA, input.mVisB, input.pxB, input.pyB,
+                                            input.pxMiss, input.pyMiss, input.chiA, input.chiB, 0);
+}
+
 template<typename LVector1, typename LVector2, typename LVector3, typename LVector4, typename LVector5 >
 double Calculate_MT2(const LVector1& lepton1_p4, const LVector2& lepton2_p4, const LVector3& bjet_1, const LVector4& bjet_2, const LVector5& met_p4)
 {
-    asymm_mt2_lester_bisect::disableCopyrightMessage();
-    const double mVisA = bjet_1.mass();
-    const double pxA = bjet_1.px();
-    const double pyA = bjet_1.py();
-    const double mVisB = bjet_2.mass();
-    const double pxB = bjet_2.px();
-    const double pyB = bjet_2.py();
-    const double pxMiss = lepton1_p4.px() + lepton2_p4.px() + met_p4.px();
-    const double pyMiss = lepton1_p4.py() + lepton2_p4.py() + met_p4.py();
-    double chiA = lepton1_p4.mass(); // hypothesised mass of invisible on side A.  Must be >=0.
-    double chiB = lepton2_p4.mass(); // hypothesised mass of invisible on side B.  Must be >=0.
-    double MT2 =  asymm_mt2_lester_bisect::get_mT2(mVisA, pxA, pyA,mVisB, pxB, pyB,pxMiss, pyMiss,chiA, chiB,0);
-    return MT2;
+    return Calculate_MT2(MakeMT2Input(lepton1_p4, lepton2_p4, bjet_1, bjet_2, met_p4));
 }
+
+// Batched version of Calculate_MT2. The bisection of asymm_mt2_lester_bisect::get_mT2 is performed for several
+// events in lockstep: each lane of a fixed-size block holds one event, all lanes evaluate the ellipse disjointness
+// test in a single branch-free loop, and a lane that has converged is immediately refilled with the next event.
+// The per-lane arithmetic repeats the scalar algorithm step by step, so the results agree with Calculate_MT2.
+std::vector<double> Calculate_MT2_Batch(const std::vector<MT2Input>& inputs, double desiredPrecisionOnMT2 = 0);
 }
@@ -3,6 +3,8 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <memory>
+#include "h-tautau/Analysis/include/FitResultStore.h"
 #include "h-tautau/Core/include/Candidate.h"
 #include "h-tautau/Core/include/TupleObjects.h"
 #include "AnalysisTools/Core/include/RootExt.h"
@@ -10,20 +12,37 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 namespace analysis {
 namespace sv_fit_ana {
 
+// Classic: full ClassicSVfit integration with a fixed budget of integrand evaluations.
+// FastMTT: FastMTT approximation. It does not provide uncertainties, so all errors are set to 0.
+// Adaptive: ClassicSVfit integration with an evaluation budget that is doubled until the mass and its uncertainty
+//           are stable within the given tolerance.
+enum class SVfitMode { Classic = 0, FastMTT = 1, Adaptive = 2 };
+ENUM_NAMES(SVfitMode) = {
+    { SVfitMode::Classic, "Classic" }, { SVfitMode::FastMTT, "FastMTT" }, { SVfitMode::Adaptive, "Adaptive" }
+};
+
+struct FitSettings {
+    SVfitMode mode{SVfitMode::Classic};
+    int max_evaluations{100000};
+    double adaptive_tolerance{0.01};
+    int adaptive_min_evaluations{10000};
+};
+
 struct FitResults {
     bool has_valid_momentum;
     LorentzVectorM momentum;
     LorentzVectorM momentum_error;
     double transverseMass;
     double transverseMass_error;
+    SVfitMode mode;
 
     FitResults() :
         has_valid_momentum(false), transverseMass(std::numeric_limits<double>::lowest()),
-        transverseMass_error(std::numeric_limits<double>::lowest()) {}
+        transverseMass_error(std::numeric_limits<double>::lowest()), mode(SVfitMode::Classic) {}
     FitResults(bool _has_valid_momentum, LorentzVectorM _momentum, LorentzVectorM _momentum_error,
-               double _transverseMass, double _transverseMass_error) :
+               double _transverseMass, double _transverseMass_error, SVfitMode _mode = SVfitMode::Classic) :
         has_valid_momentum(_has_valid_momentum), momentum(_momentum), momentum_error(_momentum_error),
-        transverseMass(_transverseMass), transverseMass_error(_transverseMass_error) {}
+        transverseMass(_transverseMass), transverseMass_error(_transverseMass_error), mode(_mode) {}
 };
 
 class FitProducer {
@@ -31,6 +50,12 @@ public:
     static FitResults Fit(const LeptonCandidate<ntuple::TupleLepton>& first_daughter,
                           const LeptonCandidate<ntuple::TupleLepton>& second_daughter,
                           const MissingET<ntuple::TupleMet>& met, int verbosity = 0);
+    static FitResults Fit(const LeptonCandidate<ntuple::TupleLepton>& first_daughter,
+                          const LeptonCandidate<ntuple::TupleLepton>& second_daughter,
+                          const MissingET<ntuple::TupleMet>& met, const FitSettings& settings, int verbosity = 0);
+
+    // If set, the results are taken from the store when available, and the new results are added to it.
+    static void SetResultStore(const std::shared_ptr<FitResultStore>& store);
 };
 
 } // namespace sv_fit_ana
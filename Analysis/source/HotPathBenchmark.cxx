@@ -0,0 +1,317 @@
+/*! Measure the throughput of the analysis hot paths on the events of a tuple.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Analysis/include/EventInfo.h"
+#include "h-tautau/McCorrections/include/EventWeights.h"
+
+struct Arguments {
+    REQ_ARG(std::string, input_file);
+    OPT_ARG(std::string, channels, "eTau,muTau,tauTau");
+    OPT_ARG(analysis::SignalMode, selection, analysis::SignalMode::HH);
+    OPT_ARG(analysis::BTaggerKind, btagger, analysis::BTaggerKind::DeepFlavour);
+    OPT_ARG(analysis::DiscriminatorWP, btag_wp, analysis::DiscriminatorWP::Medium);
+    OPT_ARG(Long64_t, max_events, 10000);
+    OPT_ARG(size_t, n_repetitions, 3);
+    OPT_ARG(size_t, n_fit_events, 50);
+    // If empty, a built-in set of trigger descriptors is used.
+    OPT_ARG(std::string, trigger_cfg, "");
+    // Weight providers that do not need external inputs by default.
+    OPT_ARG(std::string, weights, "TopPt,GenEventWeight");
+    // Number of threads used to construct the weight providers before the event loop.
+    OPT_ARG(size_t, n_load_threads, 1);
+    // Path with the TauPOG inputs, required to build the candidates of the MC events.
+    OPT_ARG(std::string, working_path, "");
+    OPT_ARG(std::string, output, "");
+};
+
+namespace analysis {
+
+enum class BenchmarkStage { Candidate, HiggsCandidate, SignalJets, EventInfo, TriggerMatch, EventWeights, SVfit,
+                            KinFit };
+ENUM_NAMES(BenchmarkStage) = {
+    { BenchmarkStage::Candidate, "Candidate" }, { BenchmarkStage::HiggsCandidate, "HiggsCandidate" },
+    { BenchmarkStage::SignalJets, "SignalJets" }, { BenchmarkStage::EventInfo, "EventInfo" },
+    { BenchmarkStage::TriggerMatch, "TriggerMatch" }, { BenchmarkStage::EventWeights, "EventWeights" },
+    { BenchmarkStage::SVfit, "SVfit" }, { BenchmarkStage::KinFit, "KinFit" },
+};
+
+// Each stage is timed on the output of the previous stages, so the measurements do not overlap. The inputs are
+// loaded in memory beforehand, and the best of n_repetitions runs is reported to reduce the noise.
+// Besides the timing, the number of accepted events is reported for each stage to detect changes of the results.
+class HotPathBenchmark {
+public:
+    using clock = std::chrono::steady_clock;
+    using Stage = BenchmarkStage;
+
+    struct Measurement {
+        Channel channel;
+        Stage stage;
+        size_t n_calls{0}, n_accepted{0};
+        double time{std::numeric_limits<double>::infinity()};
+    };
+
+    HotPathBenchmark(const Arguments& _args) :
+        args(_args), channels(SplitValueListT<Channel>(args.channels(), false, ",")),
+        weighting_mode(ParseWeightingMode(args.weights())), signalObjectSelector(args.selection())
+    {
+        if(!args.n_repetitions())
+            throw exception("Number of repetitions should be positive.");
+    }
+
+    void Run()
+    {
+        auto file = root_ext::OpenRootFile(args.input_file());
+        std::vector<Measurement> measurements;
+        for(Channel channel : channels) {
+            std::shared_ptr<ntuple::EventTuple> tuple;
+            try {
+                tuple = ntuple::CreateEventTuple(ToString(channel), file.get(), true, ntuple::TreeState::Full);
+            } catch(std::runtime_error&) {
+                std::cout << "Channel: " << channel << " not found." << std::endl;
+                continue;
+            }
+            const auto events = LoadEvents(*tuple);
+            if(events.empty()) continue;
+            Initialize(events.front());
+            const auto channel_measurements = Process(channel, events);
+            measurements.insert(measurements.end(), channel_measurements.begin(), channel_measurements.end());
+        }
+        Print(std::cout, measurements, " ");
+        if(!args.output().empty()) {
+            std::ofstream output(args.output());
+            if(output.fail())
+                throw exception("Unable to create output file '%1%'.") % args.output();
+            Print(output, measurements, ",");
+        }
+    }
+
+private:
+    std::vector<ntuple::Event> LoadEvents(ntuple::EventTuple& tuple) const
+    {
+        const Long64_t n_entries = std::min(tuple.GetEntries(), args.max_events());
+        std::vector<ntuple::Event> events(static_cast<size_t>(n_entries));
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            tuple.GetEntry(entry);
+            events.at(static_cast<size_t>(entry)) = tuple.data();
+        }
+        return events;
+    }
+
+    // The period specific tools are created from the first loaded event.
+    void Initialize(const ntuple::Event& event)
+    {
+        const Period event_period = static_cast<Period>(event.period);
+        if(period && *period != event_period)
+            throw exception("Input events with different periods: %1% and %2%.") % *period % event_period;
+        if(period) return;
+        period = event_period;
+        bTagger = std::make_unique<BTagger>(*period, args.btagger());
+        if(!weighting_mode.empty()) {
+            eventWeights = std::make_unique<mc_corrections::EventWeights>(*period, *bTagger, weighting_mode);
+            // The providers are loaded beforehand, so the EventWeights stage measures only the weight evaluation.
+            eventWeights->LoadProviders(weighting_mode, args.n_load_threads());
+            eventWeights->PrintLoadTimes(std::cout);
+        }
+        if(!args.working_path().empty())
+            EventCandidate::InitializeUncertainties(*period, false, args.working_path(),
+                                                    TauIdDiscriminator::byDeepTau2017v2p1VSjet);
+        else if(!event.isData)
+            throw exception("The working path with the TauPOG inputs is required to process MC events.");
+    }
+
+    std::vector<Measurement> Process(Channel channel, const std::vector<ntuple::Event>& events)
+    {
+        const auto triggerDescriptors = GetTriggerDescriptors(channel);
+        std::vector<Measurement> measurements;
+        const auto measure = [&](Stage stage, auto&& fn) {
+            Measurement m;
+            m.channel = channel;
+            m.stage = stage;
+            for(size_t rep = 0; rep < args.n_repetitions(); ++rep) {
+                size_t n_calls = 0, n_accepted = 0;
+                const auto start = clock::now();
+                fn(n_calls, n_accepted);
+                m.time = std::min(m.time, std::chrono::duration<double>(clock::now() - start).count());
+                m.n_calls = n_calls;
+                m.n_accepted = n_accepted;
+            }
+            measurements.push_back(m);
+        };
+
+        std::vector<std::shared_ptr<EventCandidate>> candidates(events.size());
+        measure(Stage::Candidate, [&](size_t& n_calls, size_t& n_accepted) {
+            for(size_t n = 0; n < events.size(); ++n) {
+                candidates.at(n) = std::make_shared<EventCandidate>(events.at(n), UncertaintySource::None,
+                                                                    UncertaintyScale::Central);
+                ++n_calls;
+                n_accepted += SignalObjectSelector::PassLeptonVetoSelection(events.at(n))
+                        && SignalObjectSelector::PassMETfilters(events.at(n), *period, events.at(n).isData);
+            }
+        });
+
+        std::vector<boost::optional<size_t>> htt_indices(events.size());
+        measure(Stage::HiggsCandidate, [&](size_t& n_calls, size_t& n_accepted) {
+            for(size_t n = 0; n < events.size(); ++n) {
+                htt_indices.at(n) = signalObjectSelector.GetHiggsCandidateIndex(*candidates.at(n));
+                ++n_calls;
+                n_accepted += htt_indices.at(n).is_initialized();
+            }
+        });
+
+        std::vector<SignalObjectSelector::SelectedSignalJets> signal_jets(events.size());
+        measure(Stage::SignalJets, [&](size_t& n_calls, size_t& n_accepted) {
+            for(size_t n = 0; n < events.size(); ++n) {
+                if(!htt_indices.at(n)) continue;
+                signal_jets.at(n) = SignalObjectSelector::SelectSignalJets(*candidates.at(n), *htt_indices.at(n),
+                                                                           *bTagger, args.btag_wp());
+                ++n_calls;
+                n_accepted += signal_jets.at(n).HasBjetPair();
+            }
+        });
+
+        std::vector<std::unique_ptr<EventInfo>> event_infos(events.size());
+        measure(Stage::EventInfo, [&](size_t& n_calls, size_t& n_accepted) {
+            for(size_t n = 0; n < events.size(); ++n) {
+                if(!htt_indices.at(n)) continue;
+                event_infos.at(n) = std::make_unique<EventInfo>(candidates.at(n), EventInfo::SummaryInfoPtr(),
+                                                                *htt_indices.at(n), signal_jets.at(n), *bTagger);
+                ++n_calls;
+                n_accepted += event_infos.at(n)->HasVBFjetPair();
+            }
+        });
+
+        measure(Stage::TriggerMatch, [&](size_t& n_calls, size_t& n_accepted) {
+            for(const auto& event_info : event_infos) {
+                if(!event_info) continue;
+                TriggerResults triggerResults;
+                triggerResults.SetAcceptBits((*event_info)->trigger_accepts);
+                triggerResults.SetMatchBits((*event_info)->trigger_matches.at(event_info->GetHttIndex()));
+                triggerResults.SetDescriptors(triggerDescriptors);
+                std::vector<TriggerResults::JetBitsContainer> jet_matches;
+                if(event_info->HasVBFjetPair())
+                    jet_matches = { event_info->GetVBFJet(1)->triggerFilterMatch(),
+                                    event_info->GetVBFJet(2)->triggerFilterMatch() };
+                ++n_calls;
+                n_accepted += triggerResults.AnyAcceptAndMatchEx(event_info->GetLeg(1).GetMomentum().pt(),
+                                                                 event_info->GetLeg(2).GetMomentum().pt(),
+                                                                 jet_matches);
+            }
+        });
+
+        if(eventWeights) {
+            measure(Stage::EventWeights, [&](size_t& n_calls, size_t& n_accepted) {
+                for(const auto& event_info : event_infos) {
+                    if(!event_info) continue;
+                    ++n_calls;
+                    n_accepted += eventWeights->GetTotalWeight(*event_info, weighting_mode) > 0;
+                }
+            });
+        }
+
+        const auto fit_event_infos = SelectFitEvents(event_infos);
+        measure(Stage::SVfit, [&](size_t& n_calls, size_t& n_accepted) {
+            for(EventInfo* event_info : fit_event_infos) {
+                const auto result = sv_fit_ana::FitProducer::Fit(event_info->GetLeg(1), event_info->GetLeg(2),
+                                                                 event_info->GetMET());
+                ++n_calls;
+                n_accepted += result.has_valid_momentum;
+            }
+        });
+
+        measure(Stage::KinFit, [&](size_t& n_calls, size_t& n_accepted) {
+            for(EventInfo* event_info : fit_event_infos) {
+                if(!event_info->HasBjetPair()) continue;
+                const JetCandidate& b1 = event_info->GetBJet(1);
+                const JetCandidate& b2 = event_info->GetBJet(2);
+                const auto result = kin_fit::FitProducer::Fit(event_info->GetLeg(1).GetMomentum(),
+                                                              event_info->GetLeg(2).GetMomentum(), b1.GetMomentum(),
+                                                              b2.GetMomentum(), event_info->GetMET(),
+                                                              b1->resolution() * b1.GetMomentum().E(),
+                                                              b2->resolution() * b2.GetMomentum().E());
+                ++n_calls;
+                n_accepted += result.HasValidMass();
+            }
+        });
+
+        return measurements;
+    }
+
+    std::vector<EventInfo*> SelectFitEvents(const std::vector<std::unique_ptr<EventInfo>>& event_infos) const
+    {
+        std::vector<EventInfo*> selected;
+        for(const auto& event_info : event_infos) {
+            if(selected.size() >= args.n_fit_events()) break;
+            if(event_info)
+                selected.push_back(event_info.get());
+        }
+        return selected;
+    }
+
+    std::shared_ptr<const TriggerDescriptorCollection> GetTriggerDescriptors(Channel channel) const
+    {
+        if(!args.trigger_cfg().empty())
+            return TriggerDescriptorCollection::Load(args.trigger_cfg(), channel);
+
+        using Leg = TriggerDescriptorCollection::Leg;
+        using FilterVector = TriggerDescriptorCollection::FilterVector;
+        const auto make_leg = [](LegType type, double pt, double delta_pt, const FilterVector& filters = {}) {
+            return Leg(type, pt, delta_pt, boost::optional<double>(), boost::optional<unsigned>(), false, filters,
+                       boost::optional<FilterVector>());
+        };
+        const boost::optional<unsigned> no_run;
+        auto descriptors = std::make_shared<TriggerDescriptorCollection>();
+        descriptors->Add("HLT_Ele32_WPTight_Gsf_v", { make_leg(LegType::e, 32, 1) }, true, true, no_run, no_run);
+        descriptors->Add("HLT_IsoMu24_v", { make_leg(LegType::mu, 24, 1) }, true, true, no_run, no_run);
+        descriptors->Add("HLT_IsoMu20_LooseChargedIsoPFTauHPS27_eta2p1_CrossL1_v",
+                         { make_leg(LegType::mu, 20, 1), make_leg(LegType::tau, 27, 5) }, true, true, no_run, no_run);
+        descriptors->Add("HLT_DoubleMediumChargedIsoPFTauHPS35_Trk1_eta2p1_Reg_v",
+                         { make_leg(LegType::tau, 35, 5), make_leg(LegType::tau, 35, 5) }, true, true, no_run,
+                         no_run);
+        const FilterVector vbf_jet_1_filters = { "hltMatchedVBFOnePFJet2CrossCleanedUsingDiJetCorrChecker" };
+        const FilterVector vbf_jet_2_filters = { "hltMatchedVBFTwoPFJets2CrossCleanedUsingDiJetCorrChecker" };
+        descriptors->Add("HLT_VBF_DoubleLooseChargedIsoPFTauHPS20_Trk1_eta2p1_v",
+                         { make_leg(LegType::tau, 20, 5), make_leg(LegType::tau, 20, 5),
+                           make_leg(LegType::jet, 115, 0, vbf_jet_1_filters),
+                           make_leg(LegType::jet, 40, 0, vbf_jet_2_filters) }, true, true, no_run, no_run);
+        return descriptors;
+    }
+
+    static mc_corrections::WeightingMode ParseWeightingMode(const std::string& weights)
+    {
+        mc_corrections::WeightingMode mode;
+        for(auto weight_type : SplitValueListT<mc_corrections::WeightType>(weights, false, ","))
+            mode.insert(weight_type);
+        return mode;
+    }
+
+    static void Print(std::ostream& os, const std::vector<Measurement>& measurements, const std::string& sep)
+    {
+        os << "channel" << sep << "stage" << sep << "n_calls" << sep << "n_accepted" << sep << "time_s" << sep
+           << "events_per_s\n";
+        for(const auto& m : measurements) {
+            const double rate = m.time > 0 ? m.n_calls / m.time : 0;
+            os << m.channel << sep << m.stage << sep << m.n_calls << sep << m.n_accepted << sep << std::fixed
+               << std::setprecision(6) << m.time << sep << std::setprecision(1) << rate << "\n";
+            os.unsetf(std::ios_base::floatfield);
+        }
+        os << std::flush;
+    }
+
+private:
+    Arguments args;
+    std::vector<Channel> channels;
+    mc_corrections::WeightingMode weighting_mode;
+    SignalObjectSelector signalObjectSelector;
+    boost::optional<Period> period;
+    std::unique_ptr<BTagger> bTagger;
+    std::unique_ptr<mc_corrections::EventWeights> eventWeights;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::HotPathBenchmark, Arguments)
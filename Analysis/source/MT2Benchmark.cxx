@@ -0,0 +1,89 @@
+/*! Compare throughput and results of the scalar and the batched MT2 calculation.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <chrono>
+#include <random>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/AnalysisMath.h"
+#include "h-tautau/Analysis/include/MT2.h"
+
+struct Arguments {
+    OPT_ARG(size_t, n_events, 1000000);
+    OPT_ARG(unsigned, seed, 12345);
+    OPT_ARG(double, tolerance, 1e-6);
+};
+
+namespace analysis {
+
+class MT2Benchmark {
+public:
+    using clock = std::chrono::steady_clock;
+
+    MT2Benchmark(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        const auto inputs = GenerateInputs();
+
+        const auto scalar_start = clock::now();
+        std::vector<double> scalar_results;
+        scalar_results.reserve(inputs.size());
+        for(const auto& input : inputs)
+            scalar_results.push_back(Calculate_MT2(input));
+        const double scalar_time = std::chrono::duration<double>(clock::now() - scalar_start).count();
+
+        const auto batch_start = clock::now();
+        const auto batch_results = Calculate_MT2_Batch(inputs);
+        const double batch_time = std::chrono::duration<double>(clock::now() - batch_start).count();
+
+        double max_diff = 0;
+        size_t n_different = 0;
+        for(size_t n = 0; n < inputs.size(); ++n) {
+            const double diff = std::abs(scalar_results.at(n) - batch_results.at(n));
+            if(diff == 0) continue;
+            ++n_different;
+            max_diff = std::max(max_diff, diff);
+        }
+
+        std::cout << "n_events = " << inputs.size() << "\n"
+                  << "scalar: " << scalar_time << " s, " << inputs.size() / scalar_time << " events/s\n"
+                  << "batch: " << batch_time << " s, " << inputs.size() / batch_time << " events/s\n"
+                  << "speed up = " << scalar_time / batch_time << "\n"
+                  << "number of different results = " << n_different << ", max difference = " << max_diff
+                  << " GeV" << std::endl;
+        if(max_diff > args.tolerance())
+            throw exception("Batched MT2 differs from the scalar MT2 by %1% GeV.") % max_diff;
+    }
+
+private:
+    // Visible objects with bb-jet like masses and momenta. The invisible masses correspond to the tau legs.
+    std::vector<MT2Input> GenerateInputs() const
+    {
+        std::mt19937_64 gen(args.seed());
+        std::uniform_real_distribution<double> jet_mass(5, 30), lep_mass(0, 2), pt(20, 300), met(0, 200),
+                                               phi(-M_PI, M_PI);
+        std::vector<MT2Input> inputs(args.n_events());
+        for(auto& input : inputs) {
+            const double pt_A = pt(gen), phi_A = phi(gen), pt_B = pt(gen), phi_B = phi(gen);
+            const double pt_miss = met(gen) + pt(gen), phi_miss = phi(gen);
+            input.mVisA = jet_mass(gen);
+            input.pxA = pt_A * std::cos(phi_A);
+            input.pyA = pt_A * std::sin(phi_A);
+            input.mVisB = jet_mass(gen);
+            input.pxB = pt_B * std::cos(phi_B);
+            input.pyB = pt_B * std::sin(phi_B);
+            input.pxMiss = pt_miss * std::cos(phi_miss);
+            input.pyMiss = pt_miss * std::sin(phi_miss);
+            input.chiA = lep_mass(gen);
+            input.chiB = lep_mass(gen);
+        }
+        return inputs;
+    }
+
+private:
+    Arguments args;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::MT2Benchmark, Arguments)
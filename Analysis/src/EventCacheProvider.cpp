@@ -109,6 +109,17 @@ boost::optional<float> EventCacheProvider::TryGetHHbtag(size_t htt_index, size_t
     return result;
 }
 
+std::map<size_t, float> EventCacheProvider::GetHHbtagResults(size_t htt_index, UncertaintySource unc_source,
+                                                             UncertaintyScale unc_scale) const
+{
+    std::map<size_t, float> results;
+    for(const auto& [key, score] : hhBtag_map) {
+        if(key.htt_index == htt_index && key.unc_source == unc_source && key.unc_scale == unc_scale)
+            results[key.jet_index] = score;
+    }
+    return results;
+}
+
 EventCacheSource::EventCacheSource(const std::string& file_name, const std::string& tree_name) :
     file(root_ext::OpenRootFile(file_name)),
     cache(std::make_shared<cache_tuple::CacheTuple>(tree_name, file.get(), true)),
@@ -177,7 +177,8 @@ double EventInfo::GetHT(bool includeHbbJets, bool includeVBFJets) const
     return ht;
 }
 
-const sv_fit_ana::FitResults& EventInfo::GetSVFitResults(bool allow_calc, int verbosity)
+const sv_fit_ana::FitResults& EventInfo::GetSVFitResults(bool allow_calc, int verbosity,
+                                                         const sv_fit_ana::FitSettings& settings)
 {
     Lock lock(mutex);
     if(!svfit_results) {
@@ -187,7 +188,8 @@ const sv_fit_ana::FitResults& EventInfo::GetSVFitResults(bool allow_calc, int ve
         if(!svfit_results) {
             if(!allow_calc)
                 ThrowException("Not allowed to calculate SVFit.");
-            svfit_results = sv_fit_ana::FitProducer::Fit(GetLeg(1), GetLeg(2), event_candidate->GetMET(), verbosity);
+            svfit_results = sv_fit_ana::FitProducer::Fit(GetLeg(1), GetLeg(2), event_candidate->GetMET(), settings,
+                                                         verbosity);
         }
     }
     return *svfit_results;
@@ -209,10 +211,10 @@ const kin_fit::FitResults& EventInfo::GetKinFitResults(bool allow_calc, int verb
                 ThrowException("Not allowed to calculate KinFit.");
             const double energy_resolution_1 = GetBJet(1)->resolution() * GetBJet(1).GetMomentum().E();
             const double energy_resolution_2 = GetBJet(2)->resolution() * GetBJet(2).GetMomentum().E();
-            kinfit_results = kin_fit::FitProducer::Fit(GetLeg(1).GetMomentum(), GetLeg(2).GetMomentum(),
-                                                       GetBJet(1).GetMomentum(), GetBJet(2).GetMomentum(),
-                                                       event_candidate->GetMET(), energy_resolution_1,
-                                                       energy_resolution_2, verbosity);
+            const kin_fit::FitInput fit_input(GetLeg(1).GetMomentum(), GetLeg(2).GetMomentum(),
+                                              GetBJet(1).GetMomentum(), GetBJet(2).GetMomentum(),
+                                              event_candidate->GetMET(), energy_resolution_1, energy_resolution_2);
+            kinfit_results = kin_fit::FitProducer::Fit(fit_input, verbosity);
         }
         kinfit_results->probability = TMath::Prob(kinfit_results->chi2, 2);
     }
@@ -299,6 +301,26 @@ double EventInfo::GetMvaScore() const
     return *mva_score;
 }
 
+bool EventInfo::HasWeights(size_t owner_id) const
+{
+    Lock lock(mutex);
+    return weights.is_initialized() && weights_owner_id == owner_id;
+}
+
+void EventInfo::SetWeights(size_t owner_id, std::vector<double>&& _weights)
+{
+    Lock lock(mutex);
+    weights = std::move(_weights);
+    weights_owner_id = owner_id;
+}
+
+const std::vector<double>& EventInfo::GetWeights() const
+{
+    if(!weights)
+        ThrowException("EventInfo: weights are not set.");
+    return *weights;
+}
+
 bool EventInfo::PassNormalTriggers()
 {
     Lock lock(mutex);
@@ -334,19 +356,23 @@ bool EventInfo::PassVbfTriggers()
 
 boost::optional<size_t> EventInfo::FindGenMatch(const JetCandidate& jet) const
 {
+    return GetGenJetMatcher().FindBestMatch(jet.GetMomentum());
+}
+
+std::vector<boost::optional<size_t>> EventInfo::FindGenMatches(const std::vector<JetCandidate>& jets) const
+{
+    const auto get_p4 = [](const JetCandidate& jet) -> const auto& { return jet.GetMomentum(); };
+    return GetGenJetMatcher().FindBestMatches(jets, get_p4);
+}
 
+const DeltaRMatcher<ntuple::LorentzVectorE>& EventInfo::GetGenJetMatcher() const
+{
     static constexpr double dR_thr = 0.4;
-    boost::optional<size_t> result;
-    double min_dR = dR_thr;
-    const auto& gen_jet_p4 = event_candidate->GetEvent().genJets_p4;
-    for (size_t n = 0; n < gen_jet_p4.size(); ++n) {
-        const double dR = ROOT::Math::VectorUtil::DeltaR(gen_jet_p4.at(n), jet.GetMomentum());
-        if(dR < min_dR) {
-            min_dR = dR;
-            result = n;
-        }
-    }
-    return result;
+    Lock lock(mutex);
+    if(!gen_jet_matcher)
+        gen_jet_matcher = std::make_unique<DeltaRMatcher<ntuple::LorentzVectorE>>(
+                    event_candidate->GetEvent().genJets_p4, dR_thr);
+    return *gen_jet_matcher;
 }
 
 std::vector<std::string> EventInfo::FilterTriggers(const std::vector<std::string>& trigger_names) const
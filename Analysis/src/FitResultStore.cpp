@@ -0,0 +1,265 @@
+/*! Persistent store of the fit results shared between jobs.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Analysis/include/FitResultStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AnalysisTools/Core/include/exception.h"
+
+namespace analysis {
+
+namespace {
+constexpr uint64_t store_magic = 0x4854544649545354ULL; // "HTTFITST"
+constexpr uint32_t store_version = 1;
+
+uint64_t Mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+} // anonymous namespace
+
+FitInputHash::FitInputHash(uint64_t salt)
+{
+    key.first = Mix(salt ^ 0x9E3779B97F4A7C15ULL);
+    key.second = Mix(salt ^ 0xC2B2AE3D27D4EB4FULL);
+}
+
+FitInputHash& FitInputHash::Add(double value)
+{
+    uint64_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    AddWord(word);
+    return *this;
+}
+
+FitInputHash& FitInputHash::Add(int64_t value)
+{
+    AddWord(static_cast<uint64_t>(value));
+    return *this;
+}
+
+void FitInputHash::AddWord(uint64_t word)
+{
+    key.first = Mix(key.first ^ word) + 0x9E3779B97F4A7C15ULL;
+    key.second = Mix(key.second + word * 0xFF51AFD7ED558CCDULL) ^ 0xC4CEB9FE1A85EC53ULL;
+}
+
+// Compact replaces the file with a new one, so after the lock is acquired it is checked that fd still refers to
+// the file with the store name. Otherwise the lock of the replaced file is released, and the new file is opened and
+// locked. The unlock is done on the current fd of the store, which can change while the lock is held.
+class FitResultStore::FileLock {
+public:
+    FileLock(FitResultStore& _store, bool exclusive) : store(_store)
+    {
+        while(true) {
+            while(flock(store.fd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+                if(errno != EINTR)
+                    throw exception("Unable to lock the fit result store: %1%.") % std::strerror(errno);
+            }
+            if(!store.ReopenIfReplaced()) break;
+        }
+    }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    ~FileLock() { flock(store.fd, LOCK_UN); }
+
+private:
+    FitResultStore& store;
+};
+
+FitResultStore::FitResultStore(const std::string& _file_name, size_t _max_size) :
+    file_name(_file_name), max_size(_max_size), fd(-1), generation(0), n_loaded_records(0)
+{
+    if(max_size < sizeof(Header) + 4 * sizeof(Record))
+        throw exception("Fit result store size limit = %1% bytes is too small.") % max_size;
+    fd = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+        throw exception("Unable to open fit result store '%1%': %2%.") % file_name % std::strerror(errno);
+
+    FileLock lock(*this, true);
+    if(GetFileSize() == 0) {
+        WriteHeader(Header{store_magic, store_version, sizeof(Record), 0});
+    } else {
+        const Header header = ReadHeader();
+        if(header.magic != store_magic || header.version != store_version || header.record_size != sizeof(Record))
+            throw exception("'%1%' is not a compatible fit result store.") % file_name;
+    }
+    generation = ReadHeader().generation;
+    Refresh();
+}
+
+FitResultStore::~FitResultStore()
+{
+    if(fd >= 0)
+        close(fd);
+}
+
+bool FitResultStore::TryGet(const Key& key, Values& values)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    auto iter = index.find(key);
+    if(iter == index.end()) {
+        FileLock lock(*this, false);
+        Refresh();
+        iter = index.find(key);
+    }
+    if(iter == index.end()) {
+        ++stats.n_misses;
+        return false;
+    }
+    ++stats.n_hits;
+    values = iter->second;
+    return true;
+}
+
+void FitResultStore::Put(const Key& key, const Values& values)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    FileLock lock(*this, true);
+    Refresh();
+    if(index.count(key)) return;
+    if(sizeof(Header) + (n_loaded_records + 1) * sizeof(Record) > max_size)
+        Compact();
+    const Record record{key, values};
+    const off_t offset = static_cast<off_t>(sizeof(Header) + n_loaded_records * sizeof(Record));
+    if(pwrite(fd, &record, sizeof(Record), offset) != static_cast<ssize_t>(sizeof(Record)))
+        throw exception("Unable to write into fit result store '%1%'.") % file_name;
+    index[key] = values;
+    ++n_loaded_records;
+    ++stats.n_stored;
+}
+
+FitResultStore::Stats FitResultStore::GetStats() const
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return stats;
+}
+
+size_t FitResultStore::GetNumberOfRecords() const
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return index.size();
+}
+
+void FitResultStore::PrintStats(std::ostream& os) const
+{
+    const Stats s = GetStats();
+    const size_t n_lookups = s.n_hits + s.n_misses;
+    const double hit_rate = n_lookups ? static_cast<double>(s.n_hits) / n_lookups : 0.;
+    os << "Fit result store '" << file_name << "': " << GetNumberOfRecords() << " records, " << s.n_hits
+       << " hits, " << s.n_misses << " misses (hit rate = " << hit_rate << "), " << s.n_stored << " stored, "
+       << s.n_compactions << " compactions." << std::endl;
+}
+
+FitResultStore::Header FitResultStore::ReadHeader() const
+{
+    Header header;
+    if(pread(fd, &header, sizeof(Header), 0) != static_cast<ssize_t>(sizeof(Header)))
+        throw exception("Unable to read the header of fit result store '%1%'.") % file_name;
+    return header;
+}
+
+void FitResultStore::WriteHeader(const Header& header)
+{
+    if(pwrite(fd, &header, sizeof(Header), 0) != static_cast<ssize_t>(sizeof(Header)))
+        throw exception("Unable to write the header of fit result store '%1%'.") % file_name;
+}
+
+size_t FitResultStore::GetFileSize() const
+{
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0)
+        throw exception("Unable to get the size of fit result store '%1%'.") % file_name;
+    return static_cast<size_t>(file_stat.st_size);
+}
+
+bool FitResultStore::ReopenIfReplaced()
+{
+    struct stat path_stat, fd_stat;
+    if(stat(file_name.c_str(), &path_stat) != 0 || fstat(fd, &fd_stat) != 0)
+        throw exception("Unable to check fit result store '%1%': %2%.") % file_name % std::strerror(errno);
+    if(path_stat.st_dev == fd_stat.st_dev && path_stat.st_ino == fd_stat.st_ino)
+        return false;
+    // Closing the file also releases the lock on it.
+    close(fd);
+    fd = open(file_name.c_str(), O_RDWR);
+    if(fd < 0)
+        throw exception("Unable to reopen fit result store '%1%': %2%.") % file_name % std::strerror(errno);
+    return true;
+}
+
+void FitResultStore::Refresh()
+{
+    const Header header = ReadHeader();
+    if(header.generation != generation) {
+        index.clear();
+        n_loaded_records = 0;
+        generation = header.generation;
+    }
+    // An incomplete record at the end of the file can be left by a crashed process. It is ignored and overwritten
+    // by the next append.
+    const size_t n_records = (GetFileSize() - sizeof(Header)) / sizeof(Record);
+    if(n_records <= n_loaded_records) return;
+    std::vector<Record> records(n_records - n_loaded_records);
+    const size_t n_bytes = records.size() * sizeof(Record);
+    const off_t offset = static_cast<off_t>(sizeof(Header) + n_loaded_records * sizeof(Record));
+    if(pread(fd, records.data(), n_bytes, offset) != static_cast<ssize_t>(n_bytes))
+        throw exception("Unable to read fit result store '%1%'.") % file_name;
+    for(const Record& record : records)
+        index[record.key] = record.values;
+    n_loaded_records = n_records;
+}
+
+void FitResultStore::Compact()
+{
+    const size_t n_kept = std::min(n_loaded_records, (max_size / 2 - sizeof(Header)) / sizeof(Record));
+    std::vector<Record> records(n_kept);
+    const size_t n_bytes = n_kept * sizeof(Record);
+    const off_t read_offset = static_cast<off_t>(sizeof(Header) + (n_loaded_records - n_kept) * sizeof(Record));
+    if(pread(fd, records.data(), n_bytes, read_offset) != static_cast<ssize_t>(n_bytes))
+        throw exception("Unable to read fit result store '%1%'.") % file_name;
+    Header header = ReadHeader();
+    ++header.generation;
+
+    // The compacted store is written into a temporary file that atomically replaces the original one, so a crash
+    // leaves either the original or the compacted store. The new file is locked before the rename, so other processes
+    // that open it wait until this process releases the lock.
+    const std::string tmp_file_name = file_name + ".tmp." + std::to_string(getpid());
+    const int tmp_fd = open(tmp_file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(tmp_fd < 0)
+        throw exception("Unable to create file '%1%': %2%.") % tmp_file_name % std::strerror(errno);
+    const bool replaced = flock(tmp_fd, LOCK_EX) == 0
+            && pwrite(tmp_fd, &header, sizeof(Header), 0) == static_cast<ssize_t>(sizeof(Header))
+            && pwrite(tmp_fd, records.data(), n_bytes, sizeof(Header)) == static_cast<ssize_t>(n_bytes)
+            && fsync(tmp_fd) == 0 && rename(tmp_file_name.c_str(), file_name.c_str()) == 0;
+    if(!replaced) {
+        close(tmp_fd);
+        unlink(tmp_file_name.c_str());
+        throw exception("Unable to compact fit result store '%1%'.") % file_name;
+    }
+    // Closing the replaced file releases its lock, while the lock of the new file is kept until the caller releases it.
+    close(fd);
+    fd = tmp_fd;
+
+    generation = header.generation;
+    index.clear();
+    for(const Record& record : records)
+        index[record.key] = record.values;
+    n_loaded_records = n_kept;
+    ++stats.n_compactions;
+}
+
+} // namespace analysis
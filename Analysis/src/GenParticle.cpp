@@ -3,6 +3,8 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "h-tautau/Analysis/include/GenParticle.h"
 
+#include <algorithm>
+
 namespace analysis {
 
 GenParticle::GenParticle(const ntuple::Event& events, size_t n)
@@ -18,66 +20,192 @@ GenParticle::GenParticle(const ntuple::Event& events, size_t n)
     vertex = events.genParticles_vertex.at(n);
 }
 
-GenEvent::GenEvent(const ntuple::Event& event)
+namespace {
+size_t CheckParticleIndex(Int_t index, size_t n_particles)
 {
-    genParticles.reserve(event.genParticles_p4.size());
-    for(size_t n = 0; n < event.genParticles_p4.size(); ++n)
-        genParticles.emplace_back(event,n);
+    if(index < 0 || static_cast<size_t>(index) >= n_particles)
+        throw exception("Gen particle index = %1% is out of range.") % index;
+    return static_cast<size_t>(index);
+}
 
-    for (size_t relIndex = 0; relIndex < event.genParticles_rel_mIndex.size(); relIndex++) {
-        int motherIndex = event.genParticles_rel_mIndex.at(relIndex);
-        int daughterIndex = event.genParticles_rel_pIndex.at(relIndex);
+// Stable counting sort of the (key, value) relations into the CSR representation.
+void BuildAdjacency(size_t n_particles, const std::vector<Int_t>& keys, const std::vector<Int_t>& values,
+                    std::vector<size_t>& offsets, std::vector<size_t>& indices)
+{
+    offsets.assign(n_particles + 1, 0);
+    for(Int_t key : keys)
+        ++offsets.at(CheckParticleIndex(key, n_particles) + 1);
+    for(size_t n = 1; n < offsets.size(); ++n)
+        offsets.at(n) += offsets.at(n - 1);
+    indices.resize(keys.size());
+    std::vector<size_t> positions(offsets.begin(), offsets.end() - 1);
+    for(size_t n = 0; n < keys.size(); ++n) {
+        const size_t key = static_cast<size_t>(keys.at(n));
+        indices.at(positions.at(key)++) = CheckParticleIndex(values.at(n), n_particles);
+    }
+}
+} // anonymous namespace
 
-        GenParticle* mother = &genParticles.at(static_cast<size_t>(motherIndex));
-        GenParticle* daughter = &genParticles.at(static_cast<size_t>(daughterIndex));
+GenEvent::GenEvent(const ntuple::Event& event)
+{
+    const size_t n_particles = event.genParticles_p4.size();
+    genParticles.reserve(n_particles);
+    for(size_t n = 0; n < n_particles; ++n)
+        genParticles.emplace_back(event,n);
 
-        mother->daughters.push_back(daughter);
-        daughter->mothers.push_back(mother);
+    if(event.genParticles_rel_mIndex.size() != event.genParticles_rel_pIndex.size())
+        throw exception("Inconsistent gen particle relations.");
+    BuildAdjacency(n_particles, event.genParticles_rel_pIndex, event.genParticles_rel_mIndex, mother_offsets,
+                   mother_indices);
+    BuildAdjacency(n_particles, event.genParticles_rel_mIndex, event.genParticles_rel_pIndex, daughter_offsets,
+                   daughter_indices);
+
+    for(const GenParticle& genParticle : genParticles) {
+        if(GetMothers(genParticle.index).empty())
+            primary_indices.push_back(genParticle.index);
+        if(genParticle.genStatusFlags.isPrompt())
+            prompt_indices.push_back(genParticle.index);
     }
+    std::stable_sort(prompt_indices.begin(), prompt_indices.end(), [&](size_t a, size_t b) {
+        return std::abs(genParticles.at(a).pdg) < std::abs(genParticles.at(b).pdg);
+    });
+    prompt_pdgs.reserve(prompt_indices.size());
+    for(size_t index : prompt_indices)
+        prompt_pdgs.push_back(std::abs(genParticles.at(index).pdg));
+    final_states.resize(n_particles);
+}
 
-    for(const GenParticle& genParticle : genParticles ){
-        if (!genParticle.mothers.size())
-            primaryParticles.insert(&genParticle);
+const GenParticleVector& GenEvent::GetGenParticles() const { return genParticles; }
 
+GenIndexRange GenEvent::GetMothers(size_t index) const
+{
+    return GenIndexRange(mother_indices.data() + mother_offsets.at(index),
+                         mother_indices.data() + mother_offsets.at(index + 1));
+}
 
-         if (genParticle.genStatusFlags.isPrompt())
-            particleCodeMap[std::abs(genParticle.pdg)].insert(&genParticle);
-    }
+GenIndexRange GenEvent::GetDaughters(size_t index) const
+{
+    return GenIndexRange(daughter_indices.data() + daughter_offsets.at(index),
+                         daughter_indices.data() + daughter_offsets.at(index + 1));
 }
 
 GenParticleSet GenEvent::GetParticles(int particle_pgd, bool requireIsLastCopy) const
 {
-    GenParticleSet results;
-    const ParticleCodeMap::const_iterator code_iter = particleCodeMap.find(particle_pgd);
+    const GenParticlePtrVector particles = FindParticles(particle_pgd, requireIsLastCopy);
+    return GenParticleSet(particles.begin(), particles.end());
+}
 
-    if (code_iter != particleCodeMap.end()){
-        for (const GenParticle* particle : code_iter->second){
-            if(requireIsLastCopy && !particle->genStatusFlags.isLastCopy()) continue;
-            results.insert(particle);
-        }
+GenParticlePtrVector GenEvent::FindParticles(int particle_pgd, bool requireIsLastCopy) const
+{
+    GenParticlePtrVector results;
+    const auto range = std::equal_range(prompt_pdgs.begin(), prompt_pdgs.end(), particle_pgd);
+    for(auto iter = range.first; iter != range.second; ++iter) {
+        const size_t prompt_pos = static_cast<size_t>(iter - prompt_pdgs.begin());
+        const GenParticle& particle = genParticles.at(prompt_indices.at(prompt_pos));
+        if(requireIsLastCopy && !particle.genStatusFlags.isLastCopy()) continue;
+        results.push_back(&particle);
     }
     return results;
 }
 
-void GenEvent::GetChosenParticlesTypes(const std::set<particles::ParticleType>& type_names, const GenParticle* mother, GenParticleSet& result) const
+void GenEvent::GetChosenParticlesTypes(const std::set<particles::ParticleType>& type_names, const GenParticle* mother,
+                                       GenParticleSet& result) const
 {
-    if(mother->genStatusFlags.isPrompt() && mother->genStatusFlags.isLastCopy() && particle_types->count(mother->pdg)
-        && type_names.count(particle_types->at(mother->pdg))) {
-        result.insert(mother);
-    } else {
-        for(const GenParticle* daughter : mother->daughters)
-            GetChosenParticlesTypes(type_names, daughter, result);
+    // The traversal state is local, so that concurrent queries on the same event are safe.
+    std::vector<size_t> stack = { mother->index };
+    std::vector<bool> visited(genParticles.size(), false);
+    visited.at(mother->index) = true;
+    while(!stack.empty()) {
+        const GenParticle& particle = genParticles.at(stack.back());
+        stack.pop_back();
+        if(particle.genStatusFlags.isPrompt() && particle.genStatusFlags.isLastCopy()
+                && particle_types->count(particle.pdg) && type_names.count(particle_types->at(particle.pdg))) {
+            result.insert(&particle);
+        } else {
+            for(size_t daughter : GetDaughters(particle.index)) {
+                if(visited.at(daughter)) continue;
+                visited.at(daughter) = true;
+                stack.push_back(daughter);
+            }
+        }
     }
 }
 
 bool GenEvent::areParented(const GenParticle* daughter, const GenParticle* mother) const
 {
-    for (size_t i = 0; i < daughter->mothers.size(); i++) {
-        const GenParticle* mother_ = daughter->mothers.at(i);
-        if(mother_ == mother || areParented(mother_, mother))
-            return true;
+    std::call_once(ancestors_flag, [this]() { BuildAncestors(); });
+    return IsAncestor(mother->index, daughter->index);
+}
+
+void GenEvent::BuildAncestors() const
+{
+    const size_t n_particles = genParticles.size();
+    n_ancestor_words = (n_particles + 63) / 64;
+    ancestor_bits.assign(n_particles * n_ancestor_words, 0);
+    // The particles are processed in the index order. The row of an already processed mother is complete, so it is
+    // merged as a whole instead of walking up its ancestors. The bits set in the row serve as the visited marks,
+    // which also makes the traversal safe for cyclic relations.
+    std::vector<size_t> stack;
+    for(size_t index = 0; index < n_particles; ++index) {
+        uint64_t* row = ancestor_bits.data() + index * n_ancestor_words;
+        stack.assign(GetMothers(index).begin(), GetMothers(index).end());
+        while(!stack.empty()) {
+            const size_t ancestor = stack.back();
+            stack.pop_back();
+            uint64_t& word = row[ancestor / 64];
+            const uint64_t bit = uint64_t(1) << (ancestor % 64);
+            if(word & bit) continue;
+            word |= bit;
+            if(ancestor < index) {
+                const uint64_t* ancestor_row = ancestor_bits.data() + ancestor * n_ancestor_words;
+                for(size_t n = 0; n < n_ancestor_words; ++n)
+                    row[n] |= ancestor_row[n];
+            } else {
+                for(size_t mother : GetMothers(ancestor))
+                    stack.push_back(mother);
+            }
+        }
     }
-    return false;
+}
+
+bool GenEvent::IsAncestor(size_t ancestor, size_t index) const
+{
+    return (ancestor_bits[index * n_ancestor_words + ancestor / 64] >> (ancestor % 64)) & 1;
+}
+
+const GenEvent::FinalState& GenEvent::GetFinalState(size_t index) const
+{
+    std::call_once(ancestors_flag, [this]() { BuildAncestors(); });
+    std::lock_guard<std::mutex> lock(final_state_mutex);
+    auto& final_state = final_states.at(index);
+    if(final_state) return *final_state;
+
+    // Final-state descendants are the particles without daughters that have the given particle as an ancestor,
+    // or the particle itself if it has no daughters. They are collected in the index order.
+    auto result = std::make_unique<FinalState>();
+    for(size_t candidate = 0; candidate < genParticles.size(); ++candidate) {
+        if(!GetDaughters(candidate).empty()) continue;
+        if(candidate == index || IsAncestor(index, candidate))
+            result->indices.push_back(candidate);
+    }
+
+    // Final-state particles are summed in the index order, the same order as in the sorted daughter sets.
+    const auto& neutrinos = particles::neutrinos();
+    const auto& light_leptons = particles::light_leptons();
+    for(size_t daughter_index : result->indices) {
+        const GenParticle& daughter = genParticles.at(daughter_index);
+        const int abs_pdg = std::abs(daughter.pdg);
+        const bool is_invisible = neutrinos.count(abs_pdg);
+        const bool is_tau_light_lepton = light_leptons.count(abs_pdg)
+                && daughter.genStatusFlags.isDirectTauDecayProduct();
+        for(size_t n = 0; n < result->p4.size(); ++n) {
+            const bool excludeInvisible = n & 2, excludeLightLeptons = n & 1;
+            if((excludeInvisible && is_invisible) || (excludeLightLeptons && is_tau_light_lepton)) continue;
+            result->p4[n] += daughter.momentum;
+        }
+    }
+    final_state = std::move(result);
+    return *final_state;
 }
 
 const std::string& GenEvent::GetParticleName(int pdgId)
@@ -136,20 +264,21 @@ void GenEvent::PrintChain(const GenParticle* particle, const std::string& pre) c
               << "> pt=" << genParticle_momentum.Pt()      << " eta=" << genParticle_momentum.Eta()
               << " phi=" << genParticle_momentum.Phi()     << " E=" << genParticle_momentum.E()
               << " m=" << genParticle_momentum.M()         << " index=" << particle->index;
-    if(particle->mothers.size() > 0){
-        auto mothers_index = particle->mothers.at(0)->index;
-        std::cout  << " mother_index=" << mothers_index;
-        for(size_t index_mother = 1; index_mother < particle->mothers.size(); ++index_mother)
-            std::cout  << "," << particle->mothers.at(index_mother)->index;
+    const auto mothers = GetMothers(particle->index);
+    if(mothers.size() > 0){
+        std::cout  << " mother_index=" << mothers.at(0);
+        for(size_t index_mother = 1; index_mother < mothers.size(); ++index_mother)
+            std::cout  << "," << mothers.at(index_mother);
     }
 
     std::cout << " vertex=" << particle->vertex << " status=" << particleStatus
               << " statusFlags=" << flag << std::endl;
 
-    for(unsigned n = 0; n < particle->daughters.size(); ++n) {
-        const GenParticle* daughter = particle->daughters.at(n);
+    const auto daughters = GetDaughters(particle->index);
+    for(unsigned n = 0; n < daughters.size(); ++n) {
+        const GenParticle* daughter = &genParticles.at(daughters.at(n));
         std::cout << pre << "+-> ";
-        const char pre_first = n == particle->daughters.size() -1 ? ' ' : '|';
+        const char pre_first = n == daughters.size() -1 ? ' ' : '|';
         const std::string pre_d = pre + pre_first + "   ";
         PrintChain(daughter, pre_d);
     }
@@ -157,52 +286,33 @@ void GenEvent::PrintChain(const GenParticle* particle, const std::string& pre) c
 
 void GenEvent::Print() const
 {
-    for (const GenParticle* particle : primaryParticles) {
-        GenEvent::PrintChain(particle, "");
+    for (size_t index : primary_indices) {
+        GenEvent::PrintChain(&genParticles.at(index), "");
     }
 }
 
 void GenEvent::FindFinalStateDaughters(const GenParticle& particle, std::set<const GenParticle*>& daughters,
-                             const std::set<int>& pdg_to_exclude)
-{
-    if(!particle.daughters.size()) {
-        const int abs_pdg = std::abs(particle.pdg);
-        if(!pdg_to_exclude.count(abs_pdg))
-            daughters.insert(&particle);
-    } else {
-        for(const auto& daughter : particle.daughters)
-            FindFinalStateDaughters(*daughter, daughters, pdg_to_exclude);
+                             const std::set<int>& pdg_to_exclude) const
+{
+    for(size_t index : GetFinalState(particle.index).indices) {
+        const GenParticle& daughter = genParticles.at(index);
+        if(!pdg_to_exclude.count(std::abs(daughter.pdg)))
+            daughters.insert(&daughter);
     }
 }
 
-
 LorentzVectorM GenEvent::GetFinalStateMomentum(const GenParticle& particle, std::vector<const GenParticle*>& visible_daughters,
-                                   bool excludeInvisible, bool excludeLightLeptons)
+                                   bool excludeInvisible, bool excludeLightLeptons) const
 {
-    using pair = std::pair<bool, bool>;
-    static const std::set<int> empty = {};
-    auto neutrinos = particles::neutrinos();
-    auto light_leptons = particles::light_leptons();
-    auto light_and_invisible = particles::light_and_invisible();
-
-    static const std::map<pair, const std::set<int>*> to_exclude {
-        { pair(false, false), &empty }, { pair(true, false), &neutrinos },
-        { pair(false, true), &light_leptons }, { pair(true, true), &light_and_invisible },
-    };
-
-    std::set<const GenParticle*> daughters_set;
-
-    FindFinalStateDaughters(particle, daughters_set, *to_exclude.at(pair(excludeInvisible, false)));
+    const FinalState& final_state = GetFinalState(particle.index);
+    const auto& neutrinos = particles::neutrinos();
     visible_daughters.clear();
-    visible_daughters.insert(visible_daughters.begin(), daughters_set.begin(), daughters_set.end());
-
-    LorentzVectorM p4;
-    for(auto daughter : visible_daughters) {
-        if(excludeLightLeptons && light_leptons.count(std::abs(daughter->pdg))
-            && daughter->genStatusFlags.isDirectTauDecayProduct()) continue;
-        p4 += daughter->momentum;
+    for(size_t index : final_state.indices) {
+        const GenParticle& daughter = genParticles.at(index);
+        if(!excludeInvisible || !neutrinos.count(std::abs(daughter.pdg)))
+            visible_daughters.push_back(&daughter);
     }
-    return p4;
+    return final_state.p4.at((excludeInvisible ? 2 : 0) + (excludeLightLeptons ? 1 : 0));
 }
 
 int GenEvent::GetParticleCharge(int pdg)
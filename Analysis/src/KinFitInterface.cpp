@@ -10,10 +10,18 @@ namespace analysis {
 
 namespace kin_fit {
 
-FitResults FitProducer::FitImpl(const TLorentzVector& lepton1_p4, const TLorentzVector& lepton2_p4,
-               const TLorentzVector& jet1_p4, const TLorentzVector& jet2_p4, const TVector2& met,
-               const TMatrixD& met_cov, double resolution_1, double resolution_2, int verbosity)
+namespace {
+
+FitResults RunFit(const FitInput& input, int verbosity)
 {
+    const TLorentzVector& lepton1_p4 = input.lepton1_p4;
+    const TLorentzVector& lepton2_p4 = input.lepton2_p4;
+    const TLorentzVector& jet1_p4 = input.jet1_p4;
+    const TLorentzVector& jet2_p4 = input.jet2_p4;
+    const TVector2& met = input.met;
+    const TMatrixD& met_cov = input.met_cov;
+    const double resolution_1 = input.resolution_1, resolution_2 = input.resolution_2;
+
     FitResults result;
     try {
         if(verbosity > 0) {
@@ -56,5 +64,57 @@ FitResults FitProducer::FitImpl(const TLorentzVector& lepton1_p4, const TLorentz
     return result;
 }
 
+FitResultStore::Key GetInputKey(const FitInput& input)
+{
+    static constexpr uint64_t salt = 2;
+    FitInputHash hash(salt);
+    for(const TLorentzVector* p4 : { &input.lepton1_p4, &input.lepton2_p4, &input.jet1_p4, &input.jet2_p4 })
+        hash.Add(p4->Px()).Add(p4->Py()).Add(p4->Pz()).Add(p4->E());
+    hash.Add(input.met.Px()).Add(input.met.Py());
+    hash.Add(input.met_cov[0][0]).Add(input.met_cov[0][1]).Add(input.met_cov[1][0]).Add(input.met_cov[1][1]);
+    hash.Add(input.resolution_1).Add(input.resolution_2);
+    return hash.GetKey();
+}
+
+std::shared_ptr<FitResultStore>& GetResultStore()
+{
+    static std::shared_ptr<FitResultStore> store;
+    return store;
+}
+
+} // anonymous namespace
+
+void FitProducer::SetResultStore(const std::shared_ptr<FitResultStore>& store)
+{
+    GetResultStore() = store;
+}
+
+FitResults FitProducer::Fit(const FitInput& input, int verbosity)
+{
+    const auto& store = GetResultStore();
+    if(!store)
+        return RunFit(input, verbosity);
+
+    const FitResultStore::Key key = GetInputKey(input);
+    FitResultStore::Values values;
+    if(store->TryGet(key, values)) {
+        if(verbosity > 0)
+            std::cout << "KinFit result is taken from the fit result store." << std::endl;
+        return FitResults(values[0], values[1], values[2], static_cast<int>(values[3]));
+    }
+
+    const FitResults result = RunFit(input, verbosity);
+    // The mass, chi2 and probability are not set if the fit has not converged.
+    values.fill(0);
+    values[3] = result.convergence;
+    if(result.HasValidMass()) {
+        values[0] = result.mass;
+        values[1] = result.chi2;
+        values[2] = result.probability;
+    }
+    store->Put(key, values);
+    return result;
+}
+
 } // namespace kin_fit
 } // namespace analysis
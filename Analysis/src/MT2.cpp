@@ -0,0 +1,250 @@
+/*! Batched MT2 calculation.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Analysis/include/MT2.h"
+
+#include <array>
+#include <cmath>
+#include <iostream>
+
+namespace analysis {
+
+namespace {
+
+// Coefficients of the conic c_xx x^2 + 2 c_xy x y + c_yy y^2 + 2 c_x x + 2 c_y y + c = 0 and its determinant,
+// computed in the same way as in Lester::EllipseParams.
+struct MT2Ellipse {
+    double c_xx, c_yy, c_xy, c_x, c_y, c, det;
+};
+
+inline MT2Ellipse MakeMT2Ellipse(double mSq, double mtSq, double tx, double ty, double mqSq, double pxmiss,
+                                 double pymiss)
+{
+    const double txSq = tx*tx;
+    const double tySq = ty*ty;
+    const double pxmissSq = pxmiss*pxmiss;
+    const double pymissSq = pymiss*pymiss;
+
+    MT2Ellipse e;
+    e.c_xx = +4.0* mtSq + 4.0* tySq;
+    e.c_yy = +4.0* mtSq + 4.0* txSq;
+    e.c_xy = -4.0* tx*ty;
+    e.c_x  = -4.0* mtSq*pxmiss - 2.0* mqSq*tx + 2.0* mSq*tx - 2.0* mtSq*tx  +
+             4.0* pymiss*tx*ty - 4.0* pxmiss*tySq;
+    e.c_y  = -4.0* mtSq*pymiss - 4.0* pymiss*txSq - 2.0* mqSq*ty + 2.0* mSq*ty - 2.0* mtSq*ty +
+             4.0* pxmiss*tx*ty;
+    e.c =   - mqSq*mqSq + 2*mqSq*mSq - mSq*mSq + 2*mqSq*mtSq + 2*mSq*mtSq - mtSq*mtSq +
+            4.0* mtSq*pxmissSq + 4.0* mtSq*pymissSq + 4.0* mqSq*pxmiss*tx -
+            4.0* mSq*pxmiss*tx + 4.0* mtSq*pxmiss*tx + 4.0* mqSq*txSq +
+            4.0* pymissSq*txSq + 4.0* mqSq*pymiss*ty - 4.0* mSq*pymiss*ty +
+            4.0* mtSq*pymiss*ty - 8.0* pxmiss*pymiss*tx*ty + 4.0* mqSq*tySq +
+            4.0* pxmissSq*tySq;
+    e.det = (2.0*e.c_x*e.c_xy*e.c_y + e.c*e.c_xx*e.c_yy - e.c_yy*e.c_x*e.c_x - e.c*e.c_xy*e.c_xy
+             - e.c_xx*e.c_y*e.c_y);
+    return e;
+}
+
+inline double LesterFactor(const MT2Ellipse& e1, const MT2Ellipse& e2)
+{
+    return e1.c_xx*e1.c_yy*e2.c + 2.0*e1.c_xy*e1.c_y*e2.c_x - 2.0*e1.c_x*e1.c_yy*e2.c_x + e1.c*e1.c_yy*e2.c_xx
+           - 2.0*e1.c*e1.c_xy*e2.c_xy + 2.0*e1.c_x*e1.c_y*e2.c_xy + 2.0*e1.c_x*e1.c_xy*e2.c_y
+           - 2.0*e1.c_xx*e1.c_y*e2.c_y + e1.c*e1.c_xx*e2.c_yy - e2.c_yy*(e1.c_x*e1.c_x) - e2.c*(e1.c_xy*e1.c_xy)
+           - e2.c_xx*(e1.c_y*e1.c_y);
+}
+
+enum class EllipseTest : int { Overlap = 0, Disjoint = 1, Singular = 2 };
+
+// Branch-free version of Lester::ellipsesAreDisjoint. Singular corresponds to the cases in which the scalar code
+// throws an exception. Bitwise operators are used instead of the logical ones to avoid the control flow, which
+// would prevent the vectorization of the loop over lanes.
+inline int TestEllipses(const MT2Ellipse& e1, const MT2Ellipse& e2)
+{
+    const bool invalid = (e1.c_xx < 0) | (e1.c_yy < 0) | (e2.c_xx < 0) | (e2.c_yy < 0);
+    const bool equal = (e1.c_xx == e2.c_xx) & (e1.c_yy == e2.c_yy) & (e1.c_xy == e2.c_xy) & (e1.c_x == e2.c_x)
+                       & (e1.c_y == e2.c_y) & (e1.c == e2.c);
+
+    const double coeffLamPow3 = e1.det;
+    const double coeffLamPow2 = LesterFactor(e1, e2);
+    const double coeffLamPow1 = LesterFactor(e2, e1);
+    const double coeffLamPow0 = e2.det;
+    const bool normal_order = std::abs(coeffLamPow3) >= std::abs(coeffLamPow0);
+    const double p3 = normal_order ? coeffLamPow3 : coeffLamPow0;
+    const double p2 = normal_order ? coeffLamPow2 : coeffLamPow1;
+    const double p1 = normal_order ? coeffLamPow1 : coeffLamPow2;
+    const double p0 = normal_order ? coeffLamPow0 : coeffLamPow3;
+
+    const double a = p2 / p3;
+    const double b = p1 / p3;
+    const double c = p0 / p3;
+    const double thing1 = -3.0*b + a*a;
+    const double thing2 = -27.0*c*c + 18.0*c*a*b + a*a*b*b - 4.0*a*a*a*c - 4.0*b*b*b;
+    const bool disjoint = !(thing1 <= 0) & !(thing2 <= 0)
+                          & (((a >= 0) & (3.0*a*c + b*a*a - 4.0*b*b < 0)) | (a < 0));
+
+    const bool singular = invalid | (!equal & (p3 == 0));
+    const bool is_disjoint = !invalid & !equal & !singular & disjoint;
+    return static_cast<int>(EllipseTest::Singular) * singular + static_cast<int>(EllipseTest::Disjoint) * is_disjoint;
+}
+
+class MT2BatchSolver {
+public:
+    static constexpr size_t n_lanes = 8;
+    static constexpr unsigned maxAttempts = 10000;
+
+    MT2BatchSolver(const std::vector<MT2Input>& _inputs, double _desiredPrecisionOnMT2) :
+        inputs(_inputs), desiredPrecisionOnMT2(_desiredPrecisionOnMT2),
+        results(inputs.size(), asymm_mt2_lester_bisect::MT2_ERROR)
+    {
+    }
+
+    std::vector<double> Run()
+    {
+        while(true) {
+            bool has_active = false;
+            for(size_t lane = 0; lane < n_lanes; ++lane)
+                has_active = PrepareLane(lane) || has_active;
+            if(!has_active) break;
+
+            for(size_t lane = 0; lane < n_lanes; ++lane) {
+                const double mSq = trialM[lane] * trialM[lane];
+                const MT2Ellipse side1 = MakeMT2Ellipse(mSq, msSq[lane], -sx[lane], -sy[lane], mpSq[lane], 0, 0);
+                const MT2Ellipse side2 = MakeMT2Ellipse(mSq, mtSq[lane], +tx[lane], +ty[lane], mqSq[lane],
+                                                        pxMiss[lane], pyMiss[lane]);
+                test_result[lane] = TestEllipses(side1, side2);
+            }
+
+            for(size_t lane = 0; lane < n_lanes; ++lane)
+                UpdateLane(lane);
+        }
+        return std::move(results);
+    }
+
+private:
+    enum class Phase { Idle, UpperBound, Bisection };
+
+    // Sets trialM for the next evaluation of the lane, refilling it with the next event when its current event
+    // has converged. Returns false if there are no more events for this lane.
+    bool PrepareLane(size_t lane)
+    {
+        while(true) {
+            if(phase[lane] == Phase::Idle) {
+                if(next_input >= inputs.size()) return false;
+                LoadEvent(lane, next_input++);
+            } else if(phase[lane] == Phase::UpperBound) {
+                trialM[lane] = mUpper[lane];
+                return true;
+            } else {
+                if(!(desiredPrecisionOnMT2 <= 0 || mUpper[lane] - mLower[lane] > desiredPrecisionOnMT2)) {
+                    const double mAns = (mLower[lane] + mUpper[lane]) / 2.0;
+                    Finish(lane, mAns * mAns);
+                    continue;
+                }
+                trialM[lane] = goLow[lane] ? (mLower[lane] * 15 + mUpper[lane]) / 16
+                                           : (mUpper[lane] + mLower[lane]) / 2.0;
+                if(trialM[lane] <= mLower[lane] || trialM[lane] >= mUpper[lane]) {
+                    Finish(lane, trialM[lane] * trialM[lane]);
+                    continue;
+                }
+                return true;
+            }
+        }
+    }
+
+    void LoadEvent(size_t lane, size_t index)
+    {
+        const MT2Input& input = inputs.at(index);
+        event_index[lane] = index;
+        const bool swap_sides = input.mVisA + input.chiA > input.mVisB + input.chiB;
+        const double mVis1 = swap_sides ? input.mVisB : input.mVisA;
+        const double mVis2 = swap_sides ? input.mVisA : input.mVisB;
+        const double mInvis1 = swap_sides ? input.chiB : input.chiA;
+        const double mInvis2 = swap_sides ? input.chiA : input.chiB;
+
+        msSq[lane] = mVis1 * mVis1;
+        sx[lane] = swap_sides ? input.pxB : input.pxA;
+        sy[lane] = swap_sides ? input.pyB : input.pyA;
+        mpSq[lane] = mInvis1 * mInvis1;
+        mtSq[lane] = mVis2 * mVis2;
+        tx[lane] = swap_sides ? input.pxA : input.pxB;
+        ty[lane] = swap_sides ? input.pyA : input.pyB;
+        mqSq[lane] = mInvis2 * mInvis2;
+        pxMiss[lane] = input.pxMiss;
+        pyMiss[lane] = input.pyMiss;
+
+        const double sSq = sx[lane] * sx[lane] + sy[lane] * sy[lane];
+        const double tSq = tx[lane] * tx[lane] + ty[lane] * ty[lane];
+        const double pMissSq = input.pxMiss * input.pxMiss + input.pyMiss * input.pyMiss;
+        const double massSqSum = msSq[lane] + mtSq[lane] + mpSq[lane] + mqSq[lane];
+        const double scaleSq = (massSqSum + sSq + tSq + pMissSq) / 8.0;
+        if(scaleSq == 0) {
+            results.at(index) = 0;
+            return;
+        }
+
+        const double mMin = mVis2 + mInvis2;
+        mLower[lane] = mMin;
+        mUpper[lane] = mMin + std::sqrt(scaleSq);
+        attempts[lane] = 0;
+        goLow[lane] = true;
+        phase[lane] = Phase::UpperBound;
+    }
+
+    void UpdateLane(size_t lane)
+    {
+        const EllipseTest test = static_cast<EllipseTest>(test_result[lane]);
+        if(phase[lane] == Phase::UpperBound) {
+            ++attempts[lane];
+            if(test == EllipseTest::Singular) {
+                Finish(lane, asymm_mt2_lester_bisect::MT2_ERROR);
+            } else if(test == EllipseTest::Overlap) {
+                phase[lane] = Phase::Bisection;
+            } else if(attempts[lane] >= maxAttempts) {
+                std::cerr << "MT2 algorithm failed to find upper bound to MT2" << std::endl;
+                Finish(lane, asymm_mt2_lester_bisect::MT2_ERROR);
+            } else {
+                mUpper[lane] *= 2;
+            }
+        } else if(phase[lane] == Phase::Bisection) {
+            if(test == EllipseTest::Singular) {
+                Finish(lane, mLower[lane] * mLower[lane]);
+            } else if(test == EllipseTest::Disjoint) {
+                mLower[lane] = trialM[lane];
+                goLow[lane] = false;
+            } else {
+                mUpper[lane] = trialM[lane];
+            }
+        }
+    }
+
+    void Finish(size_t lane, double mT2_Sq)
+    {
+        results.at(event_index[lane]) = mT2_Sq == asymm_mt2_lester_bisect::MT2_ERROR
+                ? asymm_mt2_lester_bisect::MT2_ERROR : std::sqrt(mT2_Sq);
+        phase[lane] = Phase::Idle;
+    }
+
+private:
+    const std::vector<MT2Input>& inputs;
+    const double desiredPrecisionOnMT2;
+    std::vector<double> results;
+    size_t next_input{0};
+
+    using LaneValues = std::array<double, n_lanes>;
+    LaneValues msSq{}, sx{}, sy{}, mpSq{}, mtSq{}, tx{}, ty{}, mqSq{}, pxMiss{}, pyMiss{};
+    LaneValues mLower{}, mUpper{}, trialM{};
+    std::array<int, n_lanes> test_result{};
+    std::array<bool, n_lanes> goLow{};
+    std::array<unsigned, n_lanes> attempts{};
+    std::array<size_t, n_lanes> event_index{};
+    std::array<Phase, n_lanes> phase{};
+};
+
+} // anonymous namespace
+
+std::vector<double> Calculate_MT2_Batch(const std::vector<MT2Input>& inputs, double desiredPrecisionOnMT2)
+{
+    MT2BatchSolver solver(inputs, desiredPrecisionOnMT2);
+    return solver.Run();
+}
+
+} // namespace analysis
@@ -2,7 +2,9 @@
 This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "../include/SVfitAnaInterface.h"
+#include <Math/VectorUtil.h>
 #include "TauAnalysis/ClassicSVfit/interface/ClassicSVfit.h"
+#include "TauAnalysis/ClassicSVfit/interface/FastMTT.h"
 #include "TauAnalysis/ClassicSVfit/interface/MeasuredTauLepton.h"
 #include "TauAnalysis/ClassicSVfit/interface/svFitHistogramAdapter.h"
 
@@ -36,52 +38,209 @@ classic_svFit::MeasuredTauLepton CreateMeasuredLepton(const LeptonCandidate<ntup
                                             decay_mode);
 }
 
+namespace {
+
+void PrintInputs(const std::vector<classic_svFit::MeasuredTauLepton>& measured_leptons,
+                 const MissingET<ntuple::TupleMet>& met, const TMatrixD& met_cov_t)
+{
+    std::cout << "SVfit inputs:\n";
+    for(size_t n = 0; n < measured_leptons.size(); ++n) {
+        const auto& lep = measured_leptons.at(n);
+        std::cout << std::fixed << std::setprecision(7);
+        std::cout << "\tlep" << n << ", (pt, eta, phi, m) = (" << lep.pt() << ", " << lep.eta()
+                  << ", " << lep.phi() << ", " << lep.mass() << "), type=" << lep.type()
+                  << ", decayMode=" << lep.decayMode() << "\n";
+    }
+    std::cout << "\tMET (px, py) = (" << met.GetMomentum().Px() << ", " << met.GetMomentum().Py() << ")\n"
+              << "\tmet_cov: (00, 01, 10, 11) = (" << met_cov_t[0][0] << ", " << met_cov_t[0][1]
+              << ", " << met_cov_t[1][0] << ", " << met_cov_t[1][1] << ")\n";
+}
+
+FitResults RunClassic(const std::vector<classic_svFit::MeasuredTauLepton>& measured_leptons,
+                      const MissingET<ntuple::TupleMet>& met, const TMatrixD& met_cov_t, int max_evaluations,
+                      SVfitMode mode, int verbosity)
+{
+    ClassicSVfit algo(verbosity);
+    algo.addLogM_fixed(false);
+    algo.addLogM_dynamic(false);
+    algo.setMaxObjFunctionCalls(static_cast<unsigned>(max_evaluations));
+    // algo.setDiTauMassConstraint(-1.0);
+    algo.integrate(measured_leptons, met.GetMomentum().Px(), met.GetMomentum().Py(), met_cov_t);
+
+    FitResults result;
+    result.mode = mode;
+    if(algo.isValidSolution()) {
+        auto histoAdapter = dynamic_cast<classic_svFit::DiTauSystemHistogramAdapter*>(algo.getHistogramAdapter());
+        result.momentum = LorentzVectorM(histoAdapter->getPt(), histoAdapter->getEta(), histoAdapter->getPhi(),
+                                         histoAdapter->getMass());
+        result.momentum_error = LorentzVectorM(histoAdapter->getPtErr(), histoAdapter->getEtaErr(),
+                                               histoAdapter->getPhiErr(), histoAdapter->getMassErr());
+        result.transverseMass = histoAdapter->getTransverseMass();
+        result.transverseMass_error = histoAdapter->getTransverseMassErr();
+        result.has_valid_momentum = true;
+    }
+    return result;
+}
+
+// FastMTT does not estimate uncertainties and does not provide the transverse mass of the di-tau system, so the
+// transverse mass is computed from the fitted tau momenta.
+FitResults RunFastMTT(const std::vector<classic_svFit::MeasuredTauLepton>& measured_leptons,
+                      const MissingET<ntuple::TupleMet>& met, const TMatrixD& met_cov_t)
+{
+    FastMTT algo;
+    algo.run(measured_leptons, met.GetMomentum().Px(), met.GetMomentum().Py(), met_cov_t);
+
+    FitResults result;
+    result.mode = SVfitMode::FastMTT;
+    const LorentzVectorM momentum(algo.getBestP4());
+    if(momentum.mass() > 0) {
+        const LorentzVectorM tau1(algo.getTau1P4()), tau2(algo.getTau2P4());
+        const double dphi = ROOT::Math::VectorUtil::DeltaPhi(tau1, tau2);
+        result.momentum = momentum;
+        result.momentum_error = LorentzVectorM(0, 0, 0, 0);
+        result.transverseMass = std::sqrt(2 * tau1.pt() * tau2.pt() * (1 - std::cos(dphi)));
+        result.transverseMass_error = 0;
+        result.has_valid_momentum = true;
+    }
+    return result;
+}
+
+bool IsConverged(const FitResults& previous, const FitResults& current, double tolerance)
+{
+    if(!previous.has_valid_momentum || !current.has_valid_momentum) return false;
+    const double mass = current.momentum.mass(), mass_error = current.momentum_error.mass();
+    return std::abs(mass - previous.momentum.mass()) <= tolerance * mass
+            && std::abs(mass_error - previous.momentum_error.mass()) <= tolerance * mass_error;
+}
+
+FitResults RunFit(const std::vector<classic_svFit::MeasuredTauLepton>& measured_leptons,
+                  const MissingET<ntuple::TupleMet>& met, const TMatrixD& met_cov_t, const FitSettings& settings,
+                  int verbosity)
+{
+    FitResults result;
+    if(settings.mode == SVfitMode::Classic) {
+        result = RunClassic(measured_leptons, met, met_cov_t, settings.max_evaluations, settings.mode, verbosity);
+    } else if(settings.mode == SVfitMode::FastMTT) {
+        result = RunFastMTT(measured_leptons, met, met_cov_t);
+    } else if(settings.mode == SVfitMode::Adaptive) {
+        if(settings.adaptive_min_evaluations <= 0 || !(settings.adaptive_tolerance > 0))
+            throw exception("Invalid adaptive SVfit settings: min evaluations = %1%, tolerance = %2%.")
+                % settings.adaptive_min_evaluations % settings.adaptive_tolerance;
+        // ClassicSVfit can't be resumed, so each step repeats the integration with a doubled budget.
+        int n_evaluations = std::min(settings.adaptive_min_evaluations, settings.max_evaluations);
+        FitResults previous;
+        while(true) {
+            result = RunClassic(measured_leptons, met, met_cov_t, n_evaluations, settings.mode, verbosity);
+            if(IsConverged(previous, result, settings.adaptive_tolerance) || n_evaluations >= settings.max_evaluations)
+                break;
+            previous = result;
+            n_evaluations = n_evaluations > settings.max_evaluations / 2
+                          ? settings.max_evaluations : 2 * n_evaluations;
+        }
+        if(verbosity > 0)
+            std::cout << "SVfit adaptive integration stopped after " << n_evaluations << " evaluations.\n";
+    } else {
+        throw exception("SVfit mode %1% is not supported.") % settings.mode;
+    }
+    return result;
+}
+
+FitResultStore::Key GetInputKey(const std::vector<classic_svFit::MeasuredTauLepton>& measured_leptons,
+                                const MissingET<ntuple::TupleMet>& met, const TMatrixD& met_cov_t,
+                                const FitSettings& settings)
+{
+    static constexpr uint64_t salt = 1;
+    FitInputHash hash(salt);
+    for(const auto& lep : measured_leptons) {
+        hash.Add(static_cast<int64_t>(lep.type())).Add(static_cast<int64_t>(lep.decayMode()));
+        hash.Add(lep.pt()).Add(lep.eta()).Add(lep.phi()).Add(lep.mass());
+    }
+    hash.Add(met.GetMomentum().Px()).Add(met.GetMomentum().Py());
+    hash.Add(met_cov_t[0][0]).Add(met_cov_t[0][1]).Add(met_cov_t[1][0]).Add(met_cov_t[1][1]);
+    hash.Add(static_cast<int64_t>(settings.mode));
+    if(settings.mode != SVfitMode::FastMTT)
+        hash.Add(static_cast<int64_t>(settings.max_evaluations));
+    if(settings.mode == SVfitMode::Adaptive)
+        hash.Add(settings.adaptive_tolerance).Add(static_cast<int64_t>(settings.adaptive_min_evaluations));
+    return hash.GetKey();
+}
+
+FitResultStore::Values ToStoreValues(const FitResults& result)
+{
+    return FitResultStore::Values{{
+        static_cast<double>(result.has_valid_momentum), result.momentum.pt(), result.momentum.eta(),
+        result.momentum.phi(), result.momentum.mass(), result.momentum_error.pt(), result.momentum_error.eta(),
+        result.momentum_error.phi(), result.momentum_error.mass(), result.transverseMass,
+        result.transverseMass_error, static_cast<double>(result.mode)
+    }};
+}
+
+FitResults FromStoreValues(const FitResultStore::Values& v)
+{
+    return FitResults(v[0] != 0, LorentzVectorM(v[1], v[2], v[3], v[4]), LorentzVectorM(v[5], v[6], v[7], v[8]),
+                      v[9], v[10], static_cast<SVfitMode>(static_cast<int>(v[11])));
+}
+
+std::shared_ptr<FitResultStore>& GetResultStore()
+{
+    static std::shared_ptr<FitResultStore> store;
+    return store;
+}
+
+} // anonymous namespace
+
+void FitProducer::SetResultStore(const std::shared_ptr<FitResultStore>& store)
+{
+    GetResultStore() = store;
+}
+
 FitResults FitProducer::Fit(const LeptonCandidate<ntuple::TupleLepton>& first_daughter,
                             const LeptonCandidate<ntuple::TupleLepton>& second_daughter,
                             const MissingET<ntuple::TupleMet>& met, int verbosity)
+{
+    return Fit(first_daughter, second_daughter, met, FitSettings(), verbosity);
+}
+
+FitResults FitProducer::Fit(const LeptonCandidate<ntuple::TupleLepton>& first_daughter,
+                            const LeptonCandidate<ntuple::TupleLepton>& second_daughter,
+                            const MissingET<ntuple::TupleMet>& met, const FitSettings& settings, int verbosity)
 {
     static const auto init = []() { TH1::AddDirectory(false); return true; };
     static const bool initialized = init();
     (void) initialized;
 
+    if(settings.max_evaluations <= 0)
+        throw exception("Invalid maximal number of SVfit integrand evaluations = %1%.") % settings.max_evaluations;
+
     const std::vector<classic_svFit::MeasuredTauLepton> measured_leptons = {
         CreateMeasuredLepton(first_daughter),
         CreateMeasuredLepton(second_daughter)
     };
 
     const TMatrixD met_cov_t = ConvertMatrix(met.GetCovMatrix());
-    ClassicSVfit algo(verbosity);
-    algo.addLogM_fixed(false);
-    algo.addLogM_dynamic(false);
-    // algo.setDiTauMassConstraint(-1.0);
-    if(verbosity > 0) {
-        std::cout << "SVfit inputs:\n";
-        for(size_t n = 0; n < measured_leptons.size(); ++n) {
-            const auto& lep = measured_leptons.at(n);
-            std::cout << std::fixed << std::setprecision(7);
-            std::cout << "\tlep" << n << ", (pt, eta, phi, m) = (" << lep.pt() << ", " << lep.eta()
-                      << ", " << lep.phi() << ", " << lep.mass() << "), type=" << lep.type()
-                      << ", decayMode=" << lep.decayMode() << "\n";
+    if(verbosity > 0)
+        PrintInputs(measured_leptons, met, met_cov_t);
+
+    const auto& store = GetResultStore();
+    FitResultStore::Key key;
+    if(store) {
+        key = GetInputKey(measured_leptons, met, met_cov_t, settings);
+        FitResultStore::Values values;
+        if(store->TryGet(key, values)) {
+            if(verbosity > 0)
+                std::cout << "SVfit result is taken from the fit result store.\n";
+            return FromStoreValues(values);
         }
-        std::cout << "\tMET (px, py) = (" << met.GetMomentum().Px() << ", " << met.GetMomentum().Py() << ")\n"
-                  << "\tmet_cov: (00, 01, 10, 11) = (" << met_cov_t[0][0] << ", " << met_cov_t[0][1]
-                  << ", " << met_cov_t[1][0] << ", " << met_cov_t[1][1] << ")\n";
     }
-    algo.integrate(measured_leptons, met.GetMomentum().Px(), met.GetMomentum().Py(), met_cov_t);
 
-    FitResults result;
-    if(algo.isValidSolution()) {
-        auto histoAdapter = dynamic_cast<classic_svFit::DiTauSystemHistogramAdapter*>(algo.getHistogramAdapter());
-        result.momentum = LorentzVectorM(histoAdapter->getPt(), histoAdapter->getEta(), histoAdapter->getPhi(), histoAdapter->getMass());
-        result.momentum_error = LorentzVectorM(histoAdapter->getPtErr(), histoAdapter->getEtaErr(), histoAdapter->getPhiErr(), histoAdapter->getMassErr());
-        result.transverseMass = histoAdapter->getTransverseMass();
-        result.transverseMass_error = histoAdapter->getTransverseMassErr();
-        result.has_valid_momentum = true;
-        if(verbosity > 0) {
-            std::cout << "SVfit result: (pt, eta, phi, m) = (" << histoAdapter->getPt() << ", "
-                      << histoAdapter->getEta() << ", " << histoAdapter->getPhi() << ", "
-                      << histoAdapter->getMass() << ")\n";
-        }
+    const FitResults result = RunFit(measured_leptons, met, met_cov_t, settings, verbosity);
+    if(store)
+        store->Put(key, ToStoreValues(result));
+
+    if(verbosity > 0 && result.has_valid_momentum) {
+        std::cout << "SVfit result: (pt, eta, phi, m) = (" << result.momentum.pt() << ", "
+                  << result.momentum.eta() << ", " << result.momentum.phi() << ", "
+                  << result.momentum.mass() << ")\n";
     }
     return result;
 }
@@ -209,6 +209,101 @@ ENUM_NAMES(UncertaintySource) = {
     { UncertaintySource::TauCustomSF_DM11, "TauCustomSF_DM11" }
 };
 
+// Objects whose momenta are changed by an uncertainty source. The shifts of the taus and of the jets are propagated
+// to the MET. A source that changes none of them affects only the event weights.
+struct UncertaintyTargets {
+    bool taus{false}, electrons{false}, muons{false}, jets{false}, met{false};
+
+    constexpr bool IsWeightOnly() const { return !taus && !electrons && !muons && !jets && !met; }
+};
+
+// All sources are listed explicitly, so that a new source can't be classified as weight-only by omission.
+constexpr UncertaintyTargets GetUncertaintyTargets(UncertaintySource unc_source)
+{
+    UncertaintyTargets targets;
+    switch(unc_source) {
+    case UncertaintySource::TauES: case UncertaintySource::EleFakingTauES: case UncertaintySource::TauES_DM0:
+    case UncertaintySource::TauES_DM1: case UncertaintySource::TauES_DM10: case UncertaintySource::TauES_DM11:
+    case UncertaintySource::EleFakingTauES_DM0: case UncertaintySource::EleFakingTauES_DM1:
+    case UncertaintySource::EleFakingTauES_3prong: case UncertaintySource::MuFakingTauES_DM0:
+    case UncertaintySource::MuFakingTauES_DM1: case UncertaintySource::MuFakingTauES_3prong:
+    case UncertaintySource::MuFakingTauES:
+        targets.taus = true;
+        targets.met = true;
+        return targets;
+    case UncertaintySource::JetFull_Total: case UncertaintySource::JetFull_AbsoluteStat:
+    case UncertaintySource::JetFull_AbsoluteScale: case UncertaintySource::JetFull_AbsoluteMPFBias:
+    case UncertaintySource::JetFull_AbsoluteFlavMap: case UncertaintySource::JetFull_Fragmentation:
+    case UncertaintySource::JetFull_SinglePionECAL: case UncertaintySource::JetFull_SinglePionHCAL:
+    case UncertaintySource::JetFull_FlavorQCD: case UncertaintySource::JetFull_FlavorZJet:
+    case UncertaintySource::JetFull_FlavorPhotonJet: case UncertaintySource::JetFull_FlavorPureGluon:
+    case UncertaintySource::JetFull_FlavorPureQuark: case UncertaintySource::JetFull_FlavorPureCharm:
+    case UncertaintySource::JetFull_FlavorPureBottom: case UncertaintySource::JetFull_TimePtEta:
+    case UncertaintySource::JetFull_RelativeJEREC1: case UncertaintySource::JetFull_RelativeJEREC2:
+    case UncertaintySource::JetFull_RelativeJERHF: case UncertaintySource::JetFull_RelativePtBB:
+    case UncertaintySource::JetFull_RelativePtEC1: case UncertaintySource::JetFull_RelativePtEC2:
+    case UncertaintySource::JetFull_RelativePtHF: case UncertaintySource::JetFull_RelativeBal:
+    case UncertaintySource::JetFull_RelativeFSR: case UncertaintySource::JetFull_PileUpDataMC:
+    case UncertaintySource::JetFull_PileUpPtRef: case UncertaintySource::JetFull_PileUpPtBB:
+    case UncertaintySource::JetFull_PileUpPtEC1: case UncertaintySource::JetFull_PileUpPtEC2:
+    case UncertaintySource::JetFull_PileUpPtHF: case UncertaintySource::JetFull_SubTotalPileUp:
+    case UncertaintySource::JetFull_SubTotalRelative: case UncertaintySource::JetFull_SubTotalPt:
+    case UncertaintySource::JetFull_SubTotalScale: case UncertaintySource::JetFull_SubTotalAbsolute:
+    case UncertaintySource::JetFull_SubTotalMC: case UncertaintySource::JetFull_TotalNoFlavor:
+    case UncertaintySource::JetFull_TotalNoTime: case UncertaintySource::JetFull_TotalNoFlavorNoTime:
+    case UncertaintySource::JetReduced_Absolute: case UncertaintySource::JetReduced_Absolute_year:
+    case UncertaintySource::JetReduced_BBEC1: case UncertaintySource::JetReduced_BBEC1_year:
+    case UncertaintySource::JetReduced_EC2: case UncertaintySource::JetReduced_EC2_year:
+    case UncertaintySource::JetReduced_FlavorQCD: case UncertaintySource::JetReduced_HF:
+    case UncertaintySource::JetReduced_HF_year: case UncertaintySource::JetReduced_RelativeBal:
+    case UncertaintySource::JetReduced_RelativeSample_year: case UncertaintySource::JetReduced_Total:
+        targets.jets = true;
+        targets.met = true;
+        return targets;
+    case UncertaintySource::None:
+    case UncertaintySource::TopPt: case UncertaintySource::Lumi: case UncertaintySource::QCDscale_W:
+    case UncertaintySource::QCDscale_WW: case UncertaintySource::QCDscale_WZ: case UncertaintySource::QCDscale_ZZ:
+    case UncertaintySource::QCDscale_EWK: case UncertaintySource::QCDscale_ttbar: case UncertaintySource::QCDscale_tW:
+    case UncertaintySource::QCDscale_ZH: case UncertaintySource::QCDscale_ggHH: case UncertaintySource::pdf_ggHH:
+    case UncertaintySource::BR_SM_H_bb: case UncertaintySource::BR_SM_H_tautau: case UncertaintySource::Eff_b:
+    case UncertaintySource::Eff_e: case UncertaintySource::Eff_m: case UncertaintySource::DY_0b_vLowPt:
+    case UncertaintySource::DY_0b_LowPt: case UncertaintySource::DY_0b_Med1Pt: case UncertaintySource::DY_0b_Med2Pt:
+    case UncertaintySource::DY_0b_HighPt: case UncertaintySource::DY_0b_vHighPt: case UncertaintySource::DY_1b_vLowPt:
+    case UncertaintySource::DY_1b_LowPt: case UncertaintySource::DY_1b_Med1Pt: case UncertaintySource::DY_1b_Med2Pt:
+    case UncertaintySource::DY_1b_HighPt: case UncertaintySource::DY_1b_vHighPt: case UncertaintySource::DY_2b_vLowPt:
+    case UncertaintySource::DY_2b_LowPt: case UncertaintySource::DY_2b_Med1Pt: case UncertaintySource::DY_2b_Med2Pt:
+    case UncertaintySource::DY_2b_HighPt: case UncertaintySource::DY_2b_vHighPt: case UncertaintySource::Qcd_norm:
+    case UncertaintySource::Qcd_sf_stat_unc: case UncertaintySource::Qcd_sf_extrap_unc:
+    case UncertaintySource::TauTriggerUnc: case UncertaintySource::EleTriggerUnc:
+    case UncertaintySource::MuonTriggerUnc: case UncertaintySource::TauVSjetSF_DM0:
+    case UncertaintySource::TauVSjetSF_DM1: case UncertaintySource::TauVSjetSF_3prong:
+    case UncertaintySource::TauVSjetSF_pt20to25: case UncertaintySource::TauVSjetSF_pt25to30:
+    case UncertaintySource::TauVSjetSF_pt30to35: case UncertaintySource::TauVSjetSF_pt35to40:
+    case UncertaintySource::TauVSjetSF_ptgt40: case UncertaintySource::TauVSeSF_barrel:
+    case UncertaintySource::TauVSeSF_endcap: case UncertaintySource::TauVSmuSF_etaLt0p4:
+    case UncertaintySource::TauVSmuSF_eta0p4to0p8: case UncertaintySource::TauVSmuSF_eta0p8to1p2:
+    case UncertaintySource::TauVSmuSF_eta1p2to1p7: case UncertaintySource::TauVSmuSF_etaGt1p7:
+    case UncertaintySource::EleIdIsoUnc: case UncertaintySource::MuonIdIsoUnc:
+    case UncertaintySource::TauTriggerUnc_DM0: case UncertaintySource::TauTriggerUnc_DM1:
+    case UncertaintySource::TauTriggerUnc_DM10: case UncertaintySource::TauTriggerUnc_DM11:
+    case UncertaintySource::L1_prefiring: case UncertaintySource::PileUp: case UncertaintySource::PileUpJetId_eff:
+    case UncertaintySource::PileUpJetId_mistag: case UncertaintySource::TauCustomSF_DM0:
+    case UncertaintySource::TauCustomSF_DM1: case UncertaintySource::TauCustomSF_DM10:
+    case UncertaintySource::TauCustomSF_DM11:
+        return targets;
+    }
+    throw exception("Unknown uncertainty source = %1%.") % static_cast<int>(unc_source);
+}
+
+constexpr bool IsWeightOnlyUncertainty(UncertaintySource unc_source)
+{
+    return GetUncertaintyTargets(unc_source).IsWeightOnly();
+}
+
+static_assert(IsWeightOnlyUncertainty(UncertaintySource::Eff_b), "b-tag SF uncertainty should be weight-only.");
+static_assert(!IsWeightOnlyUncertainty(UncertaintySource::TauES), "TauES uncertainty should shift the taus.");
+static_assert(!IsWeightOnlyUncertainty(UncertaintySource::JetReduced_Total), "JES uncertainty should shift the jets.");
+
 const std::set<UncertaintyScale>& GetAllUncertaintyScales();
 const std::set<UncertaintyScale>& GetActiveUncertaintyScales(UncertaintySource unc_source);
 template<typename Collection>
@@ -229,6 +324,25 @@ std::vector<std::pair<UncertaintySource, UncertaintyScale>> EnumerateUncVariatio
     return result;
 }
 
+// Variations for which the candidates, the selection and the fits should be recomputed, and the variations of the
+// weight-only sources, whose candidates are identical to the central ones.
+struct UncVariationPlan {
+    std::vector<std::pair<UncertaintySource, UncertaintyScale>> computed, aliased_to_central;
+};
+
+template<typename Collection>
+UncVariationPlan CreateUncVariationPlan(const Collection& unc_sources)
+{
+    UncVariationPlan plan;
+    for(const auto& variation : EnumerateUncVariations(unc_sources)) {
+        const bool is_central = variation.first == UncertaintySource::None;
+        auto& target = is_central || !IsWeightOnlyUncertainty(variation.first) ? plan.computed
+                                                                                : plan.aliased_to_central;
+        target.push_back(variation);
+    }
+    return plan;
+}
+
 enum class DiscriminatorWP { VVVLoose = 0, VVLoose = 1, VLoose = 2, Loose = 3, Medium = 4, Tight = 5,
                              VTight = 6, VVTight = 7, VVVTight = 8 };
 ENUM_NAMES(DiscriminatorWP) = {
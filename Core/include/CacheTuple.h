@@ -7,6 +7,14 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 namespace cache_tuple {
 using LorentzVectorM = ntuple::LorentzVectorM;
+
+// Processing stages of the cache production. The per-stage vectors of the CacheSummaryTuple are indexed by them.
+enum class CacheProdStage { Read = 0, Candidate = 1, Selection = 2, SVfit = 3, KinFit = 4, HHbtag = 5, Write = 6 };
+ENUM_NAMES(CacheProdStage) = {
+    { CacheProdStage::Read, "read" }, { CacheProdStage::Candidate, "candidate" },
+    { CacheProdStage::Selection, "selection" }, { CacheProdStage::SVfit, "SVfit" },
+    { CacheProdStage::KinFit, "KinFit" }, { CacheProdStage::HHbtag, "HHbtag" }, { CacheProdStage::Write, "write" }
+};
 }
 
 #define CACHE_DATA() \
@@ -20,6 +28,7 @@ using LorentzVectorM = ntuple::LorentzVectorM;
     VAR(std::vector<Float_t>, SVfit_mt_error) /* SVfit: error on transverse mass */ \
     VAR(std::vector<Int_t>, SVfit_unc_source) /* SVfit: uncertainty source */ \
     VAR(std::vector<Int_t>, SVfit_unc_scale) /* SVfit: uncertainty scale */ \
+    VAR(std::vector<Int_t>, SVfit_mode) /* SVfit: integration mode (sv_fit_ana::SVfitMode) */ \
     /* HHKinFit variables */ \
     VAR(std::vector<UInt_t>, kinFit_htt_index) /* HHKinFit: H->tautau index */ \
     VAR(std::vector<UInt_t>, kinFit_hbb_index) /* HHKinFit: H->bb index */\
@@ -53,6 +62,31 @@ INITIALIZE_TREE(cache_tuple, CacheTuple, CACHE_DATA)
     VAR(Int_t, n_SVfit) /* number of times the SVfit algo was executed */ \
     VAR(Int_t, n_KinFit) /* number of times the HHKinFit algo was executed */ \
     VAR(Int_t, n_HHbtag) /* number of times the HH-btag algo was executed */ \
+    VAR(Int_t, n_SVfit_reused) /* number of SVfit results copied from the input cache */ \
+    VAR(Int_t, n_KinFit_reused) /* number of HHKinFit results copied from the input cache */ \
+    VAR(Int_t, n_HHbtag_reused) /* number of HH-btag results copied from the input cache */ \
+    VAR(Int_t, n_fit_store_hits) /* number of SVfit and KinFit results taken from the fit result store */ \
+    VAR(Int_t, n_fit_store_misses) /* number of SVfit and KinFit results not found in the fit result store */ \
+    VAR(Int_t, n_aliased_variations) /* number of weight-only event variations that were aliased to central */ \
+    /* Estimated from the average uncompressed entry size of the branches (two-phase read mode only) */ \
+    VAR(Double_t, input_bytes_estimate) /* bytes decompressed from the original EventTuple */ \
+    VAR(Double_t, input_bytes_single_phase_estimate) /* bytes that would be decompressed in the single-phase mode */ \
+    /* SVfit settings */ \
+    VAR(Int_t, SVfit_mode) /* SVfit integration mode (sv_fit_ana::SVfitMode) */ \
+    VAR(Int_t, SVfit_max_evaluations) /* maximal number of SVfit integrand evaluations */ \
+    VAR(Float_t, SVfit_adaptive_tolerance) /* relative tolerance on the mass in the adaptive SVfit mode */ \
+    VAR(Int_t, SVfit_adaptive_min_evaluations) /* initial number of evaluations in the adaptive SVfit mode */ \
+    /* Per-stage timing, indexed by CacheProdStage */ \
+    VAR(std::vector<Int_t>, stage_n_calls) /* number of times the stage was executed */ \
+    VAR(std::vector<Float_t>, stage_time) /* total wall time spent in the stage, in s */ \
+    VAR(std::vector<Float_t>, stage_time_p50) /* median latency of the stage, in ms */ \
+    VAR(std::vector<Float_t>, stage_time_p90) /* 90% quantile of the stage latency, in ms */ \
+    VAR(std::vector<Float_t>, stage_time_p99) /* 99% quantile of the stage latency, in ms */ \
+    VAR(std::vector<Float_t>, stage_time_max) /* maximal latency of the stage, in ms */ \
+    /* Slowest events */ \
+    VAR(std::vector<Int_t>, slow_entry_channel) /* channel of the original tuple of the slowest events */ \
+    VAR(std::vector<Long64_t>, slow_entry_index) /* entry index in the original tuple of the slowest events */ \
+    VAR(std::vector<Float_t>, slow_entry_time) /* processing time of the slowest events, in ms */ \
     /**/
 
 #define VAR(type, name) DECLARE_BRANCH_VARIABLE(type, name)
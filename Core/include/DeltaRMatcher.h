@@ -0,0 +1,184 @@
+/*! Eta-phi binned matching of a collection of objects within a maximal deltaR.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <boost/optional.hpp>
+#include <Math/VectorUtil.h>
+#include "AnalysisTools/Core/include/AnalysisMath.h"
+
+namespace analysis {
+
+// Spatial index over a target collection which is built once per event and answers "closest target within deltaR"
+// queries by looking only at the 3x3 neighbourhood of eta-phi cells around the query. The cell size is not smaller
+// than max_deltaR in both directions, so the neighbourhood contains all targets which can pass the deltaR cut.
+// Phi cells wrap around. Targets with non-finite eta or phi are always checked explicitly.
+// The results are identical to the brute-force loop over all targets: the first target with the strictly smallest
+// deltaR below max_deltaR is chosen, where deltaR is computed as ROOT::Math::VectorUtil::DeltaR(target, query).
+template<typename LVector>
+class DeltaRMatcher {
+public:
+    using Index = boost::optional<size_t>;
+
+    DeltaRMatcher(const std::vector<LVector>& _targets, double _max_deltaR) :
+        targets(&_targets), max_deltaR(_max_deltaR)
+    {
+        static constexpr size_t max_n_phi_cells = 64;
+        if(!(max_deltaR > 0))
+            throw exception("Invalid max deltaR = %1% for DeltaRMatcher.") % max_deltaR;
+
+        // The cells are slightly wider than max_deltaR to be robust against the rounding in the cell computation.
+        eta_cell_width = max_deltaR * (1 + 1e-6);
+        n_phi_cells = std::min(max_n_phi_cells, std::max<size_t>(1, static_cast<size_t>(2 * M_PI / eta_cell_width)));
+        phi_cell_width = 2 * M_PI / n_phi_cells;
+
+        std::vector<size_t> target_cells(targets->size(), unbinned);
+        bool has_binned = false;
+        for(size_t n = 0; n < targets->size(); ++n) {
+            const double eta = targets->at(n).eta();
+            if(!std::isfinite(eta) || !std::isfinite(targets->at(n).phi())) continue;
+            if(!has_binned || eta < eta_min) eta_min = eta;
+            if(!has_binned || eta > eta_max) eta_max = eta;
+            has_binned = true;
+        }
+        n_eta_cells = has_binned ? static_cast<size_t>(std::floor((eta_max - eta_min) / eta_cell_width)) + 1 : 0;
+
+        cell_offsets.assign(n_eta_cells * n_phi_cells + 1, 0);
+        for(size_t n = 0; n < targets->size(); ++n) {
+            const auto& p4 = targets->at(n);
+            if(!std::isfinite(p4.eta()) || !std::isfinite(p4.phi())) {
+                unbinned_indices.push_back(n);
+                continue;
+            }
+            target_cells.at(n) = GetCell(EtaCell(p4.eta()), PhiCell(p4.phi()));
+            ++cell_offsets.at(target_cells.at(n) + 1);
+        }
+        for(size_t n = 1; n < cell_offsets.size(); ++n)
+            cell_offsets.at(n) += cell_offsets.at(n - 1);
+        cell_indices.resize(cell_offsets.back());
+        std::vector<size_t> fill_pos(cell_offsets.begin(), cell_offsets.end() - 1);
+        for(size_t n = 0; n < targets->size(); ++n) {
+            if(target_cells.at(n) != unbinned)
+                cell_indices.at(fill_pos.at(target_cells.at(n))++) = n;
+        }
+    }
+
+    size_t size() const { return targets->size(); }
+    double GetMaxDeltaR() const { return max_deltaR; }
+
+    template<typename QueryVector>
+    Index FindBestMatch(const QueryVector& query) const
+    {
+        Index best;
+        double best_deltaR = max_deltaR;
+        const auto check = [&](size_t index) {
+            const double deltaR = ROOT::Math::VectorUtil::DeltaR(targets->at(index), query);
+            if(deltaR < best_deltaR || (best && deltaR == best_deltaR && index < *best)) {
+                best_deltaR = deltaR;
+                best = index;
+            }
+        };
+        ForEachCandidate(query, check);
+        return best;
+    }
+
+    // Indices of all targets within max_deltaR from the query, in increasing order.
+    template<typename QueryVector>
+    std::vector<size_t> FindAllMatches(const QueryVector& query) const
+    {
+        std::vector<size_t> matches;
+        ForEachCandidate(query, [&](size_t index) {
+            if(ROOT::Math::VectorUtil::DeltaR(targets->at(index), query) < max_deltaR)
+                matches.push_back(index);
+        });
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    }
+
+    // Batched version of FindBestMatch for a whole collection. get_p4 extracts the momentum of a collection item.
+    template<typename Collection, typename GetMomentum>
+    std::vector<Index> FindBestMatches(const Collection& collection, GetMomentum&& get_p4) const
+    {
+        std::vector<Index> matches;
+        matches.reserve(collection.size());
+        for(const auto& item : collection)
+            matches.push_back(FindBestMatch(get_p4(item)));
+        return matches;
+    }
+
+    template<typename QueryVector>
+    std::vector<Index> FindBestMatches(const std::vector<QueryVector>& collection) const
+    {
+        return FindBestMatches(collection, [](const QueryVector& p4) -> const QueryVector& { return p4; });
+    }
+
+private:
+    static constexpr size_t unbinned = std::numeric_limits<size_t>::max();
+
+    size_t EtaCell(double eta) const
+    {
+        return std::min(n_eta_cells - 1, static_cast<size_t>(std::floor((eta - eta_min) / eta_cell_width)));
+    }
+
+    size_t PhiCell(double phi) const
+    {
+        const double shifted = std::fmod(phi + M_PI, 2 * M_PI);
+        const double positive = shifted < 0 ? shifted + 2 * M_PI : shifted;
+        return std::min(n_phi_cells - 1, static_cast<size_t>(positive / phi_cell_width));
+    }
+
+    size_t GetCell(size_t eta_cell, size_t phi_cell) const { return eta_cell * n_phi_cells + phi_cell; }
+
+    // Calls function(index) for each target that can be within max_deltaR from the query. Each target is visited
+    // at most once.
+    template<typename QueryVector, typename Function>
+    void ForEachCandidate(const QueryVector& query, Function&& function) const
+    {
+        for(size_t index : unbinned_indices)
+            function(index);
+        if(!n_eta_cells) return;
+
+        const double eta = query.eta(), phi = query.phi();
+        if(!std::isfinite(eta) || !std::isfinite(phi)) {
+            for(size_t index : cell_indices)
+                function(index);
+            return;
+        }
+        if(eta < eta_min - max_deltaR || eta > eta_max + max_deltaR) return;
+
+        const long query_eta_cell = static_cast<long>(std::floor((eta - eta_min) / eta_cell_width));
+        const size_t first_eta_cell = static_cast<size_t>(std::max(0L, query_eta_cell - 1));
+        const size_t last_eta_cell = static_cast<size_t>(std::min(static_cast<long>(n_eta_cells) - 1,
+                                                                  query_eta_cell + 1));
+
+        const size_t query_phi_cell = PhiCell(phi);
+        size_t phi_cells[3];
+        size_t n_phi_neighbours = 0;
+        for(size_t shift : { n_phi_cells - 1, size_t(0), size_t(1) }) {
+            const size_t phi_cell = (query_phi_cell + shift) % n_phi_cells;
+            if(std::find(phi_cells, phi_cells + n_phi_neighbours, phi_cell) == phi_cells + n_phi_neighbours)
+                phi_cells[n_phi_neighbours++] = phi_cell;
+        }
+
+        for(size_t eta_cell = first_eta_cell; eta_cell <= last_eta_cell; ++eta_cell) {
+            for(size_t k = 0; k < n_phi_neighbours; ++k) {
+                const size_t cell = GetCell(eta_cell, phi_cells[k]);
+                for(size_t pos = cell_offsets.at(cell); pos < cell_offsets.at(cell + 1); ++pos)
+                    function(cell_indices.at(pos));
+            }
+        }
+    }
+
+private:
+    const std::vector<LVector>* targets;
+    double max_deltaR;
+    double eta_min{0}, eta_max{0}, eta_cell_width{0}, phi_cell_width{0};
+    size_t n_eta_cells{0}, n_phi_cells{0};
+    std::vector<size_t> cell_offsets, cell_indices, unbinned_indices;
+};
+
+} // namespace analysis
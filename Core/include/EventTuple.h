@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <Compression.h>
 #include "AnalysisTools/Core/include/SmartTree.h"
 #include "AnalysisTools/Core/include/AnalysisMath.h"
 #include "DiscriminatorIdResults.h"
@@ -149,6 +150,7 @@ using Point3D = analysis::Point3D_Float;
     VAR(std::vector<Float_t>, SVfit_mt_error) /* SVfit: error on transverse mass */ \
     VAR(std::vector<Int_t>, SVfit_unc_source) /* SVfit: uncertainty source */ \
     VAR(std::vector<Int_t>, SVfit_unc_scale) /* SVfit: uncertainty scale */ \
+    VAR(std::vector<Int_t>, SVfit_mode) /* SVfit: integration mode (sv_fit_ana::SVfitMode) */ \
     /* Signal leptons */ \
     LEG_DATA() /* muon, electron or tau */ \
     TAU_IDS() /* raw values of tau ID discriminators */ \
@@ -233,6 +235,19 @@ DECLARE_TREE(ntuple, Event, EventTuple, EVENT_DATA, "events")
 #define VAR(type, name) ADD_DATA_TREE_BRANCH(name)
 INITIALIZE_TREE(ntuple, EventTuple, EVENT_DATA)
 #undef VAR
+
+namespace ntuple {
+// Exchanges the content of all branches. Vector branches exchange their buffers, so an event can be transferred
+// from an input to an output tuple without allocating or copying the payload.
+#define VAR(type, name) swap(first.name, second.name);
+inline void swap(Event& first, Event& second)
+{
+    using std::swap;
+    EVENT_DATA()
+}
+#undef VAR
+} // namespace ntuple
+
 #undef EVENT_DATA
 #undef LEG_DATA
 #undef LVAR
@@ -272,6 +287,23 @@ struct LegPair : std::pair<size_t, size_t> {
     static const LegPair Undefined;
 };
 
+// Compression of the EventTuple output branches. A rule applies to all branches with the given name prefix.
+// Rules are checked in order, and the last rule with an empty prefix is the default.
+struct BranchCompressionRule {
+    std::string prefix;
+    ROOT::ECompressionAlgorithm algorithm;
+    int level;
+
+    int GetSettings() const;
+};
+
+const std::vector<BranchCompressionRule>& GetEventBranchCompressionRules();
+const BranchCompressionRule& FindEventBranchCompressionRule(const std::string& branch_name);
+void ApplyEventBranchCompression(TTree& tree);
+// Checks that all active branches of the tree (including sub-branches) are compressed as defined by the rules.
+bool HasEventBranchCompression(TTree& tree);
+
+const std::set<std::string>& GetDisabledBranches(TreeState treeState);
 std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory* directory,
                                              bool readMode, TreeState treeState);
 } // namespace ntuple
@@ -0,0 +1,15 @@
+/*! Identification of a file by the size and hash of its content.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace analysis {
+
+// Reads the whole file and computes its size and the 64-bit FNV-1a hash of its content.
+// Returns false if the file can't be opened.
+bool GetFileId(const std::string& file_name, uint64_t& size, uint64_t& hash);
+
+} // namespace analysis
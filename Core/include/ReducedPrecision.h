@@ -0,0 +1,67 @@
+/*! Reduced-precision storage of the gen-level and auxiliary 4-momenta of the EventTuple.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include "EventTuple.h"
+
+namespace ntuple {
+
+// Rounds a float to the nearest value with only n_mantissa_bits explicit mantissa bits (out of 23).
+// The dropped bits are set to zero, so values remain ordinary floats and are read back without any conversion,
+// while the compressor removes the zeroed bits. The relative rounding error is at most 2^-(n_mantissa_bits + 1).
+float TruncateMantissa(float value, unsigned n_mantissa_bits);
+
+template<typename LVector>
+LVector TruncateMantissa(const LVector& p4, unsigned n_mantissa_bits)
+{
+    typename LVector::Scalar coordinates[4];
+    p4.GetCoordinates(coordinates);
+    for(auto& c : coordinates)
+        c = TruncateMantissa(c, n_mantissa_bits);
+    LVector result;
+    result.SetCoordinates(coordinates);
+    return result;
+}
+
+// Precision budget of the reduced-precision storage mode. Each coordinate (pt, eta, phi, mass or energy)
+// is truncated separately, so the maximal relative error of every coordinate is 2^-(n_mantissa_bits + 1):
+//     genParticles_p4, lhe_p4, genJets_p4      10 bits, 4.9e-4 (phi: < 1.6e-3 rad)
+//     lep_gen_p4, lep_gen_visible_p4,
+//     other_lepton_gen_p4, genMET_p4           12 bits, 1.2e-4 (phi: < 3.9e-4 rad)
+// Reconstructed objects are never truncated.
+struct ReducedPrecisionEntry {
+    std::string branch_name;
+    unsigned n_mantissa_bits;
+};
+
+const std::vector<ReducedPrecisionEntry>& GetReducedPrecisionBudget();
+
+// Calls function(entry, p4) for each branch of the precision budget, where p4 is either a single 4-momentum
+// or a collection of them.
+template<typename EventType, typename Function>
+void ForEachReducedPrecisionBranch(EventType& event, Function&& function)
+{
+    for(const auto& entry : GetReducedPrecisionBudget()) {
+        if(entry.branch_name == "genParticles_p4")
+            function(entry, event.genParticles_p4);
+        else if(entry.branch_name == "lhe_p4")
+            function(entry, event.lhe_p4);
+        else if(entry.branch_name == "genJets_p4")
+            function(entry, event.genJets_p4);
+        else if(entry.branch_name == "lep_gen_p4")
+            function(entry, event.lep_gen_p4);
+        else if(entry.branch_name == "lep_gen_visible_p4")
+            function(entry, event.lep_gen_visible_p4);
+        else if(entry.branch_name == "other_lepton_gen_p4")
+            function(entry, event.other_lepton_gen_p4);
+        else if(entry.branch_name == "genMET_p4")
+            function(entry, event.genMET_p4);
+        else
+            throw analysis::exception("Reduced precision is not supported for branch '%1%'.") % entry.branch_name;
+    }
+}
+
+void ReduceEventPrecision(Event& event);
+
+} // namespace ntuple
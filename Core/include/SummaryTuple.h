@@ -67,6 +67,17 @@ DECLARE_TREE(ntuple, ExpressEvent, ExpressTuple, EVENT_EXPRESS_DATA, "all_events
 #define VAR(type, name) ADD_DATA_TREE_BRANCH(name)
 INITIALIZE_TREE(ntuple, ExpressTuple, EVENT_EXPRESS_DATA)
 #undef VAR
+
+namespace ntuple {
+#define VAR(type, name) swap(first.name, second.name);
+inline void swap(ExpressEvent& first, ExpressEvent& second)
+{
+    using std::swap;
+    EVENT_EXPRESS_DATA()
+}
+#undef VAR
+} // namespace ntuple
+
 #undef SUMMARY_DATA
 
 namespace ntuple {
@@ -0,0 +1,48 @@
+/*! Two-phase reading of the EventTuple: pre-selection branches first, the rest of the entry on demand.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <ostream>
+#include "EventTuple.h"
+
+namespace ntuple {
+
+// Branches that are required by the event pre-selection: MET filters and the extra lepton veto.
+// The event id branches are included to identify the event in the error messages.
+const std::set<std::string>& GetPreselectionBranches();
+
+// Number of bytes decompressed from the input tuple. The per-entry sizes are averages over the tree computed from
+// the uncompressed branch sizes stored in the tree metadata.
+struct TwoPhaseReadStats {
+    size_t n_entries{0}, n_full_reads{0};
+    double preselection_bytes{0}, full_bytes{0}, single_phase_bytes{0};
+
+    double GetTwoPhaseBytes() const { return preselection_bytes + full_bytes; }
+    void Print(std::ostream& os) const;
+};
+
+// Reads each entry in two phases. ReadPreselection loads only the declared pre-selection branches, and ReadFull
+// loads the whole entry, which should be done only for the events that passed the pre-selection.
+// SmartTree does not allow to change the set of active branches after its creation, so the pre-selection branches
+// are read through a separate tuple. It should be created from a different handle of the same file
+// (preselection_directory), otherwise both tuples would share the same TTree and the branch addresses.
+class TwoPhaseEventTuple {
+public:
+    TwoPhaseEventTuple(const std::string& name, TDirectory* directory, TDirectory* preselection_directory,
+                       TreeState treeState,
+                       const std::set<std::string>& preselection_branches = GetPreselectionBranches());
+
+    const std::shared_ptr<EventTuple>& GetTuple() const { return tuple; }
+    Long64_t GetEntries() const { return tuple->GetEntries(); }
+    const Event& ReadPreselection(Long64_t entry);
+    Event& ReadFull(Long64_t entry);
+    const TwoPhaseReadStats& GetStats() const { return stats; }
+
+private:
+    std::shared_ptr<EventTuple> tuple, preselection_tuple;
+    double preselection_entry_bytes, full_entry_bytes;
+    TwoPhaseReadStats stats;
+};
+
+} // namespace ntuple
@@ -2,6 +2,8 @@
 This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "h-tautau/Core/include/EventTuple.h"
+#include <functional>
+#include <TTree.h>
 #include "AnalysisTools/Core/include/Tools.h"
 
 namespace ntuple {
@@ -31,8 +33,60 @@ LegPair LegPair::FromIndex(size_t index)
     return pair;
 }
 
-std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory* directory,
-                                                    bool readMode, TreeState treeState)
+int BranchCompressionRule::GetSettings() const { return ROOT::CompressionSettings(algorithm, level); }
+
+const std::vector<BranchCompressionRule>& GetEventBranchCompressionRules()
+{
+    // Large gen-level and auxiliary collections are rarely read and use ZSTD for a better compression ratio.
+    // Lepton, jet, MET and event-level columns are read by every analysis step and use LZ4. This includes
+    // other_lepton_*, read for every event by the extra lepton veto, and genJets_*, read by the gen matching.
+    static const std::vector<BranchCompressionRule> rules = {
+        { "genParticles_", ROOT::kZSTD, 6 },
+        { "lhe_", ROOT::kZSTD, 6 },
+        { "fatJets_", ROOT::kZSTD, 6 },
+        { "subJets_", ROOT::kZSTD, 6 },
+        { "", ROOT::kLZ4, 4 },
+    };
+    return rules;
+}
+
+const BranchCompressionRule& FindEventBranchCompressionRule(const std::string& branch_name)
+{
+    for(const auto& rule : GetEventBranchCompressionRules()) {
+        if(branch_name.compare(0, rule.prefix.size(), rule.prefix) == 0)
+            return rule;
+    }
+    throw analysis::exception("Compression rule for branch '%1%' not found.") % branch_name;
+}
+
+void ApplyEventBranchCompression(TTree& tree)
+{
+    for(auto branch_obj : *tree.GetListOfBranches()) {
+        auto branch = dynamic_cast<TBranch*>(branch_obj);
+        branch->SetCompressionSettings(FindEventBranchCompressionRule(branch->GetName()).GetSettings());
+    }
+}
+
+bool HasEventBranchCompression(TTree& tree)
+{
+    const std::function<bool(TBranch&, int)> has_compression = [&](TBranch& branch, int settings) {
+        if(branch.GetCompressionSettings() != settings) return false;
+        for(auto sub_branch_obj : *branch.GetListOfBranches()) {
+            if(!has_compression(*dynamic_cast<TBranch*>(sub_branch_obj), settings)) return false;
+        }
+        return true;
+    };
+
+    for(auto branch_obj : *tree.GetListOfBranches()) {
+        auto branch = dynamic_cast<TBranch*>(branch_obj);
+        if(!tree.GetBranchStatus(branch->GetName())) continue;
+        if(!has_compression(*branch, FindEventBranchCompressionRule(branch->GetName()).GetSettings()))
+            return false;
+    }
+    return true;
+}
+
+const std::set<std::string>& GetDisabledBranches(TreeState treeState)
 {
     static const std::set<std::string> weight_branches = {
         "weight_pu", "weight_pu_up", "weight_pu_down", "weight_dy", "weight_ttbar", "weight_wjets",
@@ -49,7 +103,7 @@ std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory
 
     static const std::set<std::string> SVfit_branches = {
         "SVfit_htt_index", "SVfit_is_valid", "SVfit_p4", "SVfit_p4_error", "SVfit_mt", "SVfit_mt_error",
-        "SVfit_unc_source", "SVfit_unc_scale",
+        "SVfit_unc_source", "SVfit_unc_scale", "SVfit_mode",
     };
 
     static const std::set<std::string> kinFit_branches = {
@@ -73,8 +127,13 @@ std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory
         { TreeState::Skimmed, { } },
     };
 
-    const auto& disabled = disabled_branches.at(treeState);
-    return std::make_shared<EventTuple>(name, directory, readMode, disabled);
+    return disabled_branches.at(treeState);
+}
+
+std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory* directory,
+                                                    bool readMode, TreeState treeState)
+{
+    return std::make_shared<EventTuple>(name, directory, readMode, GetDisabledBranches(treeState));
 }
 
 } // namespace ntuple
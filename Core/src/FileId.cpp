@@ -0,0 +1,30 @@
+/*! Identification of a file by the size and hash of its content.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Core/include/FileId.h"
+#include <fstream>
+#include <vector>
+
+namespace analysis {
+
+bool GetFileId(const std::string& file_name, uint64_t& size, uint64_t& hash)
+{
+    static constexpr uint64_t fnv_offset = 0xCBF29CE484222325ULL, fnv_prime = 0x100000001B3ULL;
+    std::ifstream is(file_name, std::ios::binary);
+    if(is.fail()) return false;
+    size = 0;
+    hash = fnv_offset;
+    std::vector<char> buffer(1 << 16);
+    while(is) {
+        is.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const size_t n_read = static_cast<size_t>(is.gcount());
+        for(size_t n = 0; n < n_read; ++n) {
+            hash ^= static_cast<unsigned char>(buffer[n]);
+            hash *= fnv_prime;
+        }
+        size += n_read;
+    }
+    return true;
+}
+
+} // namespace analysis
@@ -0,0 +1,58 @@
+/*! Reduced-precision storage of the gen-level and auxiliary 4-momenta of the EventTuple.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Core/include/ReducedPrecision.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace ntuple {
+
+float TruncateMantissa(float value, unsigned n_mantissa_bits)
+{
+    static constexpr unsigned n_float_mantissa_bits = 23;
+    if(n_mantissa_bits >= n_float_mantissa_bits || !std::isfinite(value))
+        return value;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const unsigned n_dropped = n_float_mantissa_bits - n_mantissa_bits;
+    const uint32_t half = uint32_t(1) << (n_dropped - 1);
+    const uint32_t mask = ~((uint32_t(1) << n_dropped) - 1);
+    bits = (bits + half) & mask;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return std::isfinite(result) ? result : value;
+}
+
+const std::vector<ReducedPrecisionEntry>& GetReducedPrecisionBudget()
+{
+    static const std::vector<ReducedPrecisionEntry> budget = {
+        { "genParticles_p4", 10 }, { "lhe_p4", 10 }, { "genJets_p4", 10 },
+        { "lep_gen_p4", 12 }, { "lep_gen_visible_p4", 12 }, { "other_lepton_gen_p4", 12 }, { "genMET_p4", 12 },
+    };
+    return budget;
+}
+
+namespace {
+struct PrecisionReducer {
+    template<typename LVector>
+    void operator()(const ReducedPrecisionEntry& entry, LVector& p4) const
+    {
+        p4 = TruncateMantissa(p4, entry.n_mantissa_bits);
+    }
+
+    template<typename LVector>
+    void operator()(const ReducedPrecisionEntry& entry, std::vector<LVector>& collection) const
+    {
+        for(auto& p4 : collection)
+            p4 = TruncateMantissa(p4, entry.n_mantissa_bits);
+    }
+};
+} // anonymous namespace
+
+void ReduceEventPrecision(Event& event)
+{
+    ForEachReducedPrecisionBranch(event, PrecisionReducer());
+}
+
+} // namespace ntuple
@@ -0,0 +1,97 @@
+/*! Two-phase reading of the EventTuple: pre-selection branches first, the rest of the entry on demand.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Core/include/TwoPhaseEventTuple.h"
+#include <TTree.h>
+#include "AnalysisTools/Core/include/RootExt.h"
+
+namespace ntuple {
+
+namespace {
+std::vector<std::string> GetBranchNames(TTree& tree)
+{
+    std::vector<std::string> names;
+    for(auto branch_obj : *tree.GetListOfBranches())
+        names.push_back(branch_obj->GetName());
+    return names;
+}
+
+// Average uncompressed size of an entry of the given branches, including their sub-branches.
+double GetEntryBytes(TTree& tree, const std::vector<std::string>& branch_names)
+{
+    if(tree.GetEntries() <= 0) return 0;
+    double total_bytes = 0;
+    for(const std::string& name : branch_names)
+        total_bytes += static_cast<double>(tree.GetBranch(name.c_str())->GetTotBytes("*"));
+    return total_bytes / static_cast<double>(tree.GetEntries());
+}
+} // anonymous namespace
+
+const std::set<std::string>& GetPreselectionBranches()
+{
+    static const std::set<std::string> branches = {
+        "run", "lumi", "evt", "metFilters", "other_lepton_type", "other_lepton_eleId_iso",
+        "other_lepton_eleId_noIso", "other_lepton_muonId", "other_lepton_iso",
+    };
+    return branches;
+}
+
+void TwoPhaseReadStats::Print(std::ostream& os) const
+{
+    static constexpr double MB = 1024 * 1024;
+    const double ratio = single_phase_bytes > 0 ? GetTwoPhaseBytes() / single_phase_bytes : 1.;
+    os << "Two-phase read: " << n_entries << " entries, " << n_full_reads << " fully read. Estimated decompressed "
+       << GetTwoPhaseBytes() / MB << " MB (pre-selection " << preselection_bytes / MB << " MB + full "
+       << full_bytes / MB << " MB) instead of " << single_phase_bytes / MB << " MB (ratio = " << ratio << ")."
+       << std::endl;
+}
+
+TwoPhaseEventTuple::TwoPhaseEventTuple(const std::string& name, TDirectory* directory,
+                                       TDirectory* preselection_directory, TreeState treeState,
+                                       const std::set<std::string>& preselection_branches)
+{
+    if(directory == preselection_directory)
+        throw analysis::exception("Two-phase reading of '%1%' requires two different handles of the input file.")
+            % name;
+    TTree* tree = root_ext::ReadObject<TTree>(*preselection_directory, name);
+    const auto& disabled_branches = GetDisabledBranches(treeState);
+    std::set<std::string> preselection_disabled_branches = disabled_branches;
+    std::vector<std::string> enabled_branches, enabled_preselection_branches;
+    for(const std::string& branch_name : GetBranchNames(*tree)) {
+        if(disabled_branches.count(branch_name)) continue;
+        enabled_branches.push_back(branch_name);
+        if(preselection_branches.count(branch_name))
+            enabled_preselection_branches.push_back(branch_name);
+        else
+            preselection_disabled_branches.insert(branch_name);
+    }
+    for(const std::string& branch_name : preselection_branches) {
+        if(!tree->GetBranch(branch_name.c_str()))
+            throw analysis::exception("Pre-selection branch '%1%' not found in '%2%'.") % branch_name % name;
+    }
+    preselection_entry_bytes = GetEntryBytes(*tree, enabled_preselection_branches);
+    full_entry_bytes = GetEntryBytes(*tree, enabled_branches);
+
+    tuple = std::make_shared<EventTuple>(name, directory, true, disabled_branches);
+    preselection_tuple = std::make_shared<EventTuple>(name, preselection_directory, true,
+                                                      preselection_disabled_branches);
+}
+
+const Event& TwoPhaseEventTuple::ReadPreselection(Long64_t entry)
+{
+    preselection_tuple->GetEntry(entry);
+    ++stats.n_entries;
+    stats.preselection_bytes += preselection_entry_bytes;
+    stats.single_phase_bytes += full_entry_bytes;
+    return preselection_tuple->data();
+}
+
+Event& TwoPhaseEventTuple::ReadFull(Long64_t entry)
+{
+    tuple->GetEntry(entry);
+    ++stats.n_full_reads;
+    stats.full_bytes += full_entry_bytes;
+    return (*tuple)();
+}
+
+} // namespace ntuple
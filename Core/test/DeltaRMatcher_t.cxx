@@ -0,0 +1,114 @@
+/*! Test of DeltaRMatcher against the brute-force deltaR matching.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <random>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Core/include/DeltaRMatcher.h"
+#include "h-tautau/Core/include/EventTuple.h"
+
+struct Arguments {
+    run::Argument<size_t> n_events{"n_events", "number of random events", 100000};
+    run::Argument<unsigned> seed{"seed", "random seed", 12345};
+};
+
+namespace analysis {
+
+class DeltaRMatcher_t {
+public:
+    using TargetVector = ntuple::LorentzVectorE;
+    using QueryVector = LorentzVectorM;
+    using Index = boost::optional<size_t>;
+
+    DeltaRMatcher_t(const Arguments& _args) : args(_args), gen(args.seed()) {}
+
+    void Run()
+    {
+        static const std::vector<double> max_deltaR_values = { 0.05, 0.3, 0.4, 0.5, 1., 3.5, 10. };
+        size_t n_queries = 0, n_matched = 0;
+        for(size_t event_id = 0; event_id < args.n_events(); ++event_id) {
+            const auto targets = GenerateCollection<TargetVector>(std::uniform_int_distribution<size_t>(0, 30)(gen));
+            auto queries = GenerateCollection<QueryVector>(std::uniform_int_distribution<size_t>(0, 10)(gen));
+            // Queries that exactly coincide with the targets produce ties between duplicated targets.
+            if(!targets.empty() && event_id % 10 == 0)
+                queries.push_back(QueryVector(targets.front()));
+            for(double max_deltaR : max_deltaR_values) {
+                const DeltaRMatcher<TargetVector> matcher(targets, max_deltaR);
+                const auto matches = matcher.FindBestMatches(queries);
+                for(size_t n = 0; n < queries.size(); ++n) {
+                    const Index expected = BruteForceBestMatch(targets, queries.at(n), max_deltaR);
+                    if(matches.at(n) != expected || matcher.FindBestMatch(queries.at(n)) != expected)
+                        ThrowMismatch("best", event_id, n, max_deltaR);
+                    if(matcher.FindAllMatches(queries.at(n)) != BruteForceAllMatches(targets, queries.at(n),
+                                                                                     max_deltaR))
+                        ThrowMismatch("all", event_id, n, max_deltaR);
+                    ++n_queries;
+                    if(expected) ++n_matched;
+                }
+            }
+        }
+        std::cout << "DeltaRMatcher results are identical to the brute-force matching for " << n_queries
+                  << " queries (" << n_matched << " matched)." << std::endl;
+    }
+
+private:
+    template<typename LVector>
+    std::vector<LVector> GenerateCollection(size_t n_objects)
+    {
+        std::uniform_real_distribution<double> pt_dist(5, 200), eta_dist(-5, 5), phi_dist(-M_PI, M_PI),
+                                               edge_dist(-1e-6, 1e-6);
+        std::uniform_int_distribution<int> kind_dist(0, 9);
+        std::vector<LVector> collection;
+        for(size_t n = 0; n < n_objects; ++n) {
+            const int kind = kind_dist(gen);
+            double phi = phi_dist(gen);
+            if(kind == 0) phi = M_PI + edge_dist(gen);
+            else if(kind == 1) phi = -M_PI + edge_dist(gen);
+            const LorentzVectorM p4(pt_dist(gen), eta_dist(gen), phi, 10);
+            collection.emplace_back(p4);
+            if(kind == 2)
+                collection.emplace_back(p4);
+        }
+        return collection;
+    }
+
+    static Index BruteForceBestMatch(const std::vector<TargetVector>& targets, const QueryVector& query,
+                                     double max_deltaR)
+    {
+        Index result;
+        double min_dR = max_deltaR;
+        for(size_t n = 0; n < targets.size(); ++n) {
+            const double dR = ROOT::Math::VectorUtil::DeltaR(targets.at(n), query);
+            if(dR < min_dR) {
+                min_dR = dR;
+                result = n;
+            }
+        }
+        return result;
+    }
+
+    static std::vector<size_t> BruteForceAllMatches(const std::vector<TargetVector>& targets,
+                                                    const QueryVector& query, double max_deltaR)
+    {
+        std::vector<size_t> result;
+        for(size_t n = 0; n < targets.size(); ++n) {
+            if(ROOT::Math::VectorUtil::DeltaR(targets.at(n), query) < max_deltaR)
+                result.push_back(n);
+        }
+        return result;
+    }
+
+    [[ noreturn ]] static void ThrowMismatch(const std::string& kind, size_t event_id, size_t query_id,
+                                             double max_deltaR)
+    {
+        throw exception("Mismatch in the %1% match for event %2%, query %3%, max deltaR = %4%.")
+                % kind % event_id % query_id % max_deltaR;
+    }
+
+private:
+    Arguments args;
+    std::mt19937_64 gen;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::DeltaRMatcher_t, Arguments)
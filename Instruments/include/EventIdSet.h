@@ -0,0 +1,80 @@
+/*! Compact, memory-bounded set of event identifiers used for duplicate detection.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace analysis {
+
+// (run, lumi, evt) packed into 128 bits.
+struct PackedEventId {
+    uint64_t run_lumi, evt;
+
+    PackedEventId();
+    PackedEventId(uint32_t run, uint32_t lumi, uint64_t evt);
+
+    bool operator==(const PackedEventId& other) const { return run_lumi == other.run_lumi && evt == other.evt; }
+    bool operator!=(const PackedEventId& other) const { return !(*this == other); }
+    bool operator<(const PackedEventId& other) const
+    {
+        return run_lumi != other.run_lumi ? run_lumi < other.run_lumi : evt < other.evt;
+    }
+
+    uint64_t Hash() const;
+};
+
+// Open addressing hash set of packed event ids with linear probing.
+// If max_memory is set and spill_dir is not empty, the in-memory table is sorted and written to a run file
+// in spill_dir each time it would grow above max_memory. Membership in the spilled runs is checked through
+// a per-run Bloom filter followed by a binary search in the run file, so only the filters stay in memory.
+class EventIdSet {
+public:
+    explicit EventIdSet(size_t max_memory = 0, const std::string& spill_dir = "");
+    ~EventIdSet();
+    EventIdSet(const EventIdSet&) = delete;
+    EventIdSet& operator=(const EventIdSet&) = delete;
+
+    // Returns true if id was not present in the set.
+    bool Insert(const PackedEventId& id);
+    bool Contains(const PackedEventId& id) const;
+
+    size_t size() const { return n_entries + n_spilled_entries + (has_empty_key ? 1 : 0); }
+    size_t GetMemoryUsage() const;
+    size_t GetNumberOfSpills() const { return runs.size(); }
+
+private:
+    struct SpilledRun {
+        std::string file_name;
+        size_t n_entries;
+        std::vector<uint64_t> bloom_filter;
+        mutable std::ifstream file;
+
+        bool Contains(const PackedEventId& id) const;
+    };
+
+    static constexpr size_t initial_capacity = 1024;
+    static constexpr size_t max_load_numerator = 7, max_load_denominator = 10;
+    static constexpr size_t bloom_bits_per_entry = 10, bloom_n_hashes = 7;
+
+    size_t FindSlot(const PackedEventId& id) const;
+    bool ContainsInMemory(const PackedEventId& id) const;
+    void Rehash(size_t new_capacity);
+    void Spill();
+    static bool IsEmpty(const PackedEventId& id) { return id == PackedEventId(); }
+    static size_t BloomBit(uint64_t hash, size_t n, size_t n_bits);
+
+private:
+    size_t max_memory;
+    std::string spill_dir;
+    std::vector<PackedEventId> table;
+    size_t n_entries{0}, n_spilled_entries{0};
+    bool has_empty_key{false};
+    std::vector<std::unique_ptr<SpilledRun>> runs;
+};
+
+} // namespace analysis
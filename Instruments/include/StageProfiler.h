@@ -0,0 +1,99 @@
+/*! Low-overhead per-stage latency accumulators for the production jobs.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace analysis {
+
+// Latency accumulator with a log-scale histogram: 4 bins per octave starting from 1 us, which gives quantiles
+// with a relative precision of ~10% up to ~70 min. Adding a measurement costs a few arithmetic operations.
+class LatencyStats {
+public:
+    static constexpr size_t n_bins_per_octave = 4;
+    static constexpr size_t n_bins = 32 * n_bins_per_octave;
+    static constexpr double min_latency = 1e-6;
+
+    void Add(double latency);
+
+    size_t GetCount() const { return count; }
+    double GetTotal() const { return total; }
+    double GetMean() const { return count ? total / count : 0.; }
+    double GetMax() const { return max; }
+    // Estimated latency below which a fraction q of the measurements lies.
+    double GetQuantile(double q) const;
+
+private:
+    static size_t FindBin(double latency);
+    static double GetBinLowEdge(size_t bin);
+
+private:
+    size_t count{0};
+    double total{0}, min{0}, max{0};
+    std::array<uint32_t, n_bins> bins{};
+};
+
+// Collection of named stages. Each timer measures the wall time of its scope and adds it to the stage statistics.
+class StageProfiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(LatencyStats& _stats) : stats(&_stats), start(clock::now()) {}
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ~ScopedTimer() { stats->Add(std::chrono::duration<double>(clock::now() - start).count()); }
+
+    private:
+        LatencyStats* stats;
+        clock::time_point start;
+    };
+
+    explicit StageProfiler(const std::vector<std::string>& _stage_names);
+
+    template<typename Stage>
+    ScopedTimer Measure(Stage stage) { return ScopedTimer(stats.at(static_cast<size_t>(stage))); }
+
+    size_t GetNumberOfStages() const { return stats.size(); }
+    const std::string& GetStageName(size_t stage_id) const { return stage_names.at(stage_id); }
+    const LatencyStats& GetStats(size_t stage_id) const { return stats.at(stage_id); }
+
+    void Print(std::ostream& os) const;
+
+private:
+    std::vector<std::string> stage_names;
+    std::vector<LatencyStats> stats;
+};
+
+// Keeps the max_size entries with the largest processing time. The entry indices are defined within a tree, so each
+// entry also stores the id of the tree it was read from (e.g. the channel).
+class SlowEntryTracker {
+public:
+    struct Entry {
+        double time;
+        int tree_id;
+        int64_t entry_index;
+
+        bool operator>(const Entry& other) const { return time > other.time; }
+    };
+
+    explicit SlowEntryTracker(size_t _max_size = 10) : max_size(_max_size) {}
+
+    void Add(int tree_id, int64_t entry_index, double time);
+    // Slow entries sorted by decreasing time.
+    std::vector<Entry> GetEntries() const;
+
+private:
+    size_t max_size;
+    std::vector<Entry> heap;
+};
+
+} // namespace analysis
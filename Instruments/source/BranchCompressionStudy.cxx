@@ -0,0 +1,160 @@
+/*! Measure size and read throughput of each EventTuple branch for several compression settings.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <chrono>
+#include <TMemFile.h>
+#include <TTree.h>
+#include <boost/algorithm/string.hpp>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Core/include/TextIO.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Core/include/EventTuple.h"
+
+struct Arguments {
+    REQ_ARG(std::string, input);
+    REQ_ARG(std::string, tree_name);
+    OPT_ARG(Long64_t, max_entries, 10000);
+    OPT_ARG(std::string, codecs, "LZ4:4,ZSTD:6,ZLIB:6,LZMA:9");
+};
+
+namespace analysis {
+
+class BranchCompressionStudy {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Codec {
+        std::string name;
+        ROOT::ECompressionAlgorithm algorithm;
+        int level;
+
+        int GetSettings() const { return ROOT::CompressionSettings(algorithm, level); }
+    };
+
+    struct Measurement {
+        Long64_t zip_bytes{0}, tot_bytes{0};
+        double read_time{0};
+
+        Measurement& operator+=(const Measurement& other)
+        {
+            zip_bytes += other.zip_bytes;
+            tot_bytes += other.tot_bytes;
+            read_time += other.read_time;
+            return *this;
+        }
+
+        double GetThroughput() const { return read_time > 0 ? tot_bytes / read_time / 1024. / 1024. : 0.; }
+    };
+
+    BranchCompressionStudy(const Arguments& _args) : args(_args), codecs(ParseCodecs(args.codecs())) {}
+
+    void Run()
+    {
+        auto file = root_ext::OpenRootFile(args.input());
+        auto tree = root_ext::ReadObject<TTree>(*file, args.tree_name());
+        const Long64_t n_entries = std::min(tree->GetEntries(), args.max_entries());
+        std::cout << "Measuring " << n_entries << " entries of '" << args.tree_name() << "'.\n"
+                  << "branch, rule, codec, compressed size (kB), uncompressed size (kB), read throughput (MB/s)\n";
+
+        std::map<std::string, std::vector<Measurement>> rule_measurements;
+        for(auto branch_obj : *tree->GetListOfBranches()) {
+            const std::string branch_name = branch_obj->GetName();
+            const auto& rule = ntuple::FindEventBranchCompressionRule(branch_name);
+            auto& rule_results = rule_measurements[rule.prefix];
+            rule_results.resize(codecs.size());
+            for(size_t n = 0; n < codecs.size(); ++n) {
+                const Measurement m = Measure(*tree, branch_name, codecs.at(n).GetSettings(), n_entries);
+                rule_results.at(n) += m;
+                std::cout << branch_name << ", " << rule.prefix << ", " << codecs.at(n).name << ", "
+                          << m.zip_bytes / 1024. << ", " << m.tot_bytes / 1024. << ", " << m.GetThroughput()
+                          << "\n";
+            }
+        }
+
+        // Hot rules (currently LZ4) should be optimized for the read speed, cold rules for the size.
+        std::cout << "\nProposed settings:\n";
+        for(const auto& rule : ntuple::GetEventBranchCompressionRules()) {
+            if(!rule_measurements.count(rule.prefix)) continue;
+            const auto& results = rule_measurements.at(rule.prefix);
+            const bool is_hot = rule.algorithm == ROOT::kLZ4;
+            size_t best = 0;
+            for(size_t n = 1; n < results.size(); ++n) {
+                const bool is_better = is_hot ? results.at(n).read_time < results.at(best).read_time
+                                              : results.at(n).zip_bytes < results.at(best).zip_bytes;
+                if(is_better)
+                    best = n;
+            }
+            std::cout << "\t{ \"" << rule.prefix << "\", ROOT::k" << ToUpper(codecs.at(best).name) << ", "
+                      << codecs.at(best).level << " }, // " << (is_hot ? "hot" : "cold") << ": "
+                      << results.at(best).zip_bytes / 1024. << " kB, " << results.at(best).GetThroughput()
+                      << " MB/s\n";
+        }
+        std::cout << std::flush;
+    }
+
+private:
+    static std::string ToUpper(const std::string& str) { return boost::algorithm::to_upper_copy(str); }
+
+    static std::vector<Codec> ParseCodecs(const std::string& codecs_str)
+    {
+        static const std::map<std::string, ROOT::ECompressionAlgorithm> algorithms = {
+            { "ZLIB", ROOT::kZLIB }, { "LZMA", ROOT::kLZMA }, { "LZ4", ROOT::kLZ4 }, { "ZSTD", ROOT::kZSTD },
+        };
+        std::vector<Codec> codecs;
+        std::vector<std::string> codec_strs;
+        boost::split(codec_strs, codecs_str, boost::is_any_of(","), boost::token_compress_on);
+        for(const auto& codec_str : codec_strs) {
+            std::vector<std::string> parts;
+            boost::split(parts, codec_str, boost::is_any_of(":"));
+            const std::string name = ToUpper(parts.at(0));
+            if(parts.size() != 2 || !algorithms.count(name))
+                throw exception("Invalid codec '%1%'. Expected format is ALGORITHM:level.") % codec_str;
+            codecs.push_back(Codec{name, algorithms.at(name), Parse<int>(parts.at(1))});
+        }
+        return codecs;
+    }
+
+    // Copies a single branch into an in-memory file with the given compression and measures the time
+    // required to read it back.
+    static Measurement Measure(TTree& tree, const std::string& branch_name, int settings, Long64_t n_entries)
+    {
+        Measurement m;
+        tree.SetBranchStatus("*", 0);
+        tree.SetBranchStatus(branch_name.c_str(), 1);
+
+        std::vector<char> buffer;
+        {
+            TMemFile output_file("branch_study_output.root", "RECREATE", "", settings);
+            TTree* output_tree = tree.CloneTree(0);
+            output_tree->SetDirectory(&output_file);
+            for(auto branch : *output_tree->GetListOfBranches())
+                static_cast<TBranch*>(branch)->SetCompressionSettings(settings);
+            output_tree->CopyEntries(&tree, n_entries);
+            m.tot_bytes = output_tree->GetTotBytes();
+            output_tree->Write();
+            tree.CopyAddresses(output_tree, true);
+            output_file.Write();
+            buffer.resize(static_cast<size_t>(output_file.GetSize()));
+            output_file.CopyTo(buffer.data(), static_cast<Long64_t>(buffer.size()));
+        }
+        tree.ResetBranchAddresses();
+        tree.SetBranchStatus("*", 1);
+
+        TMemFile input_file("branch_study_input.root", buffer.data(), static_cast<Long64_t>(buffer.size()));
+        auto input_tree = root_ext::ReadObject<TTree>(input_file, tree.GetName());
+        m.zip_bytes = input_tree->GetZipBytes();
+        const auto start = clock::now();
+        for(Long64_t entry = 0; entry < input_tree->GetEntries(); ++entry)
+            input_tree->GetEntry(entry);
+        m.read_time = std::chrono::duration<double>(clock::now() - start).count();
+        return m;
+    }
+
+private:
+    Arguments args;
+    std::vector<Codec> codecs;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::BranchCompressionStudy, Arguments)
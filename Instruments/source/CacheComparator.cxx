@@ -0,0 +1,193 @@
+/*! Check that two CacheTuple files contain the same results for each entry.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Analysis/include/EventCacheProvider.h"
+
+struct Arguments {
+    REQ_ARG(std::string, reference_file);
+    REQ_ARG(std::string, target_file);
+    OPT_ARG(std::string, channels, "eTau,muTau,tauTau");
+    OPT_ARG(size_t, max_reported_differences, 10);
+};
+
+namespace analysis {
+
+// The results of each entry are put in the canonical order of EventCacheProvider before the comparison, so caches
+// produced in different ways (e.g. incremental production or merging) can be compared. The values are required to be
+// identical.
+class CacheComparator {
+public:
+    using CacheEvent = cache_tuple::CacheEvent;
+    using CacheTuple = cache_tuple::CacheTuple;
+
+    CacheComparator(const Arguments& _args) :
+        args(_args), channels(SplitValueListT<Channel>(args.channels(), false, ","))
+    {
+    }
+
+    void Run()
+    {
+        auto reference_file = root_ext::OpenRootFile(args.reference_file());
+        auto target_file = root_ext::OpenRootFile(args.target_file());
+        size_t n_total_differences = 0;
+        for(Channel channel : channels) {
+            const std::string tree_name = ToString(channel);
+            const bool has_reference = reference_file->Get(tree_name.c_str()) != nullptr;
+            const bool has_target = target_file->Get(tree_name.c_str()) != nullptr;
+            if(!has_reference && !has_target) {
+                std::cout << "Channel: " << channel << " not found." << std::endl;
+                continue;
+            }
+            if(has_reference != has_target) {
+                std::cout << "Channel: " << channel << " is present only in the "
+                          << (has_reference ? "reference" : "target") << " file." << std::endl;
+                ++n_total_differences;
+                continue;
+            }
+            CacheTuple reference(tree_name, reference_file.get(), true);
+            CacheTuple target(tree_name, target_file.get(), true);
+            n_total_differences += Compare(channel, reference, target);
+        }
+        if(n_total_differences)
+            throw exception("Caches are different: %1% differences found.") % n_total_differences;
+        std::cout << "Caches are identical." << std::endl;
+    }
+
+private:
+    size_t Compare(Channel channel, CacheTuple& reference, CacheTuple& target)
+    {
+        size_t n_entries = 0, n_differences = 0;
+        const auto report = [&](Long64_t entry_index, const std::string& message) {
+            if(n_differences < args.max_reported_differences())
+                std::cout << channel << ", entry_index = " << entry_index << ": " << message << "\n";
+            ++n_differences;
+        };
+        const auto advance = [](CacheTuple& tuple, Long64_t& entry) {
+            ++entry;
+            if(entry < tuple.GetEntries())
+                tuple.GetEntry(entry);
+        };
+        Long64_t ref_entry = -1, target_entry = -1;
+        advance(reference, ref_entry);
+        advance(target, target_entry);
+        while(ref_entry < reference.GetEntries() || target_entry < target.GetEntries()) {
+            const bool has_ref = ref_entry < reference.GetEntries();
+            const bool has_target = target_entry < target.GetEntries();
+            if(!has_target || (has_ref && reference().entry_index < target().entry_index)) {
+                report(reference().entry_index, "present only in the reference cache.");
+                advance(reference, ref_entry);
+                continue;
+            }
+            if(!has_ref || target().entry_index < reference().entry_index) {
+                report(target().entry_index, "present only in the target cache.");
+                advance(target, target_entry);
+                continue;
+            }
+            const auto different_branches = CompareEvents(Canonicalize(reference()), Canonicalize(target()));
+            if(!different_branches.empty()) {
+                std::ostringstream ss;
+                ss << "different values of";
+                for(const auto& branch : different_branches)
+                    ss << " " << branch;
+                report(reference().entry_index, ss.str());
+            }
+            ++n_entries;
+            advance(reference, ref_entry);
+            advance(target, target_entry);
+        }
+        std::cout << channel << ": " << n_entries << " common entries, " << n_differences << " differences."
+                  << std::endl;
+        return n_differences;
+    }
+
+    static CacheEvent Canonicalize(const CacheEvent& event)
+    {
+        const EventCacheProvider provider(event);
+        CacheEvent result;
+        result.entry_index = event.entry_index;
+        provider.FillEvent(result);
+        return result;
+    }
+
+    static std::vector<std::string> CompareEvents(const CacheEvent& a, const CacheEvent& b)
+    {
+        std::vector<std::string> different_branches;
+        const auto check = [&](const std::string& name, const auto& a_values, const auto& b_values) {
+            if(!IsSame(a_values, b_values))
+                different_branches.push_back(name);
+        };
+        check("SVfit_htt_index", a.SVfit_htt_index, b.SVfit_htt_index);
+        check("SVfit_is_valid", a.SVfit_is_valid, b.SVfit_is_valid);
+        check("SVfit_p4", a.SVfit_p4, b.SVfit_p4);
+        check("SVfit_p4_error", a.SVfit_p4_error, b.SVfit_p4_error);
+        check("SVfit_mt", a.SVfit_mt, b.SVfit_mt);
+        check("SVfit_mt_error", a.SVfit_mt_error, b.SVfit_mt_error);
+        check("SVfit_unc_source", a.SVfit_unc_source, b.SVfit_unc_source);
+        check("SVfit_unc_scale", a.SVfit_unc_scale, b.SVfit_unc_scale);
+        check("SVfit_mode", a.SVfit_mode, b.SVfit_mode);
+        check("kinFit_htt_index", a.kinFit_htt_index, b.kinFit_htt_index);
+        check("kinFit_hbb_index", a.kinFit_hbb_index, b.kinFit_hbb_index);
+        check("kinFit_unc_source", a.kinFit_unc_source, b.kinFit_unc_source);
+        check("kinFit_unc_scale", a.kinFit_unc_scale, b.kinFit_unc_scale);
+        // The mass and chi2 are meaningful only for the converged fits.
+        const auto check_converged = [&](const std::string& name, const auto& a_values, const auto& b_values) {
+            if(a_values.size() != b_values.size() || a.kinFit_convergence.size() != a_values.size()
+                    || b.kinFit_convergence.size() != b_values.size()) {
+                different_branches.push_back(name);
+                return;
+            }
+            for(size_t n = 0; n < a_values.size(); ++n) {
+                if(a.kinFit_convergence.at(n) > 0 && b.kinFit_convergence.at(n) > 0
+                        && !IsSame(a_values.at(n), b_values.at(n))) {
+                    different_branches.push_back(name);
+                    return;
+                }
+            }
+        };
+        check_converged("kinFit_m", a.kinFit_m, b.kinFit_m);
+        check_converged("kinFit_chi2", a.kinFit_chi2, b.kinFit_chi2);
+        check("kinFit_convergence", a.kinFit_convergence, b.kinFit_convergence);
+        check("jet_HHbtag_htt_index", a.jet_HHbtag_htt_index, b.jet_HHbtag_htt_index);
+        check("jet_HHbtag_jet_index", a.jet_HHbtag_jet_index, b.jet_HHbtag_jet_index);
+        check("jet_HHbtag_unc_source", a.jet_HHbtag_unc_source, b.jet_HHbtag_unc_source);
+        check("jet_HHbtag_unc_scale", a.jet_HHbtag_unc_scale, b.jet_HHbtag_unc_scale);
+        check("jet_HHbtag_value", a.jet_HHbtag_value, b.jet_HHbtag_value);
+        return different_branches;
+    }
+
+    // NaN values are considered identical to each other.
+    template<typename T>
+    static bool IsSame(const T& a, const T& b)
+    {
+        if constexpr(std::is_floating_point<T>::value)
+            return a == b || (std::isnan(a) && std::isnan(b));
+        else
+            return a == b;
+    }
+
+    static bool IsSame(const cache_tuple::LorentzVectorM& a, const cache_tuple::LorentzVectorM& b)
+    {
+        return IsSame(a.pt(), b.pt()) && IsSame(a.eta(), b.eta()) && IsSame(a.phi(), b.phi())
+                && IsSame(a.mass(), b.mass());
+    }
+
+    template<typename T>
+    static bool IsSame(const std::vector<T>& a, const std::vector<T>& b)
+    {
+        if(a.size() != b.size()) return false;
+        for(size_t n = 0; n < a.size(); ++n) {
+            if(!IsSame(a.at(n), b.at(n))) return false;
+        }
+        return true;
+    }
+
+private:
+    Arguments args;
+    std::vector<Channel> channels;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::CacheComparator, Arguments)
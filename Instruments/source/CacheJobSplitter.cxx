@@ -0,0 +1,261 @@
+/*! Split cache production jobs into entry ranges with balanced predicted cost.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Analysis/include/EventInfo.h"
+#include "h-tautau/Analysis/include/SignalObjectSelector.h"
+#include "h-tautau/Core/include/EventTuple.h"
+#include "h-tautau/JetTools/include/BTagger.h"
+
+struct Arguments {
+    REQ_ARG(std::string, input_file);
+    REQ_ARG(std::string, channels);
+    REQ_ARG(analysis::Period, period);
+    REQ_ARG(std::string, selections);
+    REQ_ARG(std::string, unc_sources);
+    REQ_ARG(std::string, btaggers);
+    REQ_ARG(bool, isData);
+    REQ_ARG(bool, hasBjetPair);
+    REQ_ARG(double, max_job_cost);
+    OPT_ARG(bool, runSVFit, true);
+    OPT_ARG(bool, runKinFit, true);
+    OPT_ARG(std::string, output, "");
+    // By default, the number of fits is estimated from the multiplicities stored in the tuple: each selection is
+    // assumed to choose a different H->tautau candidate and each b tagger a different H->bb pair while they are
+    // available, and any event with at least two jets is assumed to have a b jet pair. This overestimates the cost
+    // of the events with several candidates. With exact_selection, the full entries are read and the candidates are
+    // chosen by the same selection as in CacheTupleProducer, which requires the inputs from working_path.
+    OPT_ARG(bool, exact_selection, false);
+    OPT_ARG(std::string, working_path, "./");
+    OPT_ARG(analysis::DiscriminatorWP, btag_wp, analysis::DiscriminatorWP::Medium);
+    // Cost model in seconds. The per-stage means from the CacheTupleProducer profile report can be used here.
+    OPT_ARG(double, cost_event, 2e-4);
+    OPT_ARG(double, cost_variation, 1e-3);
+    OPT_ARG(double, cost_SVfit, 0.15);
+    OPT_ARG(double, cost_SVfit_leptonic_leg, 0.15);
+    OPT_ARG(double, cost_KinFit, 0.01);
+    OPT_ARG(double, cost_HHbtag, 2e-3);
+};
+
+namespace analysis {
+
+class CacheJobSplitter {
+public:
+    struct Job {
+        Long64_t begin_entry, end_entry;
+        double cost;
+    };
+
+    CacheJobSplitter(const Arguments& _args) : args(_args)
+    {
+        channels = SplitValueListT<Channel>(args.channels(), false, ",");
+        for(auto signal_mode : SplitValueListT<SignalMode>(args.selections(), false, ","))
+            signalObjectSelectors.emplace_back(signal_mode);
+        n_selections = signalObjectSelectors.size();
+        const auto unc_sources = SplitValueListT<UncertaintySource>(args.unc_sources(), false, ",");
+        unc_plan = CreateUncVariationPlan(unc_sources);
+        n_variations = unc_plan.computed.size();
+        const auto btagger_kinds = SplitValueListT<BTaggerKind>(args.btaggers(), false, ",");
+        for(BTaggerKind kind : btagger_kinds)
+            btaggers.emplace_back(args.period(), kind);
+        n_btaggers = btagger_kinds.size();
+        has_HHbtag = std::count(btagger_kinds.begin(), btagger_kinds.end(), BTaggerKind::HHbtag) > 0;
+        if(has_HHbtag)
+            deepFlavourTagger = std::make_unique<BTagger>(args.period(), BTaggerKind::DeepFlavour);
+        if(args.exact_selection())
+            EventCandidate::InitializeUncertainties(args.period(), false, args.working_path(),
+                                                    TauIdDiscriminator::byDeepTau2017v2p1VSjet);
+        if(!(args.max_job_cost() > 0))
+            throw exception("Invalid max job cost = %1%.") % args.max_job_cost();
+    }
+
+    void Run()
+    {
+        auto file = root_ext::OpenRootFile(args.input_file());
+        std::shared_ptr<std::ofstream> output;
+        if(!args.output().empty()) {
+            output = std::make_shared<std::ofstream>(args.output());
+            if(output->fail())
+                throw exception("Unable to create output file '%1%'.") % args.output();
+            *output << "channel,job_id,begin_entry_index,end_entry_index,n_entries,predicted_cost\n";
+        }
+        std::cout << "channel, job_id, begin_entry_index, end_entry_index, n_entries, predicted cost (s)\n";
+        for(Channel channel : channels) {
+            std::shared_ptr<ntuple::EventTuple> tuple;
+            try {
+                if(args.exact_selection())
+                    tuple = ntuple::CreateEventTuple(ToString(channel), file.get(), true, ntuple::TreeState::Full);
+                else
+                    tuple = std::make_shared<ntuple::EventTuple>(ToString(channel), file.get(), true,
+                                                                 std::set<std::string>(), GetEnabledBranches());
+            } catch(std::runtime_error&) {
+                std::cout << "Channel: " << channel << " not found." << std::endl;
+                continue;
+            }
+
+            std::vector<double> costs(static_cast<size_t>(tuple->GetEntries()));
+            for(Long64_t entry = 0; entry < tuple->GetEntries(); ++entry) {
+                tuple->GetEntry(entry);
+                if(args.exact_selection()) {
+                    (*tuple)().isData = args.isData();
+                    (*tuple)().period = static_cast<int>(args.period());
+                    costs.at(static_cast<size_t>(entry)) = PredictCostFromSelection(tuple->data());
+                } else {
+                    costs.at(static_cast<size_t>(entry)) = PredictCost(tuple->data());
+                }
+            }
+
+            const auto jobs = SplitByCost(costs, args.max_job_cost());
+            for(size_t job_id = 0; job_id < jobs.size(); ++job_id) {
+                const Job& job = jobs.at(job_id);
+                std::cout << channel << ", " << job_id << ", " << job.begin_entry << ", " << job.end_entry << ", "
+                          << job.end_entry - job.begin_entry << ", " << job.cost << "\n";
+                if(output) {
+                    *output << channel << "," << job_id << "," << job.begin_entry << "," << job.end_entry << ","
+                            << job.end_entry - job.begin_entry << "," << job.cost << "\n";
+                }
+            }
+        }
+        std::cout << std::flush;
+    }
+
+private:
+    // Branches required by the pre-selection of CacheTupleProducer and by the multiplicity estimate.
+    static const std::set<std::string>& GetEnabledBranches()
+    {
+        static const std::set<std::string> enabled_branches = {
+            "first_daughter_indexes", "second_daughter_indexes", "lep_type", "jets_p4", "metFilters",
+            "other_lepton_type", "other_lepton_eleId_iso", "other_lepton_eleId_noIso", "other_lepton_muonId",
+            "other_lepton_iso",
+        };
+        return enabled_branches;
+    }
+
+    // Follows the structure of CacheTupleProducer::FillCacheTuple: for each uncertainty variation, SVfit runs once
+    // per distinct H->tautau candidate chosen by the selections, HHKinFit once per distinct (H->tautau, H->bb) pair
+    // and HH-btag once per distinct H->tautau candidate. The candidates that are actually chosen depend on the full
+    // selection, so each selection and b tagger is assumed to pick a different candidate while they are available.
+    double PredictCost(const ntuple::Event& event) const
+    {
+        double cost = args.cost_event();
+        if(!PassPreSelection(event)) return cost;
+
+        cost += n_variations * n_selections * n_btaggers * args.cost_variation();
+        const size_t n_htt = event.first_daughter_indexes.size();
+        const size_t n_jets = event.jets_p4.size();
+        const bool has_bjet_pair = n_jets >= 2;
+        if(!n_htt || (args.hasBjetPair() && !has_bjet_pair)) return cost;
+
+        const size_t n_htt_selected = std::min(n_htt, n_selections);
+        const size_t n_hbb_selected = std::min(n_btaggers, n_jets * (n_jets - 1) / 2);
+        double cost_per_variation = 0;
+        if(args.runSVFit())
+            cost_per_variation += n_htt_selected * GetSVfitCost(event, 0);
+        if(args.runKinFit() && has_bjet_pair)
+            cost_per_variation += n_htt_selected * n_hbb_selected * args.cost_KinFit();
+        if(has_HHbtag && has_bjet_pair)
+            cost_per_variation += n_htt_selected * args.cost_HHbtag();
+        return cost + n_variations * cost_per_variation;
+    }
+
+    // Same candidate selection as in CacheTupleProducer::FillCacheTuple, without running the fits. The HH-btag scores
+    // are not available at this stage, so the candidates of the HHbtag tagger are chosen with DeepFlavour, which is
+    // also used by the producer to select the H->tautau candidate for the HH-btag evaluation.
+    double PredictCostFromSelection(const ntuple::Event& event) const
+    {
+        double cost = args.cost_event();
+        if(!PassPreSelection(event)) return cost;
+
+        for(auto [unc_source, unc_scale] : unc_plan.computed) {
+            auto event_candidate = std::make_shared<EventCandidate>(event, unc_source, unc_scale);
+            if(unc_scale != UncertaintyScale::Central && event_candidate->IsSameAsCentral()) continue;
+            cost += n_selections * n_btaggers * args.cost_variation();
+            std::set<size_t> htt_indices, hh_btagged_htt_indices;
+            std::set<std::pair<size_t, size_t>> hh_indices;
+            for(const SignalObjectSelector& signalObjectSelector : signalObjectSelectors) {
+                for(const BTagger& bTagger : btaggers) {
+                    const bool is_HHbtag = bTagger.GetTagger() == BTaggerKind::HHbtag;
+                    const auto event_info = EventInfo::Create(event_candidate, signalObjectSelector,
+                                                              is_HHbtag ? *deepFlavourTagger : bTagger,
+                                                              args.btag_wp());
+                    if(!event_info) continue;
+                    const size_t htt_index = event_info->GetHttIndex();
+                    if(is_HHbtag && event_info->HasBjetPair() && hh_btagged_htt_indices.insert(htt_index).second)
+                        cost += args.cost_HHbtag();
+                    if(args.hasBjetPair() && !event_info->HasBjetPair()) continue;
+                    if(args.runSVFit() && htt_indices.insert(htt_index).second)
+                        cost += GetSVfitCost(event, htt_index);
+                    if(args.runKinFit() && event_info->HasBjetPair()) {
+                        const size_t hbb_index = event_info->GetSelectedSignalJets().bjet_pair.ToIndex();
+                        if(hh_indices.insert(std::make_pair(htt_index, hbb_index)).second)
+                            cost += args.cost_KinFit();
+                    }
+                }
+            }
+        }
+        return cost;
+    }
+
+    bool PassPreSelection(const ntuple::Event& event) const
+    {
+        return SignalObjectSelector::PassLeptonVetoSelection(event)
+                && SignalObjectSelector::PassMETfilters(event, args.period(), args.isData());
+    }
+
+    // Each leptonic tau decay adds a dimension to the SVfit integration.
+    double GetSVfitCost(const ntuple::Event& event, size_t htt_index) const
+    {
+        const auto is_leptonic = [&](size_t leg_index) {
+            if(leg_index >= event.lep_type.size()) return false;
+            const LegType leg_type = static_cast<LegType>(event.lep_type.at(leg_index));
+            return leg_type == LegType::e || leg_type == LegType::mu;
+        };
+        const size_t n_leptonic = is_leptonic(event.first_daughter_indexes.at(htt_index))
+                                  + is_leptonic(event.second_daughter_indexes.at(htt_index));
+        return args.cost_SVfit() + n_leptonic * args.cost_SVfit_leptonic_leg();
+    }
+
+    // Cuts the entries into contiguous ranges such that each range has a predicted cost close to the total cost
+    // divided by the number of jobs.
+    static std::vector<Job> SplitByCost(const std::vector<double>& costs, double max_job_cost)
+    {
+        const double total_cost = std::accumulate(costs.begin(), costs.end(), 0.);
+        const size_t n_jobs = std::max<size_t>(1, static_cast<size_t>(std::ceil(total_cost / max_job_cost)));
+        const double target_cost = total_cost / n_jobs;
+
+        std::vector<Job> jobs;
+        Job job{0, 0, 0.};
+        double cumulative_cost = 0;
+        for(size_t entry = 0; entry < costs.size(); ++entry) {
+            job.cost += costs.at(entry);
+            cumulative_cost += costs.at(entry);
+            job.end_entry = static_cast<Long64_t>(entry) + 1;
+            if(jobs.size() + 1 < n_jobs && cumulative_cost >= target_cost * (jobs.size() + 1)) {
+                jobs.push_back(job);
+                job = Job{job.end_entry, job.end_entry, 0.};
+            }
+        }
+        if(job.end_entry > job.begin_entry || jobs.empty())
+            jobs.push_back(job);
+        return jobs;
+    }
+
+private:
+    Arguments args;
+    std::vector<Channel> channels;
+    std::vector<SignalObjectSelector> signalObjectSelectors;
+    UncVariationPlan unc_plan;
+    std::vector<BTagger> btaggers;
+    std::unique_ptr<BTagger> deepFlavourTagger;
+    size_t n_selections, n_variations, n_btaggers;
+    bool has_HHbtag;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::CacheJobSplitter, Arguments)
@@ -1,7 +1,9 @@
 /*! Merge multiple CacheTuples files into a single file.
 This file is part of https://github.com/hh-italian-group/h-tautau. */
 
+#include <algorithm>
 #include <iostream>
+#include <TTree.h>
 
 #include "AnalysisTools/Core/include/RootExt.h"
 #include "AnalysisTools/Run/include/program_main.h"
@@ -13,6 +15,7 @@ struct Arguments {
     REQ_ARG(std::string, channel);
     REQ_ARG(std::string, outputFile);
     REQ_ARG(std::vector<std::string>, inputs);
+    OPT_ARG(bool, fastClone, true);
 };
 
 namespace analysis {
@@ -22,11 +25,8 @@ public:
     CacheMerger(const Arguments& _args) :
             args(_args), cache_reader(args.inputs(), args.channel()),
             output(root_ext::CreateRootFile(args.outputFile())),
-            output_cache(args.channel(), output.get(), false), output_summary("summary", output.get(), false),
-            progressReporter(10, std::cout)
+            output_summary("summary", output.get(), false), progressReporter(10, std::cout)
     {
-        output_cache.SetAutoFlush(1000);
-        output_cache.SetMaxVirtualSize(10000000);
         progressReporter.SetTotalNumberOfEvents(cache_reader.GetTotalNumberOfEntries());
 
         std::cout << "Inputs:\n";
@@ -45,6 +45,115 @@ public:
         output_summary.Write();
 
         std::cout << "done.\nMerging caches..." << std::endl;
+        if(!args.fastClone() || !FastCloneMerge())
+            DecodeMerge();
+        progressReporter.Report(cache_reader.GetTotalNumberOfEntries(), true);
+    }
+
+private:
+    struct CacheInput {
+        std::shared_ptr<TFile> file;
+        TTree* tree;
+        Long64_t first_entry_index, last_entry_index;
+    };
+
+    // Reads only the entry_index branch and the index branches of the results. Returns false if the entry indices are
+    // not strictly increasing. Entries without any results are counted in n_empty.
+    static bool GetEntryIndexRange(TTree& tree, Long64_t& first, Long64_t& last, size_t& n_empty)
+    {
+        static const std::vector<std::string> result_index_branches = {
+            "SVfit_htt_index", "kinFit_htt_index", "jet_HHbtag_htt_index"
+        };
+        Long64_t entry_index;
+        std::vector<std::vector<UInt_t>*> result_indices(result_index_branches.size(), nullptr);
+        tree.SetBranchStatus("*", 0);
+        tree.SetBranchStatus("entry_index", 1);
+        tree.SetBranchAddress("entry_index", &entry_index);
+        for(size_t n = 0; n < result_index_branches.size(); ++n) {
+            tree.SetBranchStatus(result_index_branches.at(n).c_str(), 1);
+            tree.SetBranchAddress(result_index_branches.at(n).c_str(), &result_indices.at(n));
+        }
+        bool is_ordered = true;
+        n_empty = 0;
+        for(Long64_t entry = 0; entry < tree.GetEntries(); ++entry) {
+            tree.GetEntry(entry);
+            if(entry != 0 && entry_index <= last) {
+                is_ordered = false;
+                break;
+            }
+            if(entry == 0)
+                first = entry_index;
+            last = entry_index;
+            const bool is_empty = std::all_of(result_indices.begin(), result_indices.end(),
+                                              [](const std::vector<UInt_t>* indices) { return indices->empty(); });
+            if(is_empty)
+                ++n_empty;
+        }
+        tree.ResetBranchAddresses();
+        tree.SetBranchStatus("*", 1);
+        for(auto indices : result_indices)
+            delete indices;
+        return is_ordered;
+    }
+
+    // Concatenates the compressed baskets of the inputs without deserializing them. Possible only if each input
+    // is ordered by entry_index, the entry_index ranges of the inputs do not overlap and, as the decode merge skips
+    // entries without any results, the inputs contain no such entries.
+    bool FastCloneMerge()
+    {
+        std::vector<CacheInput> inputs;
+        for(const auto& input_name : args.inputs()) {
+            CacheInput input;
+            input.file = root_ext::OpenRootFile(input_name);
+            input.tree = root_ext::ReadObject<TTree>(*input.file, args.channel());
+            size_t n_empty;
+            if(!GetEntryIndexRange(*input.tree, input.first_entry_index, input.last_entry_index, n_empty)) {
+                std::cout << "Entries in '" << input_name << "' are not ordered by entry_index."
+                          << " Falling back to the decode merge." << std::endl;
+                return false;
+            }
+            if(n_empty) {
+                std::cout << "'" << input_name << "' contains " << n_empty << " entries without results."
+                          << " Falling back to the decode merge." << std::endl;
+                return false;
+            }
+            if(input.tree->GetEntries())
+                inputs.push_back(input);
+        }
+        if(inputs.empty()) return false;
+
+        std::sort(inputs.begin(), inputs.end(), [](const CacheInput& a, const CacheInput& b) {
+            return a.first_entry_index < b.first_entry_index;
+        });
+        for(size_t n = 1; n < inputs.size(); ++n) {
+            if(inputs.at(n).first_entry_index <= inputs.at(n - 1).last_entry_index) {
+                std::cout << "Inputs have overlapping entry_index ranges. Falling back to the decode merge."
+                          << std::endl;
+                return false;
+            }
+        }
+
+        std::cout << "Inputs cover disjoint entry_index ranges. Using fast cloning." << std::endl;
+        output->cd();
+        TTree* output_tree = inputs.front().tree->CloneTree(0);
+        output_tree->SetDirectory(output.get());
+        inputs.front().tree->CopyAddresses(output_tree, true);
+        size_t n_copied = 0;
+        for(const auto& input : inputs) {
+            if(output_tree->CopyEntries(input.tree, -1, "fast") < 0)
+                throw exception("Unable to copy entries from '%1%'.") % input.file->GetName();
+            n_copied += static_cast<size_t>(input.tree->GetEntries());
+            progressReporter.Report(n_copied, false);
+        }
+        output_tree->Write("", TObject::kOverwrite);
+        return true;
+    }
+
+    void DecodeMerge()
+    {
+        cache_tuple::CacheTuple output_cache(args.channel(), output.get(), false);
+        output_cache.SetAutoFlush(1000);
+        output_cache.SetMaxVirtualSize(10000000);
 
         size_t n_steps = 0;
         std::set<Long64_t> processed_entries;
@@ -67,13 +176,12 @@ public:
             }
         }
         output_cache.Write();
-        progressReporter.Report(cache_reader.GetTotalNumberOfEntries(), true);
     }
+
 private:
     Arguments args;
     EventCacheReader cache_reader;
     std::shared_ptr<TFile> output;
-    cache_tuple::CacheTuple output_cache;
     cache_tuple::CacheSummaryTuple output_summary;
     analysis::tools::ProgressReporter progressReporter;
 };
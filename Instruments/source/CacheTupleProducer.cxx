@@ -1,11 +1,16 @@
 /*! Produce synchronization tree.
 This file is part of https://github.com/hh-italian-group/h-tautau. */
 
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 #include "AnalysisTools/Core/include/ProgressReporter.h"
 #include "AnalysisTools/Run/include/program_main.h"
 #include "h-tautau/Analysis/include/EventCacheProvider.h"
 #include "h-tautau/Analysis/include/EventInfo.h"
 #include "h-tautau/Core/include/CacheTuple.h"
+#include "h-tautau/Core/include/TwoPhaseEventTuple.h"
+#include "h-tautau/Instruments/include/StageProfiler.h"
 #include "HHTools/HHbtag/interface/HH_BTag.h"
 
 struct Arguments {
@@ -24,8 +29,21 @@ struct Arguments {
     OPT_ARG(Long64_t, begin_entry_index, 0);
     OPT_ARG(Long64_t, end_entry_index, std::numeric_limits<Long64_t>::max());
     OPT_ARG(std::string, working_path, "./");
+    // Existing cache produced from the same input file. Its results are reused instead of being recomputed.
+    OPT_ARG(std::string, input_cache, "");
     OPT_ARG(analysis::DiscriminatorWP, btag_wp, analysis::DiscriminatorWP::Medium);
     OPT_ARG(bool, debug, false);
+    OPT_ARG(std::string, profile_report, "");
+    OPT_ARG(size_t, n_slow_entries, 10);
+    OPT_ARG(analysis::sv_fit_ana::SVfitMode, svfit_mode, analysis::sv_fit_ana::SVfitMode::Classic);
+    OPT_ARG(int, svfit_max_evaluations, 100000);
+    OPT_ARG(double, svfit_adaptive_tolerance, 0.01);
+    OPT_ARG(int, svfit_adaptive_min_evaluations, 10000);
+    // Local file with the SVfit and KinFit results shared between jobs, and its maximal size in MB.
+    OPT_ARG(std::string, fit_store, "");
+    OPT_ARG(size_t, fit_store_max_size, 1024);
+    // Read the pre-selection branches first and the rest of the entry only for the events that pass the pre-selection.
+    OPT_ARG(bool, two_phase_read, false);
 };
 
 namespace analysis {
@@ -35,12 +53,14 @@ public:
     using CacheEvent = cache_tuple::CacheEvent;
     using CacheTuple = cache_tuple::CacheTuple;
     using CacheSummaryTuple = cache_tuple::CacheSummaryTuple;
+    using Stage = cache_tuple::CacheProdStage;
     using clock = std::chrono::system_clock;
 
     CacheTupleProducer(const Arguments& _args) :
             args(_args), outputFile(root_ext::CreateRootFile(args.output_file())),
             cacheSummary("summary", outputFile.get(), false), start(clock::now()),
-            progressReporter(10, std::cout), debug(args.debug())
+            progressReporter(10, std::cout), debug(args.debug()), profiler(GetStageNames()),
+            slow_entries(args.n_slow_entries())
     {
         const auto signal_modes = SplitValueListT<SignalMode>(args.selections(), false, ",");
         for(auto signal_mode : signal_modes)
@@ -50,6 +70,7 @@ public:
                                                 TauIdDiscriminator::byDeepTau2017v2p1VSjet);
 
         unc_sources = SplitValueListT<UncertaintySource>(args.unc_sources(), false, ",");
+        unc_plan = CreateUncVariationPlan(unc_sources);
         channels = SplitValueListT<Channel>(args.channels(), false, ",");
         auto btagger_kinds = SplitValueListT<BTaggerKind>(args.btaggers(), false, ",");
         for(BTaggerKind kind : btagger_kinds) {
@@ -74,20 +95,58 @@ public:
         cacheSummary().n_SVfit = 0;
         cacheSummary().n_KinFit = 0;
         cacheSummary().n_HHbtag = 0;
+        cacheSummary().n_SVfit_reused = 0;
+        cacheSummary().n_KinFit_reused = 0;
+        cacheSummary().n_HHbtag_reused = 0;
+        cacheSummary().n_fit_store_hits = 0;
+        cacheSummary().n_fit_store_misses = 0;
+        cacheSummary().n_aliased_variations = 0;
+        cacheSummary().input_bytes_estimate = 0;
+        cacheSummary().input_bytes_single_phase_estimate = 0;
+
+        svfit_settings.mode = args.svfit_mode();
+        svfit_settings.max_evaluations = args.svfit_max_evaluations();
+        svfit_settings.adaptive_tolerance = args.svfit_adaptive_tolerance();
+        svfit_settings.adaptive_min_evaluations = args.svfit_adaptive_min_evaluations();
+        cacheSummary().SVfit_mode = static_cast<Int_t>(svfit_settings.mode);
+        cacheSummary().SVfit_max_evaluations = svfit_settings.max_evaluations;
+        cacheSummary().SVfit_adaptive_tolerance = static_cast<Float_t>(svfit_settings.adaptive_tolerance);
+        cacheSummary().SVfit_adaptive_min_evaluations = svfit_settings.adaptive_min_evaluations;
+
+        if(!args.fit_store().empty()) {
+            static constexpr size_t MB = 1024 * 1024;
+            fitStore = std::make_shared<FitResultStore>(args.fit_store(), args.fit_store_max_size() * MB);
+            sv_fit_ana::FitProducer::SetResultStore(fitStore);
+            kin_fit::FitProducer::SetResultStore(fitStore);
+        }
     }
 
     void Run()
     {
         std::cout << boost::format("Processing input file '%1%' into output file '%2%' using %3% selection.\n")
                    % args.input_file() % args.output_file() % args.selections();
+        std::cout << boost::format("Uncertainty variations: %1% computed, %2% weight-only aliased to central.\n")
+                   % unc_plan.computed.size() % unc_plan.aliased_to_central.size();
 
         auto originalFile = root_ext::OpenRootFile(args.input_file());
+        std::shared_ptr<TFile> preselectionFile;
+        if(args.two_phase_read())
+            preselectionFile = root_ext::OpenRootFile(args.input_file());
         size_t n_tot_events = 0;
         std::map<Channel, std::shared_ptr<ntuple::EventTuple>> map_event;
+        std::map<Channel, std::shared_ptr<ntuple::TwoPhaseEventTuple>> two_phase_tuples;
         for(Channel channel : channels){
             try {
-                auto originalTuple = ntuple::CreateEventTuple(ToString(channel), originalFile.get(), true,
-                                                              ntuple::TreeState::Full);
+                std::shared_ptr<ntuple::EventTuple> originalTuple;
+                if(preselectionFile) {
+                    auto two_phase_tuple = std::make_shared<ntuple::TwoPhaseEventTuple>(
+                            ToString(channel), originalFile.get(), preselectionFile.get(), ntuple::TreeState::Full);
+                    originalTuple = two_phase_tuple->GetTuple();
+                    two_phase_tuples[channel] = two_phase_tuple;
+                } else {
+                    originalTuple = ntuple::CreateEventTuple(ToString(channel), originalFile.get(), true,
+                                                             ntuple::TreeState::Full);
+                }
                 const Long64_t n_entries = std::min(originalTuple->GetEntries(), args.end_entry_index())
                                            - args.begin_entry_index();
                 const Long64_t n_events = std::min(args.max_events_per_tree(), n_entries);
@@ -109,6 +168,20 @@ public:
             cache.SetAutoFlush(1000);
             cache.SetMaxVirtualSize(10000000);
             auto& originalTuple = *map_event.at(channel);
+            ntuple::TwoPhaseEventTuple* two_phase_tuple =
+                    two_phase_tuples.count(channel) ? two_phase_tuples.at(channel).get() : nullptr;
+            std::unique_ptr<EventCacheSource> input_cache;
+            if(!args.input_cache().empty()) {
+                try {
+                    input_cache = std::make_unique<EventCacheSource>(args.input_cache(), ToString(channel));
+                } catch(std::runtime_error&) {
+                    std::cout << "Channel: " << channel << " not found in the input cache." << std::endl;
+                }
+            }
+            reuse_input_svfit = input_cache && HasSameSVfitSettings(input_cache->GetSummary());
+            if(input_cache && args.runSVFit() && !reuse_input_svfit)
+                std::cout << "SVfit settings of the input cache differ from the current settings. SVfit results"
+                          << " from the input cache will not be used." << std::endl;
             const Long64_t n_entries = originalTuple.GetEntries();
             Long64_t n_processed_events_channel = 0;
             for(Long64_t current_entry = args.begin_entry_index();
@@ -116,38 +189,113 @@ public:
                     && current_entry < args.end_entry_index(); ++current_entry) {
                 if(debug)
                     std::cout << "Loading entry " << current_entry << std::endl;
-                originalTuple.GetEntry(current_entry);
-                originalTuple().isData = args.isData();
-                originalTuple().period = static_cast<int>(args.period());
-                FillCacheTuple(cache, current_entry, originalTuple.data());
+                const auto entry_start = StageProfiler::clock::now();
+                ++cacheSummary().n_orig_events;
+                if(ReadEntry(originalTuple, two_phase_tuple, current_entry)) {
+                    if(debug)
+                        std::cout << "Event passed pre-selection" << std::endl;
+                    originalTuple().isData = args.isData();
+                    originalTuple().period = static_cast<int>(args.period());
+                    FillCacheTuple(cache, current_entry, originalTuple.data(), input_cache.get());
+                }
+                slow_entries.Add(static_cast<int>(channel), current_entry, std::chrono::duration<double>(
+                                     StageProfiler::clock::now() - entry_start).count());
                 ++n_processed_events_channel;
                 ++n_processed_events;
                 if(n_processed_events % 100 == 0) progressReporter.Report(n_processed_events, false);
             }
             progressReporter.Report(n_processed_events, true);
+            if(two_phase_tuple) {
+                const auto& read_stats = two_phase_tuple->GetStats();
+                cacheSummary().input_bytes_estimate += read_stats.GetTwoPhaseBytes();
+                cacheSummary().input_bytes_single_phase_estimate += read_stats.single_phase_bytes;
+                read_stats.Print(std::cout);
+            }
             cache.Write();
             const auto stop = clock::now();
             const auto exeTime = std::chrono::duration_cast<std::chrono::seconds>(stop - start).count();
             cacheSummary().exeTime = static_cast<UInt_t>(exeTime);
+            FillStageSummary();
+            if(fitStore) {
+                const auto fit_store_stats = fitStore->GetStats();
+                cacheSummary().n_fit_store_hits = static_cast<Int_t>(fit_store_stats.n_hits);
+                cacheSummary().n_fit_store_misses = static_cast<Int_t>(fit_store_stats.n_misses);
+            }
             cacheSummary.Fill();
             cacheSummary.Write();
         }
         progressReporter.Report(n_tot_events, true);
+        profiler.Print(std::cout);
+        if(fitStore)
+            fitStore->PrintStats(std::cout);
+        if(!args.profile_report().empty())
+            WriteProfileReport(args.profile_report());
     }
 
 private:
-    void FillCacheTuple(CacheTuple& cacheTuple, Long64_t original_entry, const ntuple::Event& event)
+    // Reads the entry and returns the result of the pre-selection, which is evaluated once per entry.
+    // In the two-phase mode, the full entry is read only if the event passes the pre-selection.
+    bool ReadEntry(ntuple::EventTuple& tuple, ntuple::TwoPhaseEventTuple* two_phase_tuple, Long64_t entry)
+    {
+        if(!two_phase_tuple) {
+            {
+                const auto timer = profiler.Measure(Stage::Read);
+                tuple.GetEntry(entry);
+            }
+            return PassPreSelection(tuple.data());
+        }
+        const ntuple::Event* preselection_event;
+        {
+            const auto timer = profiler.Measure(Stage::Read);
+            preselection_event = &two_phase_tuple->ReadPreselection(entry);
+        }
+        if(!PassPreSelection(*preselection_event)) return false;
+        const auto timer = profiler.Measure(Stage::Read);
+        two_phase_tuple->ReadFull(entry);
+        return true;
+    }
+
+    bool PassPreSelection(const ntuple::Event& event)
     {
-        ++cacheSummary().n_orig_events;
-        if(!SignalObjectSelector::PassLeptonVetoSelection(event)) return;
-        if(!SignalObjectSelector::PassMETfilters(event, args.period(), args.isData())) return;
+        const auto timer = profiler.Measure(Stage::Selection);
+        return SignalObjectSelector::PassLeptonVetoSelection(event)
+                && SignalObjectSelector::PassMETfilters(event, args.period(), args.isData());
+    }
 
-        if(debug)
-            std::cout << "Event passed pre-selection" << std::endl;
+    // Results computed with different settings could differ, so the SVfit results are reused only if all input cache
+    // files were produced with the same SVfit settings.
+    bool HasSameSVfitSettings(const std::vector<cache_tuple::CacheProdSummary>& input_summary) const
+    {
+        if(input_summary.empty()) return false;
+        for(const auto& summary : input_summary) {
+            if(summary.SVfit_mode != static_cast<Int_t>(svfit_settings.mode)
+                    || summary.SVfit_max_evaluations != svfit_settings.max_evaluations
+                    || summary.SVfit_adaptive_tolerance != static_cast<Float_t>(svfit_settings.adaptive_tolerance)
+                    || summary.SVfit_adaptive_min_evaluations != svfit_settings.adaptive_min_evaluations)
+                return false;
+        }
+        return true;
+    }
 
+    // Should be called only for the events that passed the pre-selection (see ReadEntry).
+    // If the input cache is provided, the results that it contains are copied instead of being recomputed. Only the
+    // results that are required by the current configuration are stored, so the output is the same as without the
+    // input cache.
+    void FillCacheTuple(CacheTuple& cacheTuple, Long64_t original_entry, const ntuple::Event& event,
+                        EventCacheSource* input_cache)
+    {
         auto cache_provider = std::make_shared<EventCacheProvider>();
-        for(auto [unc_source, unc_scale] : EnumerateUncVariations(unc_sources)) {
-            auto event_candidate = std::make_shared<EventCandidate>(event, unc_source, unc_scale);
+        EventCacheProvider input_provider;
+        if(input_cache)
+            input_cache->Read(original_entry, input_provider);
+        // Weight-only variations have the same candidates as the central one, so nothing is stored for them.
+        cacheSummary().n_aliased_variations += static_cast<Int_t>(unc_plan.aliased_to_central.size());
+        for(auto [unc_source, unc_scale] : unc_plan.computed) {
+            std::shared_ptr<EventCandidate> event_candidate;
+            {
+                const auto timer = profiler.Measure(Stage::Candidate);
+                event_candidate = std::make_shared<EventCandidate>(event, unc_source, unc_scale);
+            }
             if(debug)
                 std::cout << "unc_source=" << unc_source << ", unc_scale=" << unc_scale
                           << ", event_id=" << event_candidate->GetEventId()
@@ -163,20 +311,28 @@ private:
                         std::cout << "Btagger: " << bTagger.GetTagger() << std::endl;
 
                     if(bTagger.GetTagger() == BTaggerKind::HHbtag) {
-                        const auto ref_event_info = EventInfo::Create(event_candidate, signalObjectSelector,
-                                                                      *deepFlavourTagger, args.btag_wp(),
-                                                                      nullptr, false, debug);
+                        const auto ref_event_info = CreateEventInfo(event_candidate, signalObjectSelector,
+                                                                    *deepFlavourTagger);
                         if(!ref_event_info || !ref_event_info->HasBjetPair()) continue;
                         const size_t ref_htt_index = ref_event_info->GetHttIndex();
                         if(!hh_btagged_htt_indices.count(ref_htt_index)) {
-                            ++cacheSummary().n_HHbtag;
-                            CalculateHHbtag(*ref_event_info, *cache_provider);
+                            const auto scores = input_provider.GetHHbtagResults(ref_htt_index, unc_source,
+                                                                                unc_scale);
+                            if(!scores.empty()) {
+                                ++cacheSummary().n_HHbtag_reused;
+                                for(const auto& [jet_index, score] : scores)
+                                    cache_provider->AddHHbtagResults(ref_htt_index, jet_index, unc_source, unc_scale,
+                                                                     score);
+                            } else {
+                                ++cacheSummary().n_HHbtag;
+                                const auto timer = profiler.Measure(Stage::HHbtag);
+                                CalculateHHbtag(*ref_event_info, *cache_provider);
+                            }
                             hh_btagged_htt_indices.insert(ref_htt_index);
                         }
                     }
 
-                    const auto event_info = EventInfo::Create(event_candidate, signalObjectSelector, bTagger,
-                                                              args.btag_wp(), nullptr, false, debug);
+                    const auto event_info = CreateEventInfo(event_candidate, signalObjectSelector, bTagger);
                     if(!event_info) continue;
                     if(args.hasBjetPair() && !event_info->HasBjetPair()) continue;
 
@@ -186,9 +342,17 @@ private:
 
                     const size_t htt_index = event_info->GetHttIndex();
                     if(args.runSVFit() && !htt_indices.count(htt_index)) {
-                        ++cacheSummary().n_SVfit;
-                        const sv_fit_ana::FitResults& fit_results = event_info->GetSVFitResults(true);
-                        cache_provider->AddSVfitResults(htt_index, unc_source, unc_scale, fit_results);
+                        const auto cached_results = input_provider.TryGetSVFit(htt_index, unc_source, unc_scale);
+                        if(reuse_input_svfit && cached_results) {
+                            ++cacheSummary().n_SVfit_reused;
+                            cache_provider->AddSVfitResults(htt_index, unc_source, unc_scale, *cached_results);
+                        } else {
+                            ++cacheSummary().n_SVfit;
+                            const auto timer = profiler.Measure(Stage::SVfit);
+                            const sv_fit_ana::FitResults& fit_results =
+                                    event_info->GetSVFitResults(true, 0, svfit_settings);
+                            cache_provider->AddSVfitResults(htt_index, unc_source, unc_scale, fit_results);
+                        }
                         htt_indices.insert(htt_index);
                     }
 
@@ -196,9 +360,19 @@ private:
                         const size_t hbb_index = event_info->GetSelectedSignalJets().bjet_pair.ToIndex();
                         const auto hh_pair = std::make_pair(htt_index, hbb_index);
                         if(!hh_indices.count(hh_pair)) {
-                            ++cacheSummary().n_KinFit;
-                            const kin_fit::FitResults& fit_results = event_info->GetKinFitResults(true);
-                            cache_provider->AddKinFitResults(htt_index, hbb_index, unc_source, unc_scale, fit_results);
+                            const auto cached_results = input_provider.TryGetKinFit(htt_index, hbb_index, unc_source,
+                                                                                    unc_scale);
+                            if(cached_results) {
+                                ++cacheSummary().n_KinFit_reused;
+                                cache_provider->AddKinFitResults(htt_index, hbb_index, unc_source, unc_scale,
+                                                                 *cached_results);
+                            } else {
+                                ++cacheSummary().n_KinFit;
+                                const auto timer = profiler.Measure(Stage::KinFit);
+                                const kin_fit::FitResults& fit_results = event_info->GetKinFitResults(true);
+                                cache_provider->AddKinFitResults(htt_index, hbb_index, unc_source, unc_scale,
+                                                                 fit_results);
+                            }
                             hh_indices.insert(hh_pair);
                         }
                     }
@@ -207,6 +381,7 @@ private:
         }
 
         if(!cache_provider->IsEmpty()) {
+            const auto timer = profiler.Measure(Stage::Write);
             cacheTuple().entry_index = original_entry;
             cache_provider->FillEvent(cacheTuple());
             cacheTuple.Fill();
@@ -214,6 +389,100 @@ private:
         }
     }
 
+    std::unique_ptr<EventInfo> CreateEventInfo(const std::shared_ptr<EventCandidate>& event_candidate,
+                                               const SignalObjectSelector& signalObjectSelector,
+                                               const BTagger& bTagger)
+    {
+        const auto timer = profiler.Measure(Stage::Selection);
+        return EventInfo::Create(event_candidate, signalObjectSelector, bTagger, args.btag_wp(), nullptr, false,
+                                 debug);
+    }
+
+    static std::vector<std::string> GetStageNames()
+    {
+        const auto& stages = EnumNameMap<Stage>::GetDefault().GetEnumEntries();
+        std::vector<std::string> names(stages.size());
+        for(Stage stage : stages)
+            names.at(static_cast<size_t>(stage)) = ToString(stage);
+        return names;
+    }
+
+    void FillStageSummary()
+    {
+        static constexpr double ms = 1e3;
+        auto& summary = cacheSummary();
+        summary.stage_n_calls.clear();
+        summary.stage_time.clear();
+        summary.stage_time_p50.clear();
+        summary.stage_time_p90.clear();
+        summary.stage_time_p99.clear();
+        summary.stage_time_max.clear();
+        for(size_t stage_id = 0; stage_id < profiler.GetNumberOfStages(); ++stage_id) {
+            const auto& stats = profiler.GetStats(stage_id);
+            summary.stage_n_calls.push_back(static_cast<Int_t>(stats.GetCount()));
+            summary.stage_time.push_back(static_cast<Float_t>(stats.GetTotal()));
+            summary.stage_time_p50.push_back(static_cast<Float_t>(stats.GetQuantile(0.5) * ms));
+            summary.stage_time_p90.push_back(static_cast<Float_t>(stats.GetQuantile(0.9) * ms));
+            summary.stage_time_p99.push_back(static_cast<Float_t>(stats.GetQuantile(0.99) * ms));
+            summary.stage_time_max.push_back(static_cast<Float_t>(stats.GetMax() * ms));
+        }
+        summary.slow_entry_channel.clear();
+        summary.slow_entry_index.clear();
+        summary.slow_entry_time.clear();
+        for(const auto& entry : slow_entries.GetEntries()) {
+            summary.slow_entry_channel.push_back(entry.tree_id);
+            summary.slow_entry_index.push_back(entry.entry_index);
+            summary.slow_entry_time.push_back(static_cast<Float_t>(entry.time * ms));
+        }
+    }
+
+    // Writes the stage timing and the slowest events into a JSON file.
+    void WriteProfileReport(const std::string& file_name) const
+    {
+        static constexpr double ms = 1e3;
+        std::ofstream report(file_name);
+        if(report.fail())
+            throw exception("Unable to create profile report '%1%'.") % file_name;
+        report << std::setprecision(6) << "{\n"
+               << "  \"input_file\": \"" << EscapeJsonString(args.input_file()) << "\",\n"
+               << "  \"begin_entry_index\": " << args.begin_entry_index() << ",\n"
+               << "  \"exeTime\": " << cacheSummary().exeTime << ",\n"
+               << "  \"n_orig_events\": " << cacheSummary().n_orig_events << ",\n"
+               << "  \"stages\": [\n";
+        for(size_t stage_id = 0; stage_id < profiler.GetNumberOfStages(); ++stage_id) {
+            const auto& stats = profiler.GetStats(stage_id);
+            report << "    { \"name\": \"" << profiler.GetStageName(stage_id) << "\", \"n_calls\": "
+                   << stats.GetCount() << ", \"total_s\": " << stats.GetTotal() << ", \"mean_ms\": "
+                   << stats.GetMean() * ms << ", \"p50_ms\": " << stats.GetQuantile(0.5) * ms
+                   << ", \"p90_ms\": " << stats.GetQuantile(0.9) * ms << ", \"p99_ms\": "
+                   << stats.GetQuantile(0.99) * ms << ", \"max_ms\": " << stats.GetMax() * ms << " }"
+                   << (stage_id + 1 < profiler.GetNumberOfStages() ? "," : "") << "\n";
+        }
+        report << "  ],\n  \"slow_entries\": [\n";
+        const auto entries = slow_entries.GetEntries();
+        for(size_t n = 0; n < entries.size(); ++n) {
+            const auto& entry = entries.at(n);
+            report << "    { \"channel\": \"" << EscapeJsonString(ToString(static_cast<Channel>(entry.tree_id)))
+                   << "\", \"entry_index\": " << entry.entry_index << ", \"time_ms\": " << entry.time * ms << " }"
+                   << (n + 1 < entries.size() ? "," : "") << "\n";
+        }
+        report << "  ]\n}\n";
+    }
+
+    static std::string EscapeJsonString(const std::string& str)
+    {
+        std::ostringstream ss;
+        for(char c : str) {
+            if(c == '"' || c == '\\')
+                ss << '\\' << c;
+            else if(static_cast<unsigned char>(c) < 0x20)
+                ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+            else
+                ss << c;
+        }
+        return ss.str();
+    }
+
     void CalculateHHbtag(EventInfo& event_info, EventCacheProvider& cache_provider) const
     {
         const auto& event_candidate = event_info.GetEventCandidate();
@@ -265,11 +534,17 @@ private:
     std::vector<Channel> channels;
     std::vector<SignalObjectSelector> signalObjectSelectors;
     std::vector<UncertaintySource> unc_sources;
+    UncVariationPlan unc_plan;
     std::vector<BTagger> btaggers;
     tools::ProgressReporter progressReporter;
     std::unique_ptr<BTagger> deepFlavourTagger;
     std::unique_ptr<hh_btag::HH_BTag> hh_btagger;
     const bool debug;
+    StageProfiler profiler;
+    SlowEntryTracker slow_entries;
+    sv_fit_ana::FitSettings svfit_settings;
+    bool reuse_input_svfit{false};
+    std::shared_ptr<FitResultStore> fitStore;
 };
 
 } // namespace analysis
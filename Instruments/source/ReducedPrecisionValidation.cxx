@@ -0,0 +1,131 @@
+/*! Validate the reduced-precision storage of the gen-level 4-momenta against the precision budget.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <TH1D.h>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Core/include/ReducedPrecision.h"
+
+struct Arguments {
+    REQ_ARG(std::string, input);
+    REQ_ARG(std::string, tree_name);
+    REQ_ARG(std::string, output);
+    OPT_ARG(Long64_t, max_entries, std::numeric_limits<Long64_t>::max());
+};
+
+namespace analysis {
+
+class ReducedPrecisionValidation {
+public:
+    using Hist = TH1D;
+    using HistPtr = std::shared_ptr<Hist>;
+
+    struct BranchValidation {
+        double max_rel_error{0};
+        size_t n_objects{0};
+        HistPtr pt_orig, pt_reduced, m_pair_orig, m_pair_reduced, rel_diff;
+
+        BranchValidation(const std::string& name)
+        {
+            pt_orig = MakeHist(name + "_pt_orig", 200, 0, 1000);
+            pt_reduced = MakeHist(name + "_pt_reduced", 200, 0, 1000);
+            m_pair_orig = MakeHist(name + "_m_pair_orig", 200, 0, 2000);
+            m_pair_reduced = MakeHist(name + "_m_pair_reduced", 200, 0, 2000);
+            rel_diff = MakeHist(name + "_rel_diff", 200, -1e-3, 1e-3);
+        }
+
+        static HistPtr MakeHist(const std::string& name, int n_bins, double x_min, double x_max)
+        {
+            auto hist = std::make_shared<Hist>(name.c_str(), name.c_str(), n_bins, x_min, x_max);
+            hist->SetDirectory(nullptr);
+            return hist;
+        }
+    };
+
+    ReducedPrecisionValidation(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        auto input_file = root_ext::OpenRootFile(args.input());
+        auto tuple = ntuple::CreateEventTuple(args.tree_name(), input_file.get(), true, ntuple::TreeState::Full);
+        const Long64_t n_entries = std::min(tuple->GetEntries(), args.max_entries());
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            tuple->GetEntry(entry);
+            ntuple::ForEachReducedPrecisionBranch(tuple->data(), *this);
+        }
+
+        auto output_file = root_ext::CreateRootFile(args.output());
+        bool all_passed = true;
+        std::cout << "branch, n_bits, n_objects, max relative error, budget, KS prob (pt), KS prob (m_pair)\n";
+        for(const auto& entry : ntuple::GetReducedPrecisionBudget()) {
+            if(!validations.count(entry.branch_name)) continue;
+            const auto& validation = validations.at(entry.branch_name);
+            const double budget = std::ldexp(1., -static_cast<int>(entry.n_mantissa_bits) - 1);
+            const bool passed = validation.max_rel_error <= budget;
+            all_passed = all_passed && passed;
+            std::cout << entry.branch_name << ", " << entry.n_mantissa_bits << ", " << validation.n_objects << ", "
+                      << validation.max_rel_error << ", " << budget << ", "
+                      << KolmogorovTest(*validation.pt_orig, *validation.pt_reduced) << ", "
+                      << KolmogorovTest(*validation.m_pair_orig, *validation.m_pair_reduced)
+                      << (passed ? "" : " (budget exceeded)") << "\n";
+            for(const auto& hist : { validation.pt_orig, validation.pt_reduced, validation.m_pair_orig,
+                                     validation.m_pair_reduced, validation.rel_diff })
+                output_file->WriteTObject(hist.get());
+        }
+        std::cout << (all_passed ? "All branches are within the precision budget." : "Precision budget exceeded.")
+                  << std::endl;
+        if(!all_passed)
+            throw exception("Reduced precision validation failed.");
+    }
+
+    template<typename LVector>
+    void operator()(const ntuple::ReducedPrecisionEntry& entry, const LVector& p4)
+    {
+        (*this)(entry, std::vector<LVector>{p4});
+    }
+
+    template<typename LVector>
+    void operator()(const ntuple::ReducedPrecisionEntry& entry, const std::vector<LVector>& collection)
+    {
+        auto iter = validations.find(entry.branch_name);
+        if(iter == validations.end())
+            iter = validations.emplace(entry.branch_name, BranchValidation(entry.branch_name)).first;
+        auto& validation = iter->second;
+
+        std::vector<LVector> reduced;
+        for(const auto& p4 : collection) {
+            reduced.push_back(ntuple::TruncateMantissa(p4, entry.n_mantissa_bits));
+            typename LVector::Scalar orig_c[4], reduced_c[4];
+            p4.GetCoordinates(orig_c);
+            reduced.back().GetCoordinates(reduced_c);
+            for(size_t n = 0; n < 4; ++n) {
+                if(orig_c[n] == 0) continue;
+                const double rel_diff = (reduced_c[n] - orig_c[n]) / static_cast<double>(orig_c[n]);
+                validation.max_rel_error = std::max(validation.max_rel_error, std::abs(rel_diff));
+                validation.rel_diff->Fill(rel_diff);
+            }
+            validation.pt_orig->Fill(p4.pt());
+            validation.pt_reduced->Fill(reduced.back().pt());
+            ++validation.n_objects;
+        }
+        if(collection.size() >= 2) {
+            validation.m_pair_orig->Fill((collection.at(0) + collection.at(1)).mass());
+            validation.m_pair_reduced->Fill((reduced.at(0) + reduced.at(1)).mass());
+        }
+    }
+
+private:
+    static double KolmogorovTest(const Hist& h1, const Hist& h2)
+    {
+        if(h1.GetEntries() == 0 || h2.GetEntries() == 0) return 1.;
+        return h1.KolmogorovTest(&h2);
+    }
+
+private:
+    Arguments args;
+    std::map<std::string, BranchValidation> validations;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::ReducedPrecisionValidation, Arguments)
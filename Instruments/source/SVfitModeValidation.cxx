@@ -0,0 +1,226 @@
+/*! Compare the results and the timing of a fast SVfit mode with the full SVfit integration on the same events.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Analysis/include/EventInfo.h"
+#include "h-tautau/Core/include/TwoPhaseEventTuple.h"
+
+struct Arguments {
+    REQ_ARG(std::string, input_file);
+    REQ_ARG(analysis::Period, period);
+    REQ_ARG(bool, isData);
+    OPT_ARG(std::string, channels, "eTau,muTau,tauTau");
+    OPT_ARG(analysis::SignalMode, selection, analysis::SignalMode::HH);
+    OPT_ARG(analysis::BTaggerKind, btagger, analysis::BTaggerKind::DeepFlavour);
+    OPT_ARG(analysis::DiscriminatorWP, btag_wp, analysis::DiscriminatorWP::Medium);
+    OPT_ARG(Long64_t, max_events, 1000);
+    OPT_ARG(analysis::sv_fit_ana::SVfitMode, mode, analysis::sv_fit_ana::SVfitMode::FastMTT);
+    OPT_ARG(int, max_evaluations, 100000);
+    OPT_ARG(double, adaptive_tolerance, 0.01);
+    OPT_ARG(int, adaptive_min_evaluations, 10000);
+    OPT_ARG(int, reference_max_evaluations, 100000);
+    // Relative difference w.r.t. the reference below which the fast result is considered compatible.
+    OPT_ARG(double, tolerance, 0.05);
+    OPT_ARG(std::string, working_path, "./");
+    OPT_ARG(std::string, output, "");
+    // Read the full entry only for the events that pass the pre-selection.
+    OPT_ARG(bool, two_phase_read, false);
+};
+
+namespace analysis {
+
+class SVfitModeValidation {
+public:
+    using clock = std::chrono::steady_clock;
+    using FitResults = sv_fit_ana::FitResults;
+
+    struct DifferenceStats {
+        size_t n{0}, n_within_tolerance{0};
+        double sum{0}, sum2{0}, max{0};
+
+        void Add(double reference, double value, double tolerance)
+        {
+            const double diff = reference != 0 ? (value - reference) / reference : 0.;
+            ++n;
+            sum += diff;
+            sum2 += diff * diff;
+            max = std::max(max, std::abs(diff));
+            n_within_tolerance += std::abs(diff) <= tolerance;
+        }
+
+        double GetMean() const { return n ? sum / n : 0.; }
+        double GetRMS() const { return n ? std::sqrt(sum2 / n) : 0.; }
+        double GetFractionWithinTolerance() const { return n ? static_cast<double>(n_within_tolerance) / n : 0.; }
+    };
+
+    SVfitModeValidation(const Arguments& _args) :
+        args(_args), channels(SplitValueListT<Channel>(args.channels(), false, ",")),
+        signalObjectSelector(args.selection()), bTagger(args.period(), args.btagger())
+    {
+        reference_settings.mode = sv_fit_ana::SVfitMode::Classic;
+        reference_settings.max_evaluations = args.reference_max_evaluations();
+        fast_settings.mode = args.mode();
+        fast_settings.max_evaluations = args.max_evaluations();
+        fast_settings.adaptive_tolerance = args.adaptive_tolerance();
+        fast_settings.adaptive_min_evaluations = args.adaptive_min_evaluations();
+        EventCandidate::InitializeUncertainties(args.period(), false, args.working_path(),
+                                                TauIdDiscriminator::byDeepTau2017v2p1VSjet);
+    }
+
+    void Run()
+    {
+        auto file = root_ext::OpenRootFile(args.input_file());
+        std::shared_ptr<TFile> preselection_file;
+        if(args.two_phase_read())
+            preselection_file = root_ext::OpenRootFile(args.input_file());
+        std::shared_ptr<std::ofstream> output;
+        if(!args.output().empty()) {
+            output = std::make_shared<std::ofstream>(args.output());
+            if(output->fail())
+                throw exception("Unable to create output file '%1%'.") % args.output();
+            *output << "channel,run,lumi,evt,ref_valid,ref_m,ref_m_error,ref_pt,ref_mt,ref_time_ms,fast_valid,"
+                       "fast_m,fast_m_error,fast_pt,fast_mt,fast_time_ms\n";
+        }
+
+        for(Channel channel : channels) {
+            std::shared_ptr<ntuple::EventTuple> tuple;
+            std::shared_ptr<ntuple::TwoPhaseEventTuple> two_phase_tuple;
+            try {
+                if(preselection_file) {
+                    two_phase_tuple = std::make_shared<ntuple::TwoPhaseEventTuple>(
+                            ToString(channel), file.get(), preselection_file.get(), ntuple::TreeState::Full,
+                            GetPreselectionBranches());
+                    tuple = two_phase_tuple->GetTuple();
+                } else {
+                    tuple = ntuple::CreateEventTuple(ToString(channel), file.get(), true, ntuple::TreeState::Full);
+                }
+            } catch(std::runtime_error&) {
+                std::cout << "Channel: " << channel << " not found." << std::endl;
+                continue;
+            }
+            const Long64_t n_entries = std::min(tuple->GetEntries(), args.max_events());
+            for(Long64_t entry = 0; entry < n_entries; ++entry) {
+                if(two_phase_tuple) {
+                    if(!PassPreSelection(two_phase_tuple->ReadPreselection(entry))) continue;
+                    two_phase_tuple->ReadFull(entry);
+                } else {
+                    tuple->GetEntry(entry);
+                    if(!PassPreSelection(tuple->data())) continue;
+                }
+                (*tuple)().isData = args.isData();
+                (*tuple)().period = static_cast<int>(args.period());
+                ProcessEvent(channel, tuple->data(), output.get());
+            }
+            if(two_phase_tuple)
+                two_phase_tuple->GetStats().Print(std::cout);
+        }
+        PrintSummary(std::cout);
+    }
+
+private:
+    // The pre-selection of CacheTupleProducer and at least one H->tautau candidate, which is required to create
+    // EventInfo. The trigger accept bits are not used: the SVfit comparison does not depend on the trigger.
+    bool PassPreSelection(const ntuple::Event& event) const
+    {
+        return SignalObjectSelector::PassLeptonVetoSelection(event)
+                && SignalObjectSelector::PassMETfilters(event, args.period(), args.isData())
+                && !event.first_daughter_indexes.empty();
+    }
+
+    static const std::set<std::string>& GetPreselectionBranches()
+    {
+        static const std::set<std::string> branches = [] {
+            std::set<std::string> names = ntuple::GetPreselectionBranches();
+            names.insert("first_daughter_indexes");
+            return names;
+        }();
+        return branches;
+    }
+
+    // Should be called only for the events that passed the pre-selection.
+    void ProcessEvent(Channel channel, const ntuple::Event& event, std::ostream* output)
+    {
+        const auto event_info = EventInfo::Create(event, signalObjectSelector, bTagger, args.btag_wp());
+        if(!event_info) return;
+
+        double reference_time, fast_time;
+        const FitResults reference = Fit(*event_info, reference_settings, reference_time);
+        const FitResults fast = Fit(*event_info, fast_settings, fast_time);
+        ++n_events;
+        total_reference_time += reference_time;
+        total_fast_time += fast_time;
+        n_reference_valid += reference.has_valid_momentum;
+        n_fast_valid += fast.has_valid_momentum;
+        if(reference.has_valid_momentum && fast.has_valid_momentum) {
+            mass_stats.Add(reference.momentum.mass(), fast.momentum.mass(), args.tolerance());
+            pt_stats.Add(reference.momentum.pt(), fast.momentum.pt(), args.tolerance());
+            mt_stats.Add(reference.transverseMass, fast.transverseMass, args.tolerance());
+        }
+
+        if(output) {
+            static constexpr double ms = 1e3;
+            const auto write_result = [&](const FitResults& result, double time) {
+                *output << result.has_valid_momentum << "," << result.momentum.mass() << ","
+                        << result.momentum_error.mass() << "," << result.momentum.pt() << ","
+                        << result.transverseMass << "," << time * ms;
+            };
+            *output << channel << "," << event.run << "," << event.lumi << "," << event.evt << ",";
+            write_result(reference, reference_time);
+            *output << ",";
+            write_result(fast, fast_time);
+            *output << "\n";
+        }
+    }
+
+    static FitResults Fit(const EventInfo& event_info, const sv_fit_ana::FitSettings& settings, double& time)
+    {
+        const auto start = clock::now();
+        const FitResults result = sv_fit_ana::FitProducer::Fit(event_info.GetLeg(1), event_info.GetLeg(2),
+                                                               event_info.GetMET(), settings);
+        time = std::chrono::duration<double>(clock::now() - start).count();
+        return result;
+    }
+
+    void PrintSummary(std::ostream& os) const
+    {
+        static constexpr double ms = 1e3;
+        const double reference_mean = n_events ? total_reference_time / n_events : 0.;
+        const double fast_mean = n_events ? total_fast_time / n_events : 0.;
+        os << "SVfit mode validation: " << fast_settings.mode << " vs " << reference_settings.mode << " with "
+           << reference_settings.max_evaluations << " evaluations.\n"
+           << "Number of events: " << n_events << "\n"
+           << "Valid results: reference = " << n_reference_valid << ", fast = " << n_fast_valid << "\n"
+           << std::setprecision(4) << "Mean time per event (ms): reference = " << reference_mean * ms
+           << ", fast = " << fast_mean * ms << ", speed-up = "
+           << (total_fast_time > 0 ? total_reference_time / total_fast_time : 0.) << "\n"
+           << "Relative difference w.r.t. the reference:\n"
+           << std::setw(10) << "variable" << std::setw(12) << "mean" << std::setw(12) << "rms" << std::setw(12)
+           << "max" << std::setw(16) << "within_tol" << "\n";
+        const auto print_stats = [&](const std::string& name, const DifferenceStats& stats) {
+            os << std::setw(10) << name << std::setw(12) << stats.GetMean() << std::setw(12) << stats.GetRMS()
+               << std::setw(12) << stats.max << std::setw(16) << stats.GetFractionWithinTolerance() << "\n";
+        };
+        print_stats("mass", mass_stats);
+        print_stats("pt", pt_stats);
+        print_stats("mt", mt_stats);
+        os << std::flush;
+    }
+
+private:
+    Arguments args;
+    std::vector<Channel> channels;
+    SignalObjectSelector signalObjectSelector;
+    BTagger bTagger;
+    sv_fit_ana::FitSettings reference_settings, fast_settings;
+    size_t n_events{0}, n_reference_valid{0}, n_fast_valid{0};
+    double total_reference_time{0}, total_fast_time{0};
+    DifferenceStats mass_stats, pt_stats, mt_stats;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::SVfitModeValidation, Arguments)
@@ -0,0 +1,439 @@
+/*! Generate tuples with random events that follow the structure and the typical content of the production tuples.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <random>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/Analysis/include/MetFilters.h"
+#include "h-tautau/Core/include/EventTuple.h"
+#include "h-tautau/Core/include/SummaryTuple.h"
+
+struct Arguments {
+    REQ_ARG(std::string, output_file);
+    OPT_ARG(std::string, channels, "eTau,muTau,tauTau");
+    OPT_ARG(analysis::Period, period, analysis::Period::Run2018);
+    OPT_ARG(size_t, n_events, 10000);
+    OPT_ARG(unsigned, seed, 12345);
+    // Tau energy scale corrections are applied to the MC events, which requires the TauPOG inputs to process them.
+    OPT_ARG(bool, isData, true);
+    OPT_ARG(size_t, max_n_extra_leptons, 2);
+    OPT_ARG(double, mean_n_jets, 4);
+    OPT_ARG(double, mean_n_fatJets, 0.3);
+    OPT_ARG(double, mean_n_other_leptons, 0.2);
+    OPT_ARG(double, ttbar_fraction, 0.3);
+    OPT_ARG(double, trigger_accept_probability, 0.3);
+    OPT_ARG(double, met_filters_fail_probability, 0.01);
+};
+
+namespace analysis {
+
+// The random number generator is seeded separately for each channel, so the content of a channel does not depend
+// on the other channels that are requested. The output is reproducible for a given seed and standard library.
+class SyntheticTupleGenerator {
+public:
+    using Event = ntuple::Event;
+    using LorentzVectorM = ntuple::LorentzVectorM;
+    using LorentzVectorE = ntuple::LorentzVectorE;
+
+    SyntheticTupleGenerator(const Arguments& _args) :
+        args(_args), channels(SplitValueListT<Channel>(args.channels(), false, ",")),
+        output_file(root_ext::CreateRootFile(args.output_file()))
+    {
+    }
+
+    void Run()
+    {
+        ntuple::SummaryTuple summary_tuple("summary", output_file.get(), false);
+        summary_tuple().exeTime = 0;
+        summary_tuple().numberOfProcessedEvents = 0;
+        summary_tuple().totalShapeWeight = 0;
+        summary_tuple().totalShapeWeight_withTopPt = 0;
+        summary_tuple().totalShapeWeight_withPileUp_Up = 0;
+        summary_tuple().totalShapeWeight_withPileUp_Down = 0;
+
+        for(Channel channel : channels) {
+            const uint64_t channel_id = static_cast<uint64_t>(channel) + 1;
+            gen.seed(static_cast<uint64_t>(args.seed()) ^ (0x9E3779B97F4A7C15ULL * channel_id));
+            auto tuple = ntuple::CreateEventTuple(ToString(channel), output_file.get(), false,
+                                                  ntuple::TreeState::Full);
+            size_t n_pairs = 0, n_jets = 0;
+            for(size_t n = 0; n < args.n_events(); ++n) {
+                Event& event = (*tuple)();
+                event = Event();
+                FillEvent(event, channel, n);
+                n_pairs += event.first_daughter_indexes.size();
+                n_jets += event.jets_p4.size();
+                summary_tuple().totalShapeWeight += event.genEventWeight;
+                summary_tuple().totalShapeWeight_withTopPt += event.genEventWeight;
+                summary_tuple().totalShapeWeight_withPileUp_Up += event.genEventWeight;
+                summary_tuple().totalShapeWeight_withPileUp_Down += event.genEventWeight;
+                tuple->Fill();
+            }
+            tuple->Write();
+            summary_tuple().numberOfProcessedEvents += args.n_events();
+            std::cout << channel << ": " << args.n_events() << " events, "
+                      << static_cast<double>(n_pairs) / std::max<size_t>(args.n_events(), 1)
+                      << " tau pairs/event, " << static_cast<double>(n_jets) / std::max<size_t>(args.n_events(), 1)
+                      << " jets/event." << std::endl;
+        }
+        summary_tuple.Fill();
+        summary_tuple.Write();
+    }
+
+private:
+    void FillEvent(Event& event, Channel channel, size_t index)
+    {
+        const bool is_data = args.isData();
+        event.run = 1;
+        event.lumi = static_cast<UInt_t>(1 + index / 1000);
+        event.evt = static_cast<ULong64_t>(channel) * args.n_events() + index + 1;
+        event.channelId = static_cast<int>(channel);
+        event.eventEnergyScale = 0;
+        event.genEventType = 0;
+        event.genEventWeight = is_data ? 1.f : static_cast<float>(Bernoulli(0.95) ? 1 : -1);
+        event.genEventLHEWeight = 1;
+        if(!is_data)
+            event.genEventPSWeights = { 1, 1, 1, 1 };
+        event.isData = is_data;
+        event.isEmbedded = false;
+        event.period = static_cast<int>(args.period());
+        event.npv = static_cast<int>(Poisson(35));
+        event.npu = is_data ? 0.f : static_cast<float>(Poisson(35));
+        event.rho = static_cast<float>(Uniform(5, 40));
+        event.l1_prefiring_weight = 1;
+        event.l1_prefiring_weight_up = 1;
+        event.l1_prefiring_weight_down = 1;
+
+        FillLeptons(event, channel);
+        FillMET(event);
+        FillJets(event);
+        FillFatJets(event);
+        FillOtherLeptons(event);
+        if(!is_data)
+            FillGenParticles(event);
+
+        event.trigger_accepts = RandomBits(args.trigger_accept_probability());
+        for(size_t n = 0; n < event.first_daughter_indexes.size(); ++n)
+            event.trigger_matches.push_back(RandomBits(0.5));
+        event.extraelec_veto = false;
+        event.extramuon_veto = false;
+    }
+
+    // Signal legs of the channel followed by extra leptons of the type of the second leg. All combinations of
+    // leptons with the leg types of the channel are stored as H->tautau candidates.
+    void FillLeptons(Event& event, Channel channel)
+    {
+        static const std::map<Channel, std::pair<LegType, LegType>> channel_legs = {
+            { Channel::ETau, { LegType::e, LegType::tau } }, { Channel::MuTau, { LegType::mu, LegType::tau } },
+            { Channel::TauTau, { LegType::tau, LegType::tau } }, { Channel::MuMu, { LegType::mu, LegType::mu } },
+        };
+        const auto& legs = channel_legs.at(channel);
+        std::vector<LegType> leg_types = { legs.first, legs.second };
+        const size_t n_extra = std::uniform_int_distribution<size_t>(0, args.max_n_extra_leptons())(gen);
+        leg_types.insert(leg_types.end(), n_extra, legs.second);
+
+        for(LegType leg_type : leg_types)
+            AddLepton(event, leg_type, event.lep_q.size() == 1 ? -event.lep_q.at(0) : 0);
+
+        for(size_t first = 0; first < leg_types.size(); ++first) {
+            if(leg_types.at(first) != legs.first) continue;
+            for(size_t second = 0; second < leg_types.size(); ++second) {
+                if(leg_types.at(second) != legs.second || second == first) continue;
+                if(legs.first == legs.second && second < first) continue;
+                event.first_daughter_indexes.push_back(first);
+                event.second_daughter_indexes.push_back(second);
+            }
+        }
+    }
+
+    // If preferred_charge is not zero, it is assigned in 80% of the cases.
+    void AddLepton(Event& event, LegType leg_type, int preferred_charge)
+    {
+        static const std::vector<int> tau_decay_modes = { 0, 1, 10, 11, 5, 6 };
+        static const std::vector<double> tau_decay_mode_weights = { 0.25, 0.45, 0.2, 0.07, 0.015, 0.015 };
+        const bool is_tau = leg_type == LegType::tau;
+
+        int decay_mode = -1;
+        double mass = leg_type == LegType::e ? 0.000511 : 0.10566;
+        if(is_tau) {
+            decay_mode = tau_decay_modes.at(Discrete(tau_decay_mode_weights));
+            mass = decay_mode == 0 ? 0.13957 : Uniform(0.3, 1.5);
+        }
+        const LorentzVectorM p4 = RandomMomentum(20, 30, 2.3, mass);
+        const int charge = preferred_charge != 0 && Bernoulli(0.8) ? preferred_charge : (Bernoulli(0.5) ? 1 : -1);
+        const int gen_match = DrawGenMatch(leg_type);
+
+        event.lep_p4.push_back(p4);
+        event.lep_q.push_back(charge);
+        event.lep_type.push_back(static_cast<int>(leg_type));
+        event.lep_dxy.push_back(static_cast<float>(Gauss(0, 0.01)));
+        event.lep_dz.push_back(static_cast<float>(Gauss(0, 0.05)));
+        event.lep_iso.push_back(is_tau ? static_cast<float>(Uniform(0, 1)) : static_cast<float>(Exponential(0.1)));
+        event.lep_gen_match.push_back(gen_match);
+        event.lep_gen_p4.push_back(event.isData ? LorentzVectorM() : Smear(p4, 0.05));
+        event.lep_gen_visible_p4.push_back(event.isData ? LorentzVectorM() : Smear(p4, 0.03));
+        event.lep_gen_chargedParticles.push_back(is_tau ? (decay_mode >= 10 ? 3 : 1) : 0);
+        event.lep_gen_neutralParticles.push_back(is_tau ? decay_mode % 10 : 0);
+        event.lep_decayMode.push_back(decay_mode);
+        event.lep_oldDecayModeFinding.push_back(is_tau && (decay_mode == 0 || decay_mode == 1 || decay_mode == 10));
+        event.lep_newDecayModeFinding.push_back(is_tau);
+        event.lep_elePassConversionVeto.push_back(leg_type == LegType::e && Bernoulli(0.95));
+        event.lep_eleId_iso.push_back(leg_type == LegType::e ? WPBits(DrawWPLevel(0.9)) : 0);
+        event.lep_eleId_noIso.push_back(leg_type == LegType::e ? WPBits(DrawWPLevel(0.92)) : 0);
+        event.lep_muonId.push_back(leg_type == LegType::mu ? WPBits(DrawWPLevel(0.9)) : 0);
+        event.lep_genTauIndex.push_back(-1);
+
+#define TAU_ID(name, pattern, has_raw, wp_list) \
+        { \
+            const size_t n_passed = is_tau ? DrawWPLevel(GetPassProbability(TauIdDiscriminator::name)) : 0; \
+            event.name.push_back(WPBits(n_passed)); \
+            event.name##raw.push_back(is_tau ? WPRaw(n_passed) : 0.f); \
+        }
+        TAU_IDS()
+#undef TAU_ID
+    }
+
+    void FillMET(Event& event)
+    {
+        event.pfMET_p4 = LorentzVectorM(static_cast<float>(Exponential(40)), 0.f, static_cast<float>(Phi()), 0.f);
+        const double sigma2_x = Uniform(200, 800), sigma2_y = Uniform(200, 800);
+        event.pfMET_cov(0, 0) = sigma2_x;
+        event.pfMET_cov(1, 1) = sigma2_y;
+        event.pfMET_cov(0, 1) = event.pfMET_cov(1, 0) = Uniform(-0.3, 0.3) * std::sqrt(sigma2_x * sigma2_y);
+
+        ntuple::MetFilters filters;
+        for(size_t n = 0; n < ntuple::MetFilters::NumberOfFilters; ++n)
+            filters.SetResult(static_cast<ntuple::MetFilters::Filter>(n),
+                              !Bernoulli(args.met_filters_fail_probability()));
+        event.metFilters = filters.FilterResults();
+        if(!event.isData)
+            event.genMET_p4 = Smear(event.pfMET_p4, 0.2);
+    }
+
+    void FillJets(Event& event)
+    {
+        static const std::vector<int> flavours = { 5, 4, 0 };
+        static const std::vector<double> flavour_weights = { 0.25, 0.15, 0.6 };
+
+        const size_t n_jets = Poisson(args.mean_n_jets());
+        for(size_t n = 0; n < n_jets; ++n) {
+            const int flavour = flavours.at(Discrete(flavour_weights));
+            const double pt = 20 + Exponential(40);
+            const LorentzVectorE p4(RandomMomentum(pt, 0, 4.7, pt * Uniform(0.05, 0.2), 2));
+
+            // DeepFlavour probabilities: b-like fraction depends on the flavour, the rest is shared by c, uds and g.
+            const double u = Uniform(0, 1);
+            const double prob_b_like = flavour == 5 ? std::pow(u, 0.15) : flavour == 4 ? 0.5 * u : std::pow(u, 6);
+            const double c_fraction = flavour == 4 ? 0.6 : 0.1, uds_fraction = Uniform(0, 1 - c_fraction);
+            const double prob_rest = 1 - prob_b_like;
+            event.jets_p4.push_back(p4);
+            event.jets_deepFlavour_b.push_back(static_cast<float>(0.8 * prob_b_like));
+            event.jets_deepFlavour_bb.push_back(static_cast<float>(0.1 * prob_b_like));
+            event.jets_deepFlavour_lepb.push_back(static_cast<float>(0.1 * prob_b_like));
+            event.jets_deepFlavour_c.push_back(static_cast<float>(c_fraction * prob_rest));
+            event.jets_deepFlavour_uds.push_back(static_cast<float>(uds_fraction * prob_rest));
+            event.jets_deepFlavour_g.push_back(static_cast<float>((1 - c_fraction - uds_fraction) * prob_rest));
+            event.jets_csv.push_back(static_cast<float>(prob_b_like * Uniform(0.9, 1)));
+            event.jets_deepCsv_BvsAll.push_back(static_cast<float>(prob_b_like * Uniform(0.9, 1)));
+            event.jets_deepCsv_CvsB.push_back(static_cast<float>(Uniform(0, 1)));
+            event.jets_deepCsv_CvsL.push_back(static_cast<float>(Uniform(0, 1)));
+            event.jets_rawf.push_back(static_cast<float>(Uniform(0.8, 1)));
+            const uint16_t pu_id = PuIdBits();
+            event.jets_pu_id.push_back(pu_id);
+            event.jets_pu_id_raw.push_back(static_cast<float>(Uniform(-1, 1)));
+            event.jets_pu_id_upd.push_back(pu_id);
+            event.jets_pu_id_upd_raw.push_back(static_cast<float>(Uniform(-1, 1)));
+            event.jets_partonFlavour.push_back(flavour != 0 ? flavour : (Bernoulli(0.5) ? 21 : 1));
+            event.jets_hadronFlavour.push_back(flavour);
+            event.jets_resolution.push_back(static_cast<float>(Uniform(0.05, 0.2)));
+            event.jets_triggerFilterMatch.push_back(0);
+            event.jets_triggerFilterMatch_0.push_back(RandomBits(0.2));
+            event.jets_triggerFilterMatch_1.push_back(0);
+            event.jets_triggerFilterMatch_2.push_back(0);
+            event.jets_triggerFilterMatch_3.push_back(0);
+
+            int gen_jet_index = -1;
+            if(!event.isData && Bernoulli(0.9)) {
+                gen_jet_index = static_cast<int>(event.genJets_p4.size());
+                event.genJets_p4.push_back(Smear(p4, 0.1));
+                event.genJets_hadronFlavour.push_back(flavour);
+            }
+            event.jets_genJetIndex.push_back(gen_jet_index);
+            if(flavour == 5) ++event.jets_nTotal_hadronFlavour_b;
+            if(flavour == 4) ++event.jets_nTotal_hadronFlavour_c;
+        }
+        event.genJets_nTotal = static_cast<UInt_t>(event.genJets_p4.size());
+    }
+
+    void FillFatJets(Event& event)
+    {
+        const size_t n_fatJets = Poisson(args.mean_n_fatJets());
+        for(size_t n = 0; n < n_fatJets; ++n) {
+            const double pt = 200 + Exponential(100);
+            const double m_softDrop = std::max(10., Gauss(110, 30));
+            const LorentzVectorE p4(RandomMomentum(pt, 0, 2.4, 1.1 * m_softDrop, 1.5));
+            const double tau1 = Uniform(0.1, 0.5), tau2 = tau1 * Uniform(0.2, 0.9), tau3 = tau2 * Uniform(0.3, 0.9),
+                         tau4 = tau3 * Uniform(0.3, 0.9);
+            event.fatJets_p4.push_back(p4);
+            event.fatJets_m_softDrop.push_back(static_cast<float>(m_softDrop));
+            event.fatJets_jettiness_tau1.push_back(static_cast<float>(tau1));
+            event.fatJets_jettiness_tau2.push_back(static_cast<float>(tau2));
+            event.fatJets_jettiness_tau3.push_back(static_cast<float>(tau3));
+            event.fatJets_jettiness_tau4.push_back(static_cast<float>(tau4));
+            for(size_t k = 0; k < 2; ++k) {
+                event.subJets_p4.push_back(LorentzVectorE(RandomMomentum(pt * Uniform(0.3, 0.7), 0, 2.4, 5, 1.5)));
+                event.subJets_parentIndex.push_back(n);
+            }
+        }
+    }
+
+    // Leptons that are considered by the third lepton veto. Most of them fail the veto identification.
+    void FillOtherLeptons(Event& event)
+    {
+        const size_t n_other = Poisson(args.mean_n_other_leptons());
+        for(size_t n = 0; n < n_other; ++n) {
+            const LegType leg_type = Bernoulli(0.5) ? LegType::e : LegType::mu;
+            const LorentzVectorM p4 = RandomMomentum(10, 20, 2.4, leg_type == LegType::e ? 0.000511 : 0.10566);
+            event.other_lepton_p4.push_back(p4);
+            event.other_lepton_q.push_back(Bernoulli(0.5) ? 1 : -1);
+            event.other_lepton_type.push_back(static_cast<int>(leg_type));
+            event.other_lepton_gen_match.push_back(DrawGenMatch(leg_type));
+            event.other_lepton_gen_p4.push_back(event.isData ? LorentzVectorM() : Smear(p4, 0.05));
+            event.other_lepton_iso.push_back(static_cast<float>(Exponential(0.2)));
+            event.other_lepton_elePassConversionVeto.push_back(leg_type == LegType::e);
+            event.other_lepton_eleId_iso.push_back(leg_type == LegType::e ? WPBits(DrawWPLevel(0.6)) : 0);
+            event.other_lepton_eleId_noIso.push_back(leg_type == LegType::e ? WPBits(DrawWPLevel(0.6)) : 0);
+            event.other_lepton_muonId.push_back(leg_type == LegType::mu ? WPBits(DrawWPLevel(0.6)) : 0);
+        }
+    }
+
+    // Only top quarks are stored, which is what is needed to compute the top pt reweighting.
+    void FillGenParticles(Event& event)
+    {
+        if(Bernoulli(args.ttbar_fraction())) {
+            for(int pdg : { 6, -6 }) {
+                event.genParticles_index.push_back(static_cast<int>(event.genParticles_index.size()));
+                event.genParticles_status.push_back(62);
+                event.genParticles_vertex.push_back(ntuple::Point3D());
+                event.genParticles_statusFlags.push_back(0);
+                event.genParticles_pdg.push_back(pdg);
+                event.genParticles_p4.push_back(RandomMomentum(0, 100, 5, 172.5, 2));
+            }
+        }
+        for(int gen_match : event.lep_gen_match) {
+            const GenLeptonMatch match = static_cast<GenLeptonMatch>(gen_match);
+            if(match == GenLeptonMatch::Electron) ++event.genParticles_nPromptElectrons;
+            if(match == GenLeptonMatch::Muon) ++event.genParticles_nPromptMuons;
+            if(match == GenLeptonMatch::Tau) ++event.genParticles_nPromptTaus;
+        }
+    }
+
+    int DrawGenMatch(LegType leg_type)
+    {
+        static const std::vector<int> matches = { 1, 2, 3, 4, 5, 6 };
+        static const std::map<LegType, std::vector<double>> match_weights = {
+            { LegType::e, { 0.6, 0, 0.2, 0, 0, 0.2 } },
+            { LegType::mu, { 0, 0.6, 0, 0.2, 0, 0.2 } },
+            { LegType::tau, { 0.03, 0.03, 0.02, 0.02, 0.7, 0.2 } },
+        };
+        if(args.isData()) return static_cast<int>(GenLeptonMatch::NoMatch);
+        return matches.at(Discrete(match_weights.at(leg_type)));
+    }
+
+    static double GetPassProbability(TauIdDiscriminator discriminator)
+    {
+        static const std::set<TauIdDiscriminator> against_leptons = {
+            TauIdDiscriminator::againstElectronMVA6, TauIdDiscriminator::againstElectronMVA62018,
+            TauIdDiscriminator::againstMuon3, TauIdDiscriminator::byDeepTau2017v2p1VSe,
+            TauIdDiscriminator::byDeepTau2017v2p1VSmu,
+        };
+        return against_leptons.count(discriminator) ? 0.95 : 0.85;
+    }
+
+    // Number of consecutive working points passed, starting from the loosest one.
+    size_t DrawWPLevel(double pass_probability)
+    {
+        static constexpr size_t n_wp = static_cast<size_t>(DiscriminatorWP::VVVTight) + 1;
+        size_t n_passed = 0;
+        while(n_passed < n_wp && Bernoulli(pass_probability))
+            ++n_passed;
+        return n_passed;
+    }
+
+    static uint16_t WPBits(size_t n_passed)
+    {
+        DiscriminatorIdResults results;
+        for(size_t wp = 0; wp < n_passed; ++wp)
+            results.SetResult(static_cast<DiscriminatorWP>(wp), true);
+        return results.GetResultBits();
+    }
+
+    // Raw discriminator value that is consistent with the passed working points.
+    float WPRaw(size_t n_passed)
+    {
+        static constexpr double n_levels = static_cast<double>(DiscriminatorWP::VVVTight) + 2;
+        return static_cast<float>((n_passed + Uniform(0, 1)) / n_levels);
+    }
+
+    uint16_t PuIdBits()
+    {
+        DiscriminatorIdResults results;
+        bool pass = true;
+        for(DiscriminatorWP wp : { DiscriminatorWP::Loose, DiscriminatorWP::Medium, DiscriminatorWP::Tight }) {
+            pass = pass && Bernoulli(0.9);
+            results.SetResult(wp, pass);
+        }
+        return results.GetResultBits();
+    }
+
+    // pt = min_pt + exponential with the given mean; eta is gaussian with the given width if eta_sigma > 0,
+    // uniform otherwise, and is truncated at max_abs_eta.
+    LorentzVectorM RandomMomentum(double min_pt, double mean_pt, double max_abs_eta, double mass,
+                                  double eta_sigma = 0)
+    {
+        const double pt = mean_pt > 0 ? min_pt + Exponential(mean_pt) : min_pt;
+        const double eta = eta_sigma > 0 ? std::clamp(Gauss(0, eta_sigma), -max_abs_eta, max_abs_eta)
+                                         : Uniform(-max_abs_eta, max_abs_eta);
+        return LorentzVectorM(static_cast<float>(pt), static_cast<float>(eta), static_cast<float>(Phi()),
+                              static_cast<float>(mass));
+    }
+
+    template<typename LVector>
+    LVector Smear(const LVector& p4, double relative_resolution)
+    {
+        const double scale = std::max(0., Gauss(1, relative_resolution));
+        return LVector(LorentzVectorM(static_cast<float>(p4.pt() * scale), static_cast<float>(p4.eta()),
+                                      static_cast<float>(p4.phi()), static_cast<float>(p4.mass())));
+    }
+
+    ULong64_t RandomBits(double probability)
+    {
+        ULong64_t bits = 0;
+        for(size_t n = 0; n < std::numeric_limits<ULong64_t>::digits; ++n) {
+            if(Bernoulli(probability))
+                bits |= ULong64_t(1) << n;
+        }
+        return bits;
+    }
+
+    double Uniform(double a, double b) { return std::uniform_real_distribution<double>(a, b)(gen); }
+    double Phi() { return Uniform(-M_PI, M_PI); }
+    double Gauss(double mean, double sigma) { return std::normal_distribution<double>(mean, sigma)(gen); }
+    double Exponential(double mean) { return std::exponential_distribution<double>(1. / mean)(gen); }
+    bool Bernoulli(double p) { return std::bernoulli_distribution(p)(gen); }
+    size_t Poisson(double mean) { return mean > 0 ? std::poisson_distribution<size_t>(mean)(gen) : 0; }
+    size_t Discrete(const std::vector<double>& weights)
+    {
+        return std::discrete_distribution<size_t>(weights.begin(), weights.end())(gen);
+    }
+
+private:
+    Arguments args;
+    std::vector<Channel> channels;
+    std::shared_ptr<TFile> output_file;
+    std::mt19937_64 gen;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::SyntheticTupleGenerator, Arguments)
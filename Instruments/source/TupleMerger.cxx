@@ -1,12 +1,14 @@
 /*! Merge multiple root files into a single file splitting by channels.
 This file is part of https://github.com/hh-italian-group/h-tautau. */
 
+#include <TTree.h>
+#include <TTreeCacheUnzip.h>
 #include "AnalysisTools/Core/include/RootFilesMerger.h"
-#include "AnalysisTools/Core/include/EventIdentifier.h"
 #include "AnalysisTools/Run/include/program_main.h"
 #include "h-tautau/Core/include/EventTuple.h"
 #include "h-tautau/Core/include/SummaryTuple.h"
 #include "h-tautau/Core/include/AnalysisTypes.h"
+#include "h-tautau/Instruments/include/EventIdSet.h"
 
 struct Arguments {
     run::Argument<std::string> output{"output", "output root file"};
@@ -17,6 +19,10 @@ struct Arguments {
     run::Argument<std::string> exclude_dir_list{"exclude-dir-list",
                                                 "comma separated list of directories to exclude", ""};
     run::Argument<unsigned> n_threads{"n-threads", "number of threads", 1};
+    run::Argument<size_t> max_dedup_memory{"max-dedup-memory",
+                                           "memory budget in MB of each duplicate detection set (0 = unlimited)", 0};
+    run::Argument<std::string> spill_dir{"spill-dir",
+                                         "directory to spill event ids when the memory budget is exceeded", ""};
 };
 
 class TupleMerger : public analysis::RootFilesMerger {
@@ -25,8 +31,16 @@ public:
         RootFilesMerger(args.output(), args.input_dirs(), args.file_name_pattern(), args.exclude_list(),
                         args.exclude_dir_list(), args.n_threads(), ROOT::kLZ4, 5),
         output_summaryTuple("summary", output_file.get(), false),
-        n_total_duplicates(0), n_total_epress_duplicates(0)
+        max_dedup_memory(args.max_dedup_memory() * 1024 * 1024), spill_dir(args.spill_dir()),
+        processed_entries_express(max_dedup_memory, spill_dir), n_total_duplicates(0), n_total_epress_duplicates(0)
     {
+        if(max_dedup_memory && spill_dir.empty())
+            throw analysis::exception("Spill directory should be specified together with max-dedup-memory.");
+        if(args.n_threads() > 1) {
+            if(!ROOT::IsImplicitMTEnabled())
+                ROOT::EnableImplicitMT(args.n_threads());
+            TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+        }
     }
 
     void Run()
@@ -35,10 +49,11 @@ public:
 
         std::cout << "All file has been merged. Number of files = " << input_files.size() << std::endl;
 
-        for(const auto& iter : output_eventTuple){
-          iter.second->Write();
+        for(const auto& iter : output_trees){
+          iter.second->Write("", TObject::kOverwrite);
           std::cout << ". Number of output entries = " << iter.second->GetEntries() << std::endl;
         }
+        std::cout << ". Number of fast cloned files = " << n_fast_cloned_files << "." << std::endl;
         output_summaryTuple.Write();
         if(output_expressTuple)
             output_expressTuple->Write();
@@ -47,27 +62,120 @@ public:
         if(output_expressTuple)
             std::cout << ". Total number of duplicated express entries = " << n_total_epress_duplicates << "."
                       << std::endl;
+        ReportDuplicateDetectionUsage();
     }
 
 private:
+    analysis::EventIdSet& GetProcessedEntries(analysis::Channel channel)
+    {
+        auto& entries = processed_entries[channel];
+        if(!entries)
+            entries = std::make_unique<analysis::EventIdSet>(max_dedup_memory, spill_dir);
+        return *entries;
+    }
+
+    void ReportDuplicateDetectionUsage() const
+    {
+        size_t memory = processed_entries_express.GetMemoryUsage();
+        size_t n_spills = processed_entries_express.GetNumberOfSpills();
+        for(const auto& entries : processed_entries) {
+            memory += entries.second->GetMemoryUsage();
+            n_spills += entries.second->GetNumberOfSpills();
+        }
+        std::cout << ". Duplicate detection memory usage = " << memory / 1024. / 1024. << " MB, number of spills = "
+                  << n_spills << "." << std::endl;
+    }
+
+    // Reads only the event id branches, registers the ids in the duplicate detection sets and returns the channel
+    // of each entry (or duplicated_entry). Afterwards the branch status corresponds to TreeState::Full.
+    std::vector<int> SelectEntries(TTree& tree, size_t& n_duplicates)
+    {
+        UInt_t run, lumi;
+        ULong64_t evt;
+        Int_t channelId;
+        tree.SetBranchStatus("*", 0);
+        tree.SetBranchStatus("run", 1);
+        tree.SetBranchStatus("lumi", 1);
+        tree.SetBranchStatus("evt", 1);
+        tree.SetBranchStatus("channelId", 1);
+        tree.SetBranchAddress("run", &run);
+        tree.SetBranchAddress("lumi", &lumi);
+        tree.SetBranchAddress("evt", &evt);
+        tree.SetBranchAddress("channelId", &channelId);
+
+        std::vector<int> entry_channels(static_cast<size_t>(tree.GetEntries()), duplicated_entry);
+        for(Long64_t entry = 0; entry < tree.GetEntries(); ++entry) {
+            tree.GetEntry(entry);
+            const analysis::Channel channel = static_cast<analysis::Channel>(channelId);
+            if(GetProcessedEntries(channel).Insert(analysis::PackedEventId(run, lumi, evt)))
+                entry_channels[static_cast<size_t>(entry)] = channelId;
+            else
+                ++n_duplicates;
+        }
+
+        tree.ResetBranchAddresses();
+        tree.SetBranchStatus("*", 1);
+        for(const auto& branch_name : ntuple::GetDisabledBranches(ntuple::TreeState::Full)) {
+            if(tree.GetBranch(branch_name.c_str()))
+                tree.SetBranchStatus(branch_name.c_str(), 0);
+        }
+        return entry_channels;
+    }
+
     virtual void ProcessFile(const std::string& /*file_name*/, const std::shared_ptr<TFile>& file) override
     {
-        auto eventTuple = ntuple::CreateEventTuple("events", file.get(), true, ntuple::TreeState::Full);
+        auto input_tree = dynamic_cast<TTree*>(file->Get("events"));
+        if(!input_tree)
+            throw analysis::exception("Events tree not found in '%1%'.") % file->GetName();
+
         size_t n_duplicates = 0;
-        for(const auto& event : *eventTuple) {
-            const analysis::Channel channel = static_cast<analysis::Channel>(event.channelId);
-            const analysis::EventIdentifier eventId(event.run,event.lumi,event.evt);
-            if(processed_entries[channel].count(eventId)) {
-                ++n_duplicates;
-                continue;
+        const auto entry_channels = SelectEntries(*input_tree, n_duplicates);
+        std::set<int> file_channels(entry_channels.begin(), entry_channels.end());
+        file_channels.erase(duplicated_entry);
+
+        for(const auto& channel_id : file_channels) {
+            const auto channel = static_cast<analysis::Channel>(channel_id);
+            TTree*& output_tree = output_trees[channel];
+            if(!output_tree) {
+                output_file->cd();
+                output_tree = input_tree->CloneTree(0);
+                output_tree->SetName(analysis::ToString(channel).c_str());
+                output_tree->SetTitle(analysis::ToString(channel).c_str());
+                output_tree->SetDirectory(output_file.get());
+                ntuple::ApplyEventBranchCompression(*output_tree);
+            }
+        }
+
+        // Fast cloning copies the input baskets as they are, so it is used only when the whole file goes to a single
+        // output tree and the input branches are already compressed as defined by the event branch compression
+        // rules. Otherwise the entries are copied one by one and recompressed with the output settings.
+        std::string copy_mode;
+        if(file_channels.empty())
+            copy_mode = "none (no entries to copy)";
+        else if(n_duplicates != 0)
+            copy_mode = "entry copy (duplicated entries)";
+        else if(file_channels.size() > 1)
+            copy_mode = "entry copy (multiple channels)";
+        else if(!ntuple::HasEventBranchCompression(*input_tree))
+            copy_mode = "entry copy (input compression differs from the output compression)";
+
+        if(copy_mode.empty()) {
+            const auto channel = static_cast<analysis::Channel>(*file_channels.begin());
+            output_trees.at(channel)->CopyEntries(input_tree, -1, "fast");
+            ++n_fast_cloned_files;
+            copy_mode = "fast clone";
+        } else {
+            for(const auto& channel_id : file_channels)
+                input_tree->CopyAddresses(output_trees.at(static_cast<analysis::Channel>(channel_id)));
+            for(Long64_t entry = 0; entry < input_tree->GetEntries(); ++entry) {
+                const int channel_id = entry_channels.at(static_cast<size_t>(entry));
+                if(channel_id == duplicated_entry) continue;
+                input_tree->GetEntry(entry);
+                output_trees.at(static_cast<analysis::Channel>(channel_id))->Fill();
             }
-            processed_entries[channel].insert(eventId);
-            if(!output_eventTuple[channel])
-                output_eventTuple[channel] = ntuple::CreateEventTuple(analysis::ToString(channel), output_file.get(),
-                                                                      false, ntuple::TreeState::Full);
-            (*output_eventTuple[channel])() = event;
-            output_eventTuple[channel]->Fill();
         }
+        for(const auto& channel_id : file_channels)
+            input_tree->CopyAddresses(output_trees.at(static_cast<analysis::Channel>(channel_id)), true);
         n_total_duplicates += n_duplicates;
 
         auto input_summaryTuple = CreateSummaryTuple("summary", file.get(), true, ntuple::TreeState::Full);
@@ -86,20 +194,21 @@ private:
         if(input_expressTuple) {
             if(!output_expressTuple)
                 output_expressTuple = std::make_shared<ntuple::ExpressTuple>("all_events", output_file.get(), false);
-            for(const ntuple::ExpressEvent& express : *input_expressTuple) {
-                const analysis::EventIdentifier expressEventId(express.run,express.lumi,express.evt);
-                if(processed_entries_express.count(expressEventId)) {
+            for(Long64_t entry = 0; entry < input_expressTuple->GetEntries(); ++entry) {
+                input_expressTuple->GetEntry(entry);
+                ntuple::ExpressEvent& express = (*input_expressTuple)();
+                if(!processed_entries_express.Insert(analysis::PackedEventId(express.run, express.lumi, express.evt))) {
                     ++n_express_duplicates;
                     continue;
                 }
-                processed_entries_express.insert(expressEventId);
-                (*output_expressTuple)() = express;
+                swap(express, (*output_expressTuple)());
                 output_expressTuple->Fill();
             }
             n_total_epress_duplicates += n_express_duplicates;
         }
 
-        std::cout << "\tn_entries = " << eventTuple->GetEntries() << ", n_duplicates = " << n_duplicates << ".\n";
+        std::cout << "\tn_entries = " << input_tree->GetEntries() << ", n_duplicates = " << n_duplicates
+                  << ", copy mode = " << copy_mode << ".\n";
         if(input_expressTuple) {
             std::cout << "\tn_express_entries = " << input_expressTuple->GetEntries() << ", n_express_duplicates = "
                       << n_express_duplicates << ".\n";
@@ -107,12 +216,16 @@ private:
     }
 
 private:
-    std::map<analysis::Channel, std::shared_ptr<ntuple::EventTuple>> output_eventTuple;
+    static constexpr int duplicated_entry = -1;
+
+    std::map<analysis::Channel, TTree*> output_trees;
     ntuple::SummaryTuple output_summaryTuple;
     std::shared_ptr<ntuple::ExpressTuple> output_expressTuple;
-    std::map<analysis::Channel, std::set<analysis::EventIdentifier>> processed_entries;
-    std::set<analysis::EventIdentifier> processed_entries_express;
-    size_t n_total_duplicates, n_total_epress_duplicates;
+    const size_t max_dedup_memory;
+    const std::string spill_dir;
+    std::map<analysis::Channel, std::unique_ptr<analysis::EventIdSet>> processed_entries;
+    analysis::EventIdSet processed_entries_express;
+    size_t n_total_duplicates, n_total_epress_duplicates, n_fast_cloned_files{0};
 };
 
 PROGRAM_MAIN(TupleMerger, Arguments)
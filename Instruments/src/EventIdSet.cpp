@@ -0,0 +1,193 @@
+/*! Compact, memory-bounded set of event identifiers used for duplicate detection.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Instruments/include/EventIdSet.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <boost/filesystem.hpp>
+#include "AnalysisTools/Core/include/exception.h"
+
+namespace analysis {
+
+namespace {
+uint64_t MixBits(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+} // anonymous namespace
+
+PackedEventId::PackedEventId() :
+    run_lumi(std::numeric_limits<uint64_t>::max()), evt(std::numeric_limits<uint64_t>::max()) {}
+
+PackedEventId::PackedEventId(uint32_t run, uint32_t lumi, uint64_t _evt) :
+    run_lumi((static_cast<uint64_t>(run) << 32) | lumi), evt(_evt) {}
+
+uint64_t PackedEventId::Hash() const { return MixBits(run_lumi ^ MixBits(evt)); }
+
+bool EventIdSet::SpilledRun::Contains(const PackedEventId& id) const
+{
+    const uint64_t hash = id.Hash();
+    const size_t n_bits = bloom_filter.size() * 64;
+    for(size_t n = 0; n < bloom_n_hashes; ++n) {
+        const size_t bit = BloomBit(hash, n, n_bits);
+        if(!(bloom_filter[bit / 64] & (uint64_t(1) << (bit % 64))))
+            return false;
+    }
+
+    size_t first = 0, last = n_entries;
+    PackedEventId entry;
+    while(first < last) {
+        const size_t mid = first + (last - first) / 2;
+        file.seekg(static_cast<std::streamoff>(mid * sizeof(PackedEventId)));
+        file.read(reinterpret_cast<char*>(&entry), sizeof(PackedEventId));
+        if(!file)
+            throw exception("Unable to read event ids from '%1%'.") % file_name;
+        if(entry == id) return true;
+        if(entry < id)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    return false;
+}
+
+EventIdSet::EventIdSet(size_t _max_memory, const std::string& _spill_dir) :
+    max_memory(_max_memory), spill_dir(_spill_dir), table(initial_capacity)
+{
+}
+
+EventIdSet::~EventIdSet()
+{
+    for(const auto& run : runs) {
+        run->file.close();
+        std::remove(run->file_name.c_str());
+    }
+}
+
+bool EventIdSet::Insert(const PackedEventId& id)
+{
+    if(IsEmpty(id)) {
+        const bool is_new = !has_empty_key;
+        has_empty_key = true;
+        return is_new;
+    }
+    size_t slot = FindSlot(id);
+    if(!IsEmpty(table[slot])) return false;
+    for(const auto& run : runs) {
+        if(run->Contains(id)) return false;
+    }
+
+    if((n_entries + 1) * max_load_denominator > table.size() * max_load_numerator) {
+        const size_t new_capacity = table.size() * 2;
+        if(max_memory && !spill_dir.empty() && new_capacity * sizeof(PackedEventId) > max_memory)
+            Spill();
+        else
+            Rehash(new_capacity);
+        slot = FindSlot(id);
+    }
+    table[slot] = id;
+    ++n_entries;
+    return true;
+}
+
+bool EventIdSet::Contains(const PackedEventId& id) const
+{
+    if(ContainsInMemory(id)) return true;
+    for(const auto& run : runs) {
+        if(run->Contains(id)) return true;
+    }
+    return false;
+}
+
+size_t EventIdSet::GetMemoryUsage() const
+{
+    size_t usage = table.capacity() * sizeof(PackedEventId);
+    for(const auto& run : runs)
+        usage += run->bloom_filter.capacity() * sizeof(uint64_t);
+    return usage;
+}
+
+size_t EventIdSet::FindSlot(const PackedEventId& id) const
+{
+    const size_t mask = table.size() - 1;
+    size_t slot = static_cast<size_t>(id.Hash()) & mask;
+    while(!IsEmpty(table[slot]) && table[slot] != id)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+bool EventIdSet::ContainsInMemory(const PackedEventId& id) const
+{
+    if(IsEmpty(id)) return has_empty_key;
+    return !IsEmpty(table[FindSlot(id)]);
+}
+
+void EventIdSet::Rehash(size_t new_capacity)
+{
+    std::vector<PackedEventId> old_table(new_capacity);
+    std::swap(table, old_table);
+    for(const auto& id : old_table) {
+        if(!IsEmpty(id))
+            table[FindSlot(id)] = id;
+    }
+}
+
+void EventIdSet::Spill()
+{
+    auto run = std::make_unique<SpilledRun>();
+    const auto file_path = boost::filesystem::path(spill_dir)
+            / boost::filesystem::unique_path("event_ids_%%%%-%%%%-%%%%-%%%%.bin");
+    run->file_name = file_path.string();
+    run->n_entries = n_entries;
+
+    std::vector<PackedEventId> sorted_ids;
+    sorted_ids.reserve(n_entries);
+    for(auto& id : table) {
+        if(!IsEmpty(id))
+            sorted_ids.push_back(id);
+        id = PackedEventId();
+    }
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+
+    {
+        std::ofstream output(run->file_name, std::ios::binary);
+        output.write(reinterpret_cast<const char*>(sorted_ids.data()),
+                     static_cast<std::streamsize>(sorted_ids.size() * sizeof(PackedEventId)));
+        if(!output)
+            throw exception("Unable to write event ids into '%1%'.") % run->file_name;
+    }
+
+    const size_t n_words = std::max<size_t>(1, (sorted_ids.size() * bloom_bits_per_entry + 63) / 64);
+    run->bloom_filter.assign(n_words, 0);
+    const size_t n_bits = n_words * 64;
+    for(const auto& id : sorted_ids) {
+        const uint64_t hash = id.Hash();
+        for(size_t n = 0; n < bloom_n_hashes; ++n) {
+            const size_t bit = BloomBit(hash, n, n_bits);
+            run->bloom_filter[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    run->file.open(run->file_name, std::ios::binary);
+    if(!run->file.is_open())
+        throw exception("Unable to open event ids file '%1%'.") % run->file_name;
+
+    n_spilled_entries += n_entries;
+    n_entries = 0;
+    runs.push_back(std::move(run));
+}
+
+size_t EventIdSet::BloomBit(uint64_t hash, size_t n, size_t n_bits)
+{
+    const uint64_t h1 = hash, h2 = MixBits(hash) | 1;
+    return static_cast<size_t>((h1 + n * h2) % n_bits);
+}
+
+} // namespace analysis
@@ -0,0 +1,96 @@
+/*! Low-overhead per-stage latency accumulators for the production jobs.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/Instruments/include/StageProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+
+namespace analysis {
+
+void LatencyStats::Add(double latency)
+{
+    if(!count || latency < min) min = latency;
+    if(!count || latency > max) max = latency;
+    ++count;
+    total += latency;
+    ++bins[FindBin(latency)];
+}
+
+double LatencyStats::GetQuantile(double q) const
+{
+    if(!count) return 0.;
+    const double target = std::clamp(q, 0., 1.) * count;
+    double cumulative = 0;
+    for(size_t bin = 0; bin < n_bins; ++bin) {
+        if(!bins[bin]) continue;
+        if(cumulative + bins[bin] >= target) {
+            // Log-linear interpolation inside the bin.
+            const double fraction = (target - cumulative) / bins[bin];
+            const double low = GetBinLowEdge(bin), high = GetBinLowEdge(bin + 1);
+            const double value = bin == 0 ? high * fraction : low * std::pow(high / low, fraction);
+            return std::clamp(value, min, max);
+        }
+        cumulative += bins[bin];
+    }
+    return max;
+}
+
+size_t LatencyStats::FindBin(double latency)
+{
+    if(!(latency > min_latency)) return 0;
+    const double position = std::log2(latency / min_latency) * n_bins_per_octave;
+    return std::min(n_bins - 1, static_cast<size_t>(position) + 1);
+}
+
+double LatencyStats::GetBinLowEdge(size_t bin)
+{
+    if(bin == 0) return 0.;
+    return min_latency * std::exp2(static_cast<double>(bin - 1) / n_bins_per_octave);
+}
+
+StageProfiler::StageProfiler(const std::vector<std::string>& _stage_names) :
+    stage_names(_stage_names), stats(stage_names.size())
+{
+}
+
+void StageProfiler::Print(std::ostream& os) const
+{
+    static constexpr double ms = 1e3;
+    os << "Stage timing (total in s, quantiles in ms):\n"
+       << std::setw(12) << "stage" << std::setw(10) << "n_calls" << std::setw(12) << "total"
+       << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+       << std::setw(10) << "max" << "\n";
+    for(size_t n = 0; n < stats.size(); ++n) {
+        const auto& s = stats.at(n);
+        os << std::setw(12) << stage_names.at(n) << std::setw(10) << s.GetCount() << std::setw(12)
+           << std::setprecision(4) << s.GetTotal() << std::setw(10) << s.GetMean() * ms
+           << std::setw(10) << s.GetQuantile(0.5) * ms << std::setw(10) << s.GetQuantile(0.9) * ms
+           << std::setw(10) << s.GetQuantile(0.99) * ms << std::setw(10) << s.GetMax() * ms << "\n";
+    }
+    os << std::flush;
+}
+
+void SlowEntryTracker::Add(int tree_id, int64_t entry_index, double time)
+{
+    if(!max_size) return;
+    if(heap.size() < max_size) {
+        heap.push_back(Entry{time, tree_id, entry_index});
+        std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+    } else if(time > heap.front().time) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        heap.back() = Entry{time, tree_id, entry_index};
+        std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+    }
+}
+
+std::vector<SlowEntryTracker::Entry> SlowEntryTracker::GetEntries() const
+{
+    std::vector<Entry> entries = heap;
+    std::sort(entries.begin(), entries.end(), std::greater<Entry>());
+    return entries;
+}
+
+} // namespace analysis
@@ -10,6 +10,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 #include "h-tautau/Core/include/Candidate.h"
 #include "h-tautau/Core/include/TupleObjects.h"
 #include "JetCorrectorParameters.h"   // CondFormats/JetMETObjects/interface
+#include "JetCorrectorParametersBinary.h"
 #include "JetCorrectionUncertainty.h" // CondFormats/JetMETObjects/interface
 
 namespace jec {
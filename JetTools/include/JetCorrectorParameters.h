@@ -29,7 +29,8 @@ public:
         //--- JetCorrectorParameters::Definitions constructor --------------------
         //--- takes specific arguments for the member variables ------------------
         //------------------------------------------------------------------------
-        Definitions(const std::vector<std::string>& fBinVar, const std::vector<std::string>& fParVar, const std::string& fFormula, bool fIsResponse);
+        Definitions(const std::vector<std::string>& fBinVar, const std::vector<std::string>& fParVar, const std::string& fFormula, bool fIsResponse,
+                    const std::string& fLevel = "");
 
         //------------------------------------------------------------------------
         //--- JetCorrectorParameters::Definitions constructor --------------------
@@ -72,6 +73,7 @@ public:
 
         Record(unsigned fNvar, const std::vector<float>& fXMin, const std::vector<float>& fXMax, const std::vector<float>& fParameters);
         //-------- Member functions ----------
+        unsigned nVar()                     const;
         float xMin(unsigned fVar)           const;
         float xMax(unsigned fVar)           const;
         float xMiddle(unsigned fVar)        const;
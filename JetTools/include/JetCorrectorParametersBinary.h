@@ -0,0 +1,53 @@
+/*! Binary cache of the parsed jet correction parameter text files.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include "JetCorrectorParameters.h"
+
+namespace jec {
+
+// Compact binary image of all sections of a JEC or JER parameter text file. It contains the parsed definitions,
+// binning and parameters of each section in the order produced by the text parser, so the parameters loaded from it
+// are identical to the ones parsed from the text. The file is memory-mapped when opened.
+// The size and a hash of the content of the text file are stored in the header: the binary file is used only if they
+// match the current text file.
+class JetCorrectorParametersBinary {
+public:
+    static std::string GetDefaultFileName(const std::string& text_file) { return text_file + ".bin"; }
+    static void Convert(const std::string& text_file, const std::string& binary_file);
+    // Returns nullptr if the binary file doesn't exist, has a different format version or is outdated.
+    static std::unique_ptr<JetCorrectorParametersBinary> TryOpen(const std::string& binary_file,
+                                                                 const std::string& text_file);
+
+    explicit JetCorrectorParametersBinary(const std::string& binary_file);
+    JetCorrectorParametersBinary(const JetCorrectorParametersBinary&) = delete;
+    JetCorrectorParametersBinary& operator=(const JetCorrectorParametersBinary&) = delete;
+    ~JetCorrectorParametersBinary();
+
+    bool IsUpToDate(const std::string& text_file) const;
+    bool HasSection(const std::string& section) const;
+    JetCorrectorParameters GetParameters(const std::string& section) const;
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t n_sections;
+        uint64_t text_size;
+        uint64_t text_hash;
+    };
+
+private:
+    std::string file_name;
+    const char* data;
+    size_t size;
+    Header header;
+    std::map<std::string, size_t> section_offsets;
+};
+
+} // namespace jec
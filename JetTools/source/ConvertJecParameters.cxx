@@ -0,0 +1,33 @@
+/*! Convert JEC and JER parameter text files into the binary files preferred by JECUncertaintiesWrapper.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/JetTools/include/JetCorrectorParametersBinary.h"
+
+struct Arguments {
+    run::Argument<std::vector<std::string>> input_files{"input_files", "JEC or JER parameter text files"};
+};
+
+namespace analysis {
+
+class ConvertJecParameters {
+public:
+    using JetCorrectorParametersBinary = jec::JetCorrectorParametersBinary;
+
+    ConvertJecParameters(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        for(const std::string& text_file : args.input_files()) {
+            const std::string binary_file = JetCorrectorParametersBinary::GetDefaultFileName(text_file);
+            JetCorrectorParametersBinary::Convert(text_file, binary_file);
+            std::cout << "'" << text_file << "' converted into '" << binary_file << "'." << std::endl;
+        }
+    }
+
+private:
+    Arguments args;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::ConvertJecParameters, Arguments)
@@ -123,9 +123,14 @@ JECUncertaintiesWrapper::JECUncertaintiesWrapper(const std::string& uncertaintie
 
     const std::set<UncertaintySource> jetUncertaintiesTotal = createUncSet(is_full);
 
+    // The precompiled binary file is preferred, if it is up to date, to avoid parsing the text file for each source.
+    const auto binary_parameters = JetCorrectorParametersBinary::TryOpen(
+            JetCorrectorParametersBinary::GetDefaultFileName(uncertainties_source), uncertainties_source);
+
     for (const auto jet_unc : jetUncertaintiesTotal) {
         std::string full_name = JECUncertaintiesWrapper::ReturnJecName(jet_unc,is_full,period);
-        JetCorrectorParameters p(uncertainties_source, full_name);
+        const JetCorrectorParameters p = binary_parameters ? binary_parameters->GetParameters(full_name)
+                                                           : JetCorrectorParameters(uncertainties_source, full_name);
         auto unc = std::make_shared<JetCorrectionUncertainty>(p);
         uncertainty_map[jet_unc] = unc;
     }
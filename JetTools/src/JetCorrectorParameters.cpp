@@ -87,7 +87,7 @@ namespace jec {
 JetCorrectorParameters::Definitions::Definitions() : mIsResponse(false) {}
 
 JetCorrectorParameters::Definitions::Definitions(const std::vector<std::string>& fBinVar,
-    const std::vector<std::string>& fParVar, const std::string& fFormula, bool fIsResponse)
+    const std::vector<std::string>& fParVar, const std::string& fFormula, bool fIsResponse, const std::string& fLevel)
 {
     for(unsigned i=0;i<fBinVar.size();i++)
         mBinVar.push_back(fBinVar[i]);
@@ -95,7 +95,7 @@ JetCorrectorParameters::Definitions::Definitions(const std::vector<std::string>&
         mParVar.push_back(fParVar[i]);
     mFormula    = fFormula;
     mIsResponse = fIsResponse;
-    mLevel      = "";
+    mLevel      = fLevel;
 }
 
 JetCorrectorParameters::Definitions::Definitions(const std::string& fLine)
@@ -178,6 +178,7 @@ JetCorrectorParameters::Record::Record(unsigned fNvar, const std::vector<float>&
     const std::vector<float>& fXMax, const std::vector<float>& fParameters) :
     mNvar(fNvar),mMin(fXMin),mMax(fXMax),mParameters(fParameters) {}
 
+unsigned JetCorrectorParameters::Record::nVar() const { return mNvar; }
 float JetCorrectorParameters::Record::xMin(unsigned fVar) const { return mMin[fVar]; }
 float JetCorrectorParameters::Record::xMax(unsigned fVar) const { return mMax[fVar]; }
 float JetCorrectorParameters::Record::xMiddle(unsigned fVar) const { return float(0.5*(xMin(fVar)+xMax(fVar))); }
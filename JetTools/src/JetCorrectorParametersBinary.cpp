@@ -0,0 +1,286 @@
+/*! Binary cache of the parsed jet correction parameter text files.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/JetTools/include/JetCorrectorParametersBinary.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AnalysisTools/Core/include/exception.h"
+#include "h-tautau/Core/include/FileId.h"
+
+namespace jec {
+
+namespace {
+constexpr uint64_t binary_magic = 0x4A45435041524D53ULL; // "JECPARMS"
+constexpr uint32_t binary_version = 1;
+
+class Writer {
+public:
+    explicit Writer(std::ostream& _os) : os(&_os) {}
+
+    template<typename T>
+    void Write(const T& value) { os->write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    void Write(const std::string& str)
+    {
+        Write(static_cast<uint32_t>(str.size()));
+        os->write(str.data(), static_cast<std::streamsize>(str.size()));
+    }
+
+    void Write(const std::vector<std::string>& strings)
+    {
+        Write(static_cast<uint32_t>(strings.size()));
+        for(const auto& str : strings)
+            Write(str);
+    }
+
+    void Write(const std::vector<float>& values)
+    {
+        Write(static_cast<uint32_t>(values.size()));
+        os->write(reinterpret_cast<const char*>(values.data()),
+                  static_cast<std::streamsize>(values.size() * sizeof(float)));
+    }
+
+private:
+    std::ostream* os;
+};
+
+// The mapped data is not necessarily aligned, so all values are copied with memcpy.
+class Reader {
+public:
+    Reader(const char* _data, size_t _size, size_t _pos, const std::string& _file_name) :
+        data(_data), size(_size), pos(_pos), file_name(_file_name) {}
+
+    size_t GetPosition() const { return pos; }
+
+    template<typename T>
+    T Read()
+    {
+        T value;
+        std::memcpy(&value, Advance(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        const uint32_t length = Read<uint32_t>();
+        return std::string(Advance(length), length);
+    }
+
+    std::vector<std::string> ReadStrings()
+    {
+        std::vector<std::string> strings(Read<uint32_t>());
+        for(auto& str : strings)
+            str = ReadString();
+        return strings;
+    }
+
+    std::vector<float> ReadFloats()
+    {
+        std::vector<float> values(Read<uint32_t>());
+        const size_t n_bytes = values.size() * sizeof(float);
+        if(n_bytes)
+            std::memcpy(values.data(), Advance(n_bytes), n_bytes);
+        return values;
+    }
+
+private:
+    const char* Advance(size_t n_bytes)
+    {
+        if(n_bytes > size - pos)
+            throw analysis::exception("Binary JEC parameters file '%1%' is truncated.") % file_name;
+        const char* ptr = data + pos;
+        pos += n_bytes;
+        return ptr;
+    }
+
+private:
+    const char* data;
+    size_t size, pos;
+    const std::string& file_name;
+};
+
+void SkipSection(Reader& reader)
+{
+    reader.ReadString(); // level
+    reader.ReadString(); // formula
+    reader.Read<uint8_t>(); // is response
+    reader.ReadStrings(); // bin variables
+    reader.ReadStrings(); // parameter variables
+    const uint32_t n_records = reader.Read<uint32_t>();
+    for(uint32_t n = 0; n < n_records; ++n) {
+        reader.Read<uint32_t>(); // number of variables
+        reader.ReadFloats(); // min
+        reader.ReadFloats(); // max
+        reader.ReadFloats(); // parameters
+    }
+}
+} // anonymous namespace
+
+void JetCorrectorParametersBinary::Convert(const std::string& text_file, const std::string& binary_file)
+{
+    Header header;
+    header.magic = binary_magic;
+    header.version = binary_version;
+    if(!analysis::GetFileId(text_file, header.text_size, header.text_hash))
+        throw analysis::exception("Unable to read JEC parameters file '%1%'.") % text_file;
+
+    std::vector<std::string> sections;
+    JetCorrectorParametersCollection::getSections(text_file, sections);
+    if(sections.empty())
+        sections.push_back("");
+    header.n_sections = static_cast<uint32_t>(sections.size());
+
+    // The file is written under a temporary name and renamed at the end, so jobs that are starting in parallel never
+    // see an incomplete file.
+    const std::string tmp_file = binary_file + ".tmp";
+    {
+        std::ofstream os(tmp_file, std::ios::binary | std::ios::trunc);
+        if(os.fail())
+            throw analysis::exception("Unable to create file '%1%'.") % tmp_file;
+        Writer writer(os);
+        writer.Write(header);
+        for(const std::string& section : sections) {
+            const JetCorrectorParameters parameters(text_file, section);
+            const auto& definitions = parameters.definitions();
+            writer.Write(section);
+            writer.Write(definitions.level());
+            writer.Write(definitions.formula());
+            writer.Write(static_cast<uint8_t>(definitions.isResponse()));
+            writer.Write(definitions.binVar());
+            writer.Write(definitions.parVar());
+            writer.Write(static_cast<uint32_t>(parameters.size()));
+            for(unsigned n = 0; n < parameters.size(); ++n) {
+                const auto& record = parameters.record(n);
+                std::vector<float> x_min, x_max;
+                for(unsigned var = 0; var < record.nVar(); ++var) {
+                    x_min.push_back(record.xMin(var));
+                    x_max.push_back(record.xMax(var));
+                }
+                writer.Write(static_cast<uint32_t>(record.nVar()));
+                writer.Write(x_min);
+                writer.Write(x_max);
+                writer.Write(record.parameters());
+            }
+        }
+        if(os.fail())
+            throw analysis::exception("Unable to write file '%1%'.") % tmp_file;
+    }
+    if(std::rename(tmp_file.c_str(), binary_file.c_str()) != 0)
+        throw analysis::exception("Unable to rename '%1%' into '%2%': %3%.") % tmp_file % binary_file
+            % std::strerror(errno);
+}
+
+std::unique_ptr<JetCorrectorParametersBinary> JetCorrectorParametersBinary::TryOpen(const std::string& binary_file,
+                                                                                    const std::string& text_file)
+{
+    struct stat file_stat;
+    if(stat(binary_file.c_str(), &file_stat) != 0)
+        return nullptr;
+    {
+        std::ifstream is(binary_file, std::ios::binary);
+        Header header;
+        if(!is.read(reinterpret_cast<char*>(&header), sizeof(Header)) || header.magic != binary_magic
+                || header.version != binary_version)
+            return nullptr;
+    }
+    auto binary = std::make_unique<JetCorrectorParametersBinary>(binary_file);
+    if(!binary->IsUpToDate(text_file)) {
+        std::cerr << "Warning: binary JEC parameters file '" << binary_file << "' is outdated w.r.t. '" << text_file
+                  << "'. The text file will be parsed." << std::endl;
+        return nullptr;
+    }
+    return binary;
+}
+
+JetCorrectorParametersBinary::JetCorrectorParametersBinary(const std::string& binary_file) :
+    file_name(binary_file), data(nullptr), size(0)
+{
+    const int fd = open(file_name.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw analysis::exception("Unable to open binary JEC parameters file '%1%'.") % file_name;
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw analysis::exception("Unable to get the size of '%1%'.") % file_name;
+    }
+    size = static_cast<size_t>(file_stat.st_size);
+    if(size < sizeof(Header)) {
+        close(fd);
+        throw analysis::exception("'%1%' is not a binary JEC parameters file.") % file_name;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+        throw analysis::exception("Unable to map '%1%' into memory: %2%.") % file_name % std::strerror(errno);
+    data = static_cast<const char*>(mapped);
+
+    std::memcpy(&header, data, sizeof(Header));
+    if(header.magic != binary_magic || header.version != binary_version) {
+        munmap(const_cast<char*>(data), size);
+        throw analysis::exception("'%1%' is not a compatible binary JEC parameters file.") % file_name;
+    }
+    try {
+        Reader reader(data, size, sizeof(Header), file_name);
+        for(uint32_t n = 0; n < header.n_sections; ++n) {
+            const std::string section = reader.ReadString();
+            section_offsets[section] = reader.GetPosition();
+            SkipSection(reader);
+        }
+    } catch(std::exception&) {
+        munmap(const_cast<char*>(data), size);
+        throw;
+    }
+}
+
+JetCorrectorParametersBinary::~JetCorrectorParametersBinary()
+{
+    if(data)
+        munmap(const_cast<char*>(data), size);
+}
+
+bool JetCorrectorParametersBinary::IsUpToDate(const std::string& text_file) const
+{
+    uint64_t text_size, text_hash;
+    return analysis::GetFileId(text_file, text_size, text_hash) && text_size == header.text_size
+            && text_hash == header.text_hash;
+}
+
+bool JetCorrectorParametersBinary::HasSection(const std::string& section) const
+{
+    return section_offsets.count(section);
+}
+
+JetCorrectorParameters JetCorrectorParametersBinary::GetParameters(const std::string& section) const
+{
+    const auto iter = section_offsets.find(section);
+    if(iter == section_offsets.end())
+        throw analysis::exception("Section '%1%' not found in binary JEC parameters file '%2%'.") % section
+            % file_name;
+    Reader reader(data, size, iter->second, file_name);
+    const std::string level = reader.ReadString();
+    const std::string formula = reader.ReadString();
+    const bool is_response = reader.Read<uint8_t>() != 0;
+    const std::vector<std::string> bin_vars = reader.ReadStrings();
+    const std::vector<std::string> par_vars = reader.ReadStrings();
+    const JetCorrectorParameters::Definitions definitions(bin_vars, par_vars, formula, is_response, level);
+    std::vector<JetCorrectorParameters::Record> records(reader.Read<uint32_t>());
+    for(auto& record : records) {
+        const uint32_t n_var = reader.Read<uint32_t>();
+        const std::vector<float> x_min = reader.ReadFloats();
+        const std::vector<float> x_max = reader.ReadFloats();
+        const std::vector<float> parameters = reader.ReadFloats();
+        record = JetCorrectorParameters::Record(n_var, x_min, x_max, parameters);
+    }
+    return JetCorrectorParameters(definitions, records);
+}
+
+} // namespace jec
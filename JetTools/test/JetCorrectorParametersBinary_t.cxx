@@ -0,0 +1,157 @@
+/*! Check that the JEC parameters loaded from the binary file give the same uncertainties as the text file.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/exception.h"
+#include "h-tautau/JetTools/include/JetCorrectionUncertainty.h"
+#include "h-tautau/JetTools/include/JetCorrectorParametersBinary.h"
+
+struct Arguments {
+    run::Argument<std::string> input_file{"input_file", "JEC uncertainty sources text file"};
+    run::Argument<std::string> working_dir{"working_dir", "directory for the temporary files", "./"};
+    run::Argument<size_t> n_pt_points{"n_pt_points", "number of jet pt points per section", 200};
+    run::Argument<size_t> n_eta_points{"n_eta_points", "number of jet eta points per section", 100};
+};
+
+namespace analysis {
+
+class JetCorrectorParametersBinary_t {
+public:
+    using JetCorrectorParameters = jec::JetCorrectorParameters;
+    using JetCorrectorParametersBinary = jec::JetCorrectorParametersBinary;
+
+    JetCorrectorParametersBinary_t(const Arguments& _args) :
+        args(_args), text_file(args.working_dir() + "/JetCorrectorParametersBinary_t.txt"),
+        binary_file(JetCorrectorParametersBinary::GetDefaultFileName(text_file))
+    {
+    }
+
+    void Run()
+    {
+        CopyFile(args.input_file(), text_file);
+        JetCorrectorParametersBinary::Convert(text_file, binary_file);
+        const auto binary = JetCorrectorParametersBinary::TryOpen(binary_file, text_file);
+        if(!binary)
+            throw exception("Binary file is not used right after the conversion.");
+
+        std::vector<std::string> sections;
+        jec::JetCorrectorParametersCollection::getSections(text_file, sections);
+        if(sections.empty())
+            throw exception("No sections found in '%1%'.") % args.input_file();
+        size_t n_checks = 0;
+        for(const std::string& section : sections) {
+            if(!binary->HasSection(section))
+                throw exception("Section '%1%' is missing in the binary file.") % section;
+            const JetCorrectorParameters text_parameters(text_file, section);
+            const JetCorrectorParameters binary_parameters = binary->GetParameters(section);
+            CheckParameters(section, text_parameters, binary_parameters);
+            n_checks += CheckUncertainties(section, text_parameters, binary_parameters);
+        }
+
+        // Any change of the text file should invalidate the binary file.
+        {
+            std::ofstream os(text_file, std::ios::app);
+            os << "\n";
+        }
+        if(JetCorrectorParametersBinary::TryOpen(binary_file, text_file))
+            throw exception("Binary file is used after the text file has been modified.");
+
+        std::remove(text_file.c_str());
+        std::remove(binary_file.c_str());
+        std::cout << "Binary JEC parameters are identical to the text ones: " << sections.size() << " sections, "
+                  << n_checks << " uncertainties compared." << std::endl;
+    }
+
+private:
+    static void CopyFile(const std::string& source, const std::string& destination)
+    {
+        std::ifstream is(source, std::ios::binary);
+        if(is.fail())
+            throw exception("Unable to open '%1%'.") % source;
+        std::ofstream os(destination, std::ios::binary | std::ios::trunc);
+        os << is.rdbuf();
+        if(os.fail())
+            throw exception("Unable to write '%1%'.") % destination;
+    }
+
+    static bool IsIdentical(float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; }
+
+    static bool IsIdentical(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+    }
+
+    static void CheckParameters(const std::string& section, const JetCorrectorParameters& text,
+                                const JetCorrectorParameters& binary)
+    {
+        const auto& text_def = text.definitions();
+        const auto& binary_def = binary.definitions();
+        if(text_def.level() != binary_def.level() || text_def.formula() != binary_def.formula()
+                || text_def.isResponse() != binary_def.isResponse() || text_def.binVar() != binary_def.binVar()
+                || text_def.parVar() != binary_def.parVar())
+            throw exception("Section '%1%': definitions are different.") % section;
+        if(text.size() != binary.size())
+            throw exception("Section '%1%': number of records %2% != %3%.") % section % text.size() % binary.size();
+        for(unsigned n = 0; n < text.size(); ++n) {
+            const auto& text_record = text.record(n);
+            const auto& binary_record = binary.record(n);
+            bool same = text_record.nVar() == binary_record.nVar()
+                    && IsIdentical(text_record.parameters(), binary_record.parameters());
+            for(unsigned var = 0; same && var < text_record.nVar(); ++var) {
+                same = IsIdentical(text_record.xMin(var), binary_record.xMin(var))
+                        && IsIdentical(text_record.xMax(var), binary_record.xMax(var));
+            }
+            if(!same)
+                throw exception("Section '%1%': record %2% is different.") % section % n;
+        }
+    }
+
+    size_t CheckUncertainties(const std::string& section, const JetCorrectorParameters& text_parameters,
+                              const JetCorrectorParameters& binary_parameters) const
+    {
+        static constexpr float min_pt = 10, max_pt = 7000, max_abs_eta = 5.5f;
+        jec::JetCorrectionUncertainty text_unc(text_parameters), binary_unc(binary_parameters);
+
+        // Regular grid and the bin boundaries, where the interpolation and the bin search are most sensitive.
+        std::vector<float> eta_points;
+        for(size_t n = 0; n < args.n_eta_points(); ++n)
+            eta_points.push_back(-max_abs_eta + 2 * max_abs_eta * n / (args.n_eta_points() - 1));
+        for(unsigned n = 0; n < text_parameters.size(); ++n) {
+            if(text_parameters.record(n).nVar() > 0)
+                eta_points.push_back(text_parameters.record(n).xMin(0));
+        }
+        std::vector<float> pt_points;
+        for(size_t n = 0; n < args.n_pt_points(); ++n)
+            pt_points.push_back(min_pt * std::pow(max_pt / min_pt, float(n) / (args.n_pt_points() - 1)));
+
+        size_t n_checks = 0;
+        for(float eta : eta_points) {
+            for(float pt : pt_points) {
+                for(bool direction : { true, false }) {
+                    text_unc.setJetEta(eta);
+                    text_unc.setJetPt(pt);
+                    binary_unc.setJetEta(eta);
+                    binary_unc.setJetPt(pt);
+                    const auto text_result = text_unc.getUncertainty(direction);
+                    const auto binary_result = binary_unc.getUncertainty(direction);
+                    if(text_result.is_initialized() != binary_result.is_initialized()
+                            || (text_result && !IsIdentical(*text_result, *binary_result)))
+                        throw exception("Section '%1%': different uncertainty for pt = %2%, eta = %3%, up = %4%.")
+                            % section % pt % eta % direction;
+                    ++n_checks;
+                }
+            }
+        }
+        return n_checks;
+    }
+
+private:
+    Arguments args;
+    const std::string text_file, binary_file;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::JetCorrectorParametersBinary_t, Arguments)
@@ -40,13 +40,21 @@ struct BTagReaderInfo {
 
     BTagReaderInfo(ReaderPtr _reader, JetFlavor _flavor, FilePtr file, DiscriminatorWP wp);
     void Eval(JetInfo& jetInfo, const std::string& unc_name);
-
-private:
+    double GetScaleFactor(double pt, double eta, const std::string& unc_name) const;
     double GetEfficiency(double pt, double eta) const;
 };
 
 } // namespace detail
 
+struct BTagWeightResults {
+    using ScaleWeights = std::map<UncertaintyScale, double>;
+
+    std::map<DiscriminatorWP, ScaleWeights> weights;
+
+    double Get(DiscriminatorWP wp, UncertaintySource unc_source = UncertaintySource::None,
+               UncertaintyScale unc_scale = UncertaintyScale::Central) const;
+};
+
 class BTagWeight : public IWeightProvider {
 public:
     using BTagCalibration = btag_calibration::BTagCalibration;
@@ -70,6 +78,12 @@ public:
     double Get(EventInfo& event, DiscriminatorWP wp, UncertaintySource unc_source = UncertaintySource::None,
                UncertaintyScale unc_scale = UncertaintyScale::Central) const;
 
+    // Nominal and Eff_b up/down weights for all supported working points. The results are the same as of Get for each
+    // working point and scale, but the jet selection, efficiencies and b tag outcomes are evaluated only once.
+    BTagWeightResults GetAll(EventInfo& event) const;
+
+    DiscriminatorWP GetDefaultWorkingPoint() const;
+
 private:
     static std::string GetUncertantyName(UncertaintyScale unc);
     static double GetBtagWeight(const JetInfoVector& jetInfos);
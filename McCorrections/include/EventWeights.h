@@ -3,6 +3,8 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include "AnalysisTools/Core/include/EventIdentifier.h"
 #include "h-tautau/JetTools/include/BTagger.h"
 #include "h-tautau/McCorrections/include/WeightingMode.h"
@@ -11,14 +13,28 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 namespace analysis {
 namespace mc_corrections {
 
+// Providers are constructed lazily on the first GetProvider call for the corresponding weight type. The input files
+// are checked in the constructor, so missing inputs are reported before the event loop.
+// The set of providers is fixed after the construction, and each provider is created exactly once (std::call_once),
+// so GetProvider does not take any lock once the provider is loaded.
 class EventWeights {
 public:
     using ProviderPtr = std::shared_ptr<IWeightProvider>;
     using ProviderMap = std::map<WeightType, ProviderPtr>;
+    using ProviderFactory = std::function<ProviderPtr()>;
+    using clock = std::chrono::steady_clock;
 
     EventWeights(Period period, const BTagger& bTagger, const WeightingMode& mode = {});
     ProviderPtr GetProvider(WeightType weightType) const;
 
+    // Constructs all not yet loaded providers (or only those in mode, if not empty) using up to n_threads threads.
+    void LoadProviders(const WeightingMode& mode = {}, size_t n_threads = 1) const;
+    // Prints the construction time of the loaded providers.
+    void PrintLoadTimes(std::ostream& os) const;
+
+    // Location of the precomputed pileup weight table, relative to the McCorrections data directory.
+    static std::string GetPileUpTableFileName(Period period);
+
     template<typename Provider>
     std::shared_ptr<Provider> GetProviderT(WeightType weightType) const
     {
@@ -35,13 +51,48 @@ public:
     double GetTotalWeight(const ntuple::ExpressEvent& event, const WeightingMode& weightingMode) const;
 
 protected:
+    template<typename Provider, typename ...Args>
+    void AddProvider(WeightType weightType, Args&&... args)
+    {
+        auto provider_args = std::make_tuple(std::forward<Args>(args)...);
+        AddFactory(weightType, [provider_args]() -> ProviderPtr {
+            return std::apply([](const auto& ...a) { return std::make_shared<Provider>(a...); }, provider_args);
+        });
+    }
+
+    void AddFactory(WeightType weightType, ProviderFactory&& factory);
+
+    // Compatibility accessors for derived classes that used the former providers map. They do not trigger the
+    // provider construction: GetLoadedProvider returns nullptr if the provider is not loaded yet, and
+    // GetLoadedProviders contains only the loaded providers.
+    ProviderPtr GetLoadedProvider(WeightType weightType) const;
+    ProviderMap GetLoadedProviders() const;
+
+    void AddPileUpProvider(Period period, const std::string& pu_data_file_name,
+                           const std::string& pu_data_file_up_name, const std::string& pu_data_file_down_name,
+                           const std::string& pu_mc_file_name, const std::string& cfg_file_name,
+                           double max_available_pu, double default_pu_weight);
+
+    // Uses the precomputed table if it is available and up to date, otherwise derives weights from the ROOT
+    // distributions.
+    static ProviderPtr CreatePileUpWeight(const std::string& table_file_name,
+                                          const std::vector<std::string>& source_files, double max_available_pu,
+                                          double default_pu_weight);
     static std::string FullName(const std::string& fileName, const std::string& path);
     static std::string FullName(const std::string& fileName);
     static std::string FullLeptonName(const std::string& fileName);
     static std::string FullTriggerName(const std::string& fileName);
 
 protected:
-    ProviderMap providers;
+    struct ProviderSlot {
+        ProviderFactory factory;
+        std::once_flag load_flag;
+        ProviderPtr provider;
+        double load_time{0};
+        std::atomic<bool> loaded{false};
+    };
+
+    std::map<WeightType, std::unique_ptr<ProviderSlot>> slots;
 };
 
 } // namespace mc_corrections
@@ -0,0 +1,91 @@
+/*! Per-event cache of weights for all requested weight types and uncertainty variations.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include "h-tautau/McCorrections/include/EventWeights.h"
+
+namespace analysis {
+namespace mc_corrections {
+
+struct WeightVariation {
+    WeightType weight_type;
+    UncertaintySource unc_source;
+    UncertaintyScale unc_scale;
+
+    WeightVariation(WeightType _weight_type, UncertaintySource _unc_source = UncertaintySource::None,
+                    UncertaintyScale _unc_scale = UncertaintyScale::Central);
+
+    bool operator<(const WeightVariation& other) const;
+};
+
+// Evaluates each registered (weight type, unc source, unc scale) combination exactly once per event and stores
+// the results in a dense vector attached to the EventInfo. Indices returned by AddVariation stay valid for the
+// lifetime of the cache, so filling histograms for all variations reduces to EventInfo::GetWeights()[index].
+// Each cache has a unique id that is stored with the weights: the weights produced by another cache, or by this cache
+// before new variations were added, are recomputed.
+class EventWeightsCache {
+public:
+    using Evaluator = std::function<double(EventInfo&, UncertaintySource, UncertaintyScale)>;
+    // Evaluates all registered variations of a weight type at once, for providers that compute them together.
+    using MultiEvaluator = std::function<void(EventInfo&, const std::vector<WeightVariation>&, std::vector<double>&)>;
+    using UncSourceSet = std::set<UncertaintySource>;
+
+    explicit EventWeightsCache(const EventWeights& _eventWeights);
+
+    // Overrides the way a weight type is evaluated (e.g. to bind working points). Variations of sources outside
+    // of the affecting set are aliased to the central value. Must be called before the first AddVariation
+    // for the given weight type.
+    void SetEvaluator(WeightType weight_type, const Evaluator& evaluator, const UncSourceSet& affecting_sources);
+
+    size_t AddVariation(WeightType weight_type, UncertaintySource unc_source = UncertaintySource::None,
+                        UncertaintyScale unc_scale = UncertaintyScale::Central);
+    size_t GetIndex(WeightType weight_type, UncertaintySource unc_source = UncertaintySource::None,
+                    UncertaintyScale unc_scale = UncertaintyScale::Central) const;
+    size_t GetNumberOfVariations() const;
+    size_t GetNumberOfEvaluations() const;
+    size_t GetId() const { return id; }
+
+    const std::vector<double>& Evaluate(EventInfo& event) const;
+    double GetWeight(EventInfo& event, WeightType weight_type,
+                     UncertaintySource unc_source = UncertaintySource::None,
+                     UncertaintyScale unc_scale = UncertaintyScale::Central) const;
+    double GetTotalWeight(EventInfo& event, const WeightingMode& weightingMode,
+                          UncertaintySource unc_source = UncertaintySource::None,
+                          UncertaintyScale unc_scale = UncertaintyScale::Central) const;
+
+private:
+    // If multi_evaluator is set, it is used instead of the evaluator.
+    struct EvaluatorEntry {
+        Evaluator evaluator;
+        UncSourceSet affecting_sources;
+        MultiEvaluator multi_evaluator;
+    };
+
+    // The evaluator is nullptr for the variations that are evaluated by a multi-evaluator.
+    struct Evaluation {
+        WeightVariation variation;
+        const Evaluator* evaluator;
+    };
+
+    struct MultiEvaluation {
+        const MultiEvaluator* evaluator;
+        std::vector<WeightVariation> variations;
+        std::vector<size_t> indices;
+    };
+
+    const EvaluatorEntry& GetEvaluator(WeightType weight_type);
+    EvaluatorEntry CreateDefaultEvaluator(WeightType weight_type) const;
+    static WeightVariation GetCanonicalVariation(const WeightVariation& variation, const EvaluatorEntry& entry);
+
+private:
+    const size_t id;
+    const EventWeights& eventWeights;
+    std::map<WeightType, EvaluatorEntry> evaluators;
+    std::map<WeightVariation, size_t> variation_indices;
+    std::vector<Evaluation> evaluations;
+    std::map<WeightType, MultiEvaluation> multi_evaluations;
+};
+
+} // namespace mc_corrections
+} // namespace analysis
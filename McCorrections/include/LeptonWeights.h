@@ -117,6 +117,19 @@ private:
     HistPtr id_hist, iso_hist, trigger_hist;
 };
 
+enum class TauSFKind { IdVSe = 0, IdVSmu = 1, IdVSjet = 2, TriggerData = 3, TriggerMC = 4 };
+
+// Exact inputs of a tau SF evaluation. The same leg is evaluated once per uncertainty source,
+// so identical inputs are repeated many times per event.
+struct TauSFCacheKey {
+    TauSFKind kind;
+    DiscriminatorWP wp;
+    int channel, decay_mode, gen_match, scale;
+    double pt, eta;
+
+    bool operator<(const TauSFCacheKey& other) const;
+};
+
 } // namespace detail
 
 class LeptonWeights : public IWeightProvider {
@@ -152,6 +165,21 @@ public:
     virtual double Get(EventInfo& eventInfo) const override;
     virtual double Get(const ntuple::ExpressEvent& /*event*/) const override;
 
+private:
+    template<typename Calc>
+    double GetCachedTauSF(const detail::TauSFCacheKey& key, Calc&& calc)
+    {
+        static constexpr size_t max_cache_size = 1000;
+        auto iter = tau_sf_cache.find(key);
+        if(iter != tau_sf_cache.end())
+            return iter->second;
+        if(tau_sf_cache.size() >= max_cache_size)
+            tau_sf_cache.clear();
+        const double sf = calc();
+        tau_sf_cache.emplace(key, sf);
+        return sf;
+    }
+
 private:
     detail::LeptonScaleFactors electronSF, muonSF;
     std::string tauTriggerInput;
@@ -159,6 +187,7 @@ private:
     bool is_dm_binned;
     std::map<TauIdDiscriminator, std::map<DiscriminatorWP, std::shared_ptr<TauIDSFTool>>> tau_sf_providers;
     std::map<Channel, std::map<DiscriminatorWP, std::shared_ptr<tau_trigger::SFProvider>>> tau_trigger_sf_providers;
+    std::map<detail::TauSFCacheKey, double> tau_sf_cache;
 };
 
 } // namespace mc_corrections
@@ -29,34 +29,64 @@ private:
     HistPtr pu_weights;
 };
 
+struct PileUpWeightEntry {
+    double central{0}, up{0}, down{0};
+
+    PileUpWeightEntry() {}
+    explicit PileUpWeightEntry(double value);
+    double Get(UncertaintyScale unc_scale) const;
+};
+
 class PileUpWeightEx : public IWeightProvider {
 public:
     using Event = ntuple::Event;
     using Hist = TH1;
     using HistPtr = std::shared_ptr<Hist>;
+    using WeightTable = std::vector<PileUpWeightEntry>;
+    using SourceId = std::pair<uint64_t, uint64_t>; // size and hash of the content of a source file
 
     PileUpWeightEx(const std::string& pu_data_file_name, const std::string& pu_data_file_up_name,
                    const std::string& pu_data_file_down_name, const std::string& pu_mc_file_name,
                    const std::string& cfg_file_name, double _max_available_pu,
                    double _default_pu_weight);
 
+    // Loads weights precomputed with SaveTable, without opening any ROOT file.
+    PileUpWeightEx(const std::string& table_file_name, double _default_pu_weight);
+
+    // The table stores the ids of the files it was produced from. It is up to date only if they match the current
+    // source files, given in the order of the constructor arguments (data, data up, data down, MC and groups),
+    // and if it was produced with the same max_available_pu.
+    static bool IsTableUpToDate(const std::string& table_file_name, const std::vector<std::string>& source_files,
+                                double max_available_pu);
+
     virtual double Get(EventInfo& eventInfo) const override;
     virtual double Get(const ntuple::ExpressEvent& event) const override;
     double Get(EventInfo& eventInfo, UncertaintyScale unc_scales) const;
     double Get(const ntuple::ExpressEvent& event, UncertaintyScale unc_scale = UncertaintyScale::Central) const;
 
+    // Central, up and down weights from a single table lookup.
+    const PileUpWeightEntry& GetAll(EventInfo& eventInfo) const;
+    const PileUpWeightEntry& GetAll(const ntuple::ExpressEvent& event) const;
+
     void SetActiveDataset(const std::string& active_dataset);
+    void SaveTable(const std::string& table_file_name) const;
 
 private:
-    double Get(double nPU, UncertaintyScale unc_scale = UncertaintyScale::Central) const;
-    void LoadPUWeights(const std::string& pu_mc_file_name, const std::string& cfg_file_name);
+    const PileUpWeightEntry& FindEntry(double nPU) const;
+    void LoadPUWeights(const std::map<UncertaintyScale, std::string>& data_files, const std::string& pu_mc_file_name,
+                       const std::string& cfg_file_name);
+    void LoadTable(const std::string& table_file_name);
+    static SourceId GetSourceId(const std::string& file_name);
 
 private:
-    double max_available_pu, default_pu_weight;
+    std::vector<SourceId> source_ids;
+    double max_available_pu;
+    PileUpWeightEntry default_entry;
     std::map<std::string, size_t> datasets;
-    std::map<UncertaintyScale, std::vector<HistPtr>> pu_weights_map;
+    std::vector<WeightTable> weight_tables;
+    int n_bins, max_bin;
+    double x_min, x_max;
     boost::optional<size_t> active_group;
-    std::map<UncertaintyScale, std::string> data_files;
 };
 
 } // namespace mc_corrections
@@ -0,0 +1,42 @@
+/*! Precompute pileup weight tables for PileUpWeightEx.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/McCorrections/include/PileUpWeight.h"
+
+struct Arguments {
+    run::Argument<std::string> data_file{"data_file", "Pileup distribution in data"};
+    run::Argument<std::string> data_file_up{"data_file_up", "Pileup distribution in data for the up variation"};
+    run::Argument<std::string> data_file_down{"data_file_down", "Pileup distribution in data for the down variation"};
+    run::Argument<std::string> mc_file{"mc_file", "Pileup distributions in MC per sample"};
+    run::Argument<std::string> groups_file{"groups_file", "Definition of the dataset groups"};
+    run::Argument<double> max_available_pu{"max_available_pu", "maximal available n_pu", 100};
+    run::Argument<std::string> output{"output", "Output table file. EventWeights uses it only if it is located at"
+        " EventWeights::GetPileUpTableFileName(period) and was produced from the current source files."};
+};
+
+namespace analysis {
+
+class PileUpWeightTable {
+public:
+    using PileUpWeightEx = mc_corrections::PileUpWeightEx;
+
+    PileUpWeightTable(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        static constexpr double default_pu_weight = 0;
+
+        const PileUpWeightEx pu_weight(args.data_file(), args.data_file_up(), args.data_file_down(),
+                                       args.mc_file(), args.groups_file(), args.max_available_pu(),
+                                       default_pu_weight);
+        pu_weight.SaveTable(args.output());
+        std::cout << "Pileup weight table saved into '" << args.output() << "'." << std::endl;
+    }
+
+private:
+    Arguments args;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::PileUpWeightTable, Arguments)
@@ -43,11 +43,15 @@ BTagReaderInfo::BTagReaderInfo(ReaderPtr _reader, JetFlavor _flavor, FilePtr fil
 
 void BTagReaderInfo::Eval(JetInfo& jetInfo, const std::string& unc_name)
 {
-    jetInfo.SF  = reader->eval_auto_bounds(unc_name, flavor, static_cast<float>(jetInfo.eta),
-                                           static_cast<float>(jetInfo.pt));
+    jetInfo.SF  = GetScaleFactor(jetInfo.pt, jetInfo.eta, unc_name);
     jetInfo.eff = GetEfficiency(jetInfo.pt, std::abs(jetInfo.eta));
 }
 
+double BTagReaderInfo::GetScaleFactor(double pt, double eta, const std::string& unc_name) const
+{
+    return reader->eval_auto_bounds(unc_name, flavor, static_cast<float>(eta), static_cast<float>(pt));
+}
+
 double BTagReaderInfo::GetEfficiency(double pt, double eta) const
 {
     int xBin = eff_hist->GetXaxis()->FindFixBin(pt);
@@ -59,6 +63,15 @@ double BTagReaderInfo::GetEfficiency(double pt, double eta) const
 
 } // namespace detail
 
+double BTagWeightResults::Get(DiscriminatorWP wp, UncertaintySource unc_source, UncertaintyScale unc_scale) const
+{
+    const UncertaintyScale scale = unc_source == UncertaintySource::Eff_b ? unc_scale : UncertaintyScale::Central;
+    auto wp_iter = weights.find(wp);
+    if(wp_iter == weights.end())
+        throw exception("BTagWeightResults: working point %1% is not available.") % wp;
+    return wp_iter->second.at(scale);
+}
+
 BTagWeight::BTagWeight(const std::string& bTagEffFileName, const std::string& bjetSFFileName, const BTagger& _bTagger,
                        DiscriminatorWP _default_wp) :
     calib(ToString(_bTagger.GetBaseTagger()), bjetSFFileName), bTagger(_bTagger), default_wp(_default_wp)
@@ -115,6 +128,43 @@ double BTagWeight::Get(EventInfo& eventInfo, DiscriminatorWP wp, UncertaintySour
     return GetBtagWeight(jetInfos);
 }
 
+BTagWeightResults BTagWeight::GetAll(EventInfo& eventInfo) const
+{
+    static const std::map<UncertaintyScale, std::string> unc_names = {
+        { UncertaintyScale::Central, GetUncertantyName(UncertaintyScale::Central) },
+        { UncertaintyScale::Up, GetUncertantyName(UncertaintyScale::Up) },
+        { UncertaintyScale::Down, GetUncertantyName(UncertaintyScale::Down) },
+    };
+
+    // The jet selection, the efficiency and the b tag outcome are evaluated once per jet and working point,
+    // only the scale factor depends on the uncertainty scale.
+    std::map<DiscriminatorWP, std::map<UncertaintyScale, JetInfoVector>> jetInfos;
+    for(const auto& jet : eventInfo.GetCentralJets()) {
+        JetInfo jetInfo(*jet);
+        if(!(jetInfo.pt > bTagger.PtCut() && std::abs(jetInfo.eta) < bTagger.EtaCut())) continue;
+        for(const auto& wp_entry : readerInfos) {
+            const DiscriminatorWP wp = wp_entry.first;
+            const ReaderInfo& reader = GetReader(wp, jetInfo.hadronFlavour);
+            jetInfo.eff = reader.GetEfficiency(jetInfo.pt, std::abs(jetInfo.eta));
+            jetInfo.bTagOutcome = bTagger.Pass(**jet, wp);
+            for(const auto& [unc_scale, unc_name] : unc_names) {
+                jetInfo.SF = reader.GetScaleFactor(jetInfo.pt, jetInfo.eta, unc_name);
+                jetInfos[wp][unc_scale].push_back(jetInfo);
+            }
+        }
+    }
+
+    BTagWeightResults results;
+    for(const auto& wp_entry : readerInfos) {
+        const DiscriminatorWP wp = wp_entry.first;
+        for(const auto& unc_entry : unc_names)
+            results.weights[wp][unc_entry.first] = GetBtagWeight(jetInfos[wp][unc_entry.first]);
+    }
+    return results;
+}
+
+DiscriminatorWP BTagWeight::GetDefaultWorkingPoint() const { return default_wp; }
+
 std::string BTagWeight::GetUncertantyName(UncertaintyScale unc)
 {
     std::string unc_name = ToString(unc);
@@ -3,7 +3,9 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "h-tautau/McCorrections/include/EventWeights.h"
 
+#include <future>
 #include <boost/filesystem.hpp>
+#include <TROOT.h>
 
 #include "AnalysisTools/Core/include/TextIO.h"
 #include "h-tautau/McCorrections/include/PileUpWeight.h"
@@ -24,12 +26,11 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
 
     if(period == Period::Run2016) {
         if(mode.empty() || mode.count(WeightType::PileUp))
-            providers[WeightType::PileUp] = std::make_shared<PileUpWeightEx>(
-                        FullName("2016/Pileup_Data2016.root"), FullName("2016/Pileup_Data2016_Up.root"),
-                        FullName("2016/Pileup_Data2016_Down.root"), FullName("2016/pu_mc_distr_per_sample_100_100_2016.root"),
-                        FullName("2016/pileup_groups_2016.txt"), 100, 0);
+            AddPileUpProvider(period,
+                        "2016/Pileup_Data2016.root", "2016/Pileup_Data2016_Up.root", "2016/Pileup_Data2016_Down.root",
+                        "2016/pu_mc_distr_per_sample_100_100_2016.root", "2016/pileup_groups_2016.txt", 100, 0);
         if(mode.empty() || mode.count(WeightType::LeptonTrigIdIso))
-            providers[WeightType::LeptonTrigIdIso] = std::make_shared<LeptonWeights>(
+            AddProvider<LeptonWeights>(WeightType::LeptonTrigIdIso,
                         FullLeptonName("Electron/Run2016_legacy/Electron_Run2016_legacy_IdIso.root"),
                         FullLeptonName("Electron/Run2016_legacy/Electron_Run2016_legacy_Ele25.root"),
                         "",
@@ -40,17 +41,17 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
                         period, false);
         if(mode.empty() || mode.count(WeightType::BTag)){
             if(base_tagger == BTaggerKind::CSV)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2016/btag/bTagEfficiencies_Moriond17.root"),
                         FullName("2016/btag/CSVv2_Moriond17_B_H.csv"),
                         bTagger, default_btag_wp);
             else if(base_tagger == BTaggerKind::DeepCSV)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2016/btag/b_eff_HH_DeepCSV_2016.root"),
                         FullName("2016/btag/DeepCSV_2016LegacySF_WP_V1.csv"),
                         bTagger, default_btag_wp);
             else if(base_tagger == BTaggerKind::DeepFlavour)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2016/btag/b_eff_HH_DeepFlavour_2016.root"),
                         FullName("2016/btag/DeepJet_2016LegacySF_WP_V1.csv"),
                         bTagger, default_btag_wp);
@@ -58,34 +59,32 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
                 throw exception("EventWeights: b tagger %1% is not supported.") % base_tagger;
         }
         if(mode.empty() || mode.count(WeightType::JetPuIdWeights))
-            providers[WeightType::JetPuIdWeights] = std::make_shared<JetPuIdWeights>(
+            AddProvider<JetPuIdWeights>(WeightType::JetPuIdWeights,
                         FullName("jet_pu_id/effcyPUID_81Xtraining.root"),
                         FullName("jet_pu_id/scalefactorsPUID_81Xtraining.root"),
                         bTagger, period);
         if(mode.empty() || mode.count(WeightType::TopPt))
-            providers[WeightType::TopPt] = std::make_shared<TopPtWeight>(0.0615, 0.0005);
+            AddProvider<TopPtWeight>(WeightType::TopPt, 0.0615, 0.0005);
     }
 
     else if(period == Period::Run2017) {
         if(mode.empty() || mode.count(WeightType::PileUp))
-            providers[WeightType::PileUp] = std::make_shared<PileUpWeightEx>(
-                        FullName("2017/Pileup_Data2017.root"), FullName("2017/Pileup_Data2017_Up.root"),
-                        FullName("2017/Pileup_Data2017_Down.root"),
-                        FullName("2017/pu_mc_distr_per_sample_100_100_2017.root"),
-                        FullName("2017/pileup_groups.txt"), 100, 0);
+            AddPileUpProvider(period,
+                        "2017/Pileup_Data2017.root", "2017/Pileup_Data2017_Up.root", "2017/Pileup_Data2017_Down.root",
+                        "2017/pu_mc_distr_per_sample_100_100_2017.root", "2017/pileup_groups.txt", 100, 0);
         if(mode.empty() || mode.count(WeightType::BTag)){
             if(base_tagger == BTaggerKind::DeepCSV)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2017/btag/b_eff_HH_DeepCSV_2017.root"),
                         FullName("2017/btag/DeepCSV_94XSF_WP_V4_B_F.csv"),
                         bTagger, default_btag_wp);
             else if(base_tagger == BTaggerKind::CSV)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2017/btag/BTagEfficiency_csv_pu_id_full.root"),
                         FullName("2017/btag/CSVv2_94XSF_V2_B_F.csv"),
                         bTagger, default_btag_wp);
             else if(base_tagger == BTaggerKind::DeepFlavour)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2017/btag/b_eff_HH_DeepFlavour_2017.root"),
                         FullName("2017/btag/DeepFlavour_94XSF_WP_V3_B_F.csv"),
                         bTagger, default_btag_wp);
@@ -93,12 +92,12 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
                throw exception("EventWeights: b tagger %1% is not supported.") % base_tagger;
         }
         if(mode.empty() || mode.count(WeightType::JetPuIdWeights))
-            providers[WeightType::JetPuIdWeights] = std::make_shared<JetPuIdWeights>(
+            AddProvider<JetPuIdWeights>(WeightType::JetPuIdWeights,
                         FullName("jet_pu_id/effcyPUID_81Xtraining.root"),
                         FullName("jet_pu_id/scalefactorsPUID_81Xtraining.root"),
                         bTagger, period);
         if(mode.empty() || mode.count(WeightType::LeptonTrigIdIso))
-            providers[WeightType::LeptonTrigIdIso] = std::make_shared<LeptonWeights>(
+            AddProvider<LeptonWeights>(WeightType::LeptonTrigIdIso,
                         FullLeptonName("Electron/Run2017/Electron_Run2017_IdIso.root"),
                         FullLeptonName("Electron/Run2017/Electron_Ele32orEle35.root"),
                         FullLeptonName("Electron/Run2017/Electron_EleTau_Ele24.root"),
@@ -108,23 +107,21 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
                         FullTriggerName("2017_tauTriggerEff_DeepTau2017v2p1.root"),
                         period, false);
         if(mode.empty() || mode.count(WeightType::TopPt))
-            providers[WeightType::TopPt] = std::make_shared<TopPtWeight>(0.0615, 0.0005);
+            AddProvider<TopPtWeight>(WeightType::TopPt, 0.0615, 0.0005);
     }
     else if(period == Period::Run2018) {
         if(mode.empty() || mode.count(WeightType::PileUp))
-            providers[WeightType::PileUp] = std::make_shared<PileUpWeightEx>(
-                        FullName("2018/Pileup_Data2018.root"), FullName("2018/Pileup_Data2018_Up.root"),
-                        FullName("2018/Pileup_Data2018_Down.root"),
-                        FullName("2018/pu_mc_distr_per_sample_100_100_2018.root"),
-                        FullName("2018/pileup_groups_2018.txt"), 100, 0);
+            AddPileUpProvider(period,
+                        "2018/Pileup_Data2018.root", "2018/Pileup_Data2018_Up.root", "2018/Pileup_Data2018_Down.root",
+                        "2018/pu_mc_distr_per_sample_100_100_2018.root", "2018/pileup_groups_2018.txt", 100, 0);
         if(mode.empty() || mode.count(WeightType::BTag)){
             if(base_tagger == BTaggerKind::DeepCSV)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2018/btag/b_eff_HH_DeepCSV_2018.root"),
                         FullName("2018/btag/DeepCSV_102XSF_WP_V1.csv"),
                         bTagger, default_btag_wp);
             else if(base_tagger == BTaggerKind::DeepFlavour)
-                providers[WeightType::BTag] = std::make_shared<BTagWeight>(
+                AddProvider<BTagWeight>(WeightType::BTag,
                         FullName("2018/btag/b_eff_HH_DeepFlavour_2018.root"),
                         FullName("2018/btag/DeepJet_102XSF_WP_V1.csv"),
                         bTagger, default_btag_wp);
@@ -132,14 +129,14 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
                throw exception("EventWeights: b tagger %1% is not supported.") % base_tagger;
         }
         if(mode.empty() || mode.count(WeightType::JetPuIdWeights))
-            providers[WeightType::JetPuIdWeights] = std::make_shared<JetPuIdWeights>(
+            AddProvider<JetPuIdWeights>(WeightType::JetPuIdWeights,
                         FullName("jet_pu_id/effcyPUID_81Xtraining.root"),
                         FullName("jet_pu_id/scalefactorsPUID_81Xtraining.root"),
                         bTagger, period);
         if(mode.empty() || mode.count(WeightType::TopPt))
-            providers[WeightType::TopPt] = std::make_shared<TopPtWeight>(0.0615, 0.0005);
+            AddProvider<TopPtWeight>(WeightType::TopPt, 0.0615, 0.0005);
         if(mode.empty() || mode.count(WeightType::LeptonTrigIdIso))
-            providers[WeightType::LeptonTrigIdIso] = std::make_shared<LeptonWeights>(
+            AddProvider<LeptonWeights>(WeightType::LeptonTrigIdIso,
                         FullLeptonName("Electron/Run2018/Electron_Run2018_IdIso.root"),
                         FullLeptonName("Electron/Run2018/Electron_Run2018_Ele32orEle35.root"),
                         FullLeptonName("Electron/Run2018/Electron_Run2018_Ele24.root"),
@@ -153,14 +150,110 @@ EventWeights::EventWeights(Period period, const BTagger& bTagger, const Weightin
         throw exception("Period %1% is not supported (EventWeights).") % period;
     }
     if(mode.empty() || mode.count(WeightType::GenEventWeight))
-        providers[WeightType::GenEventWeight] = std::make_shared<GenEventWeight>();
+        AddProvider<GenEventWeight>(WeightType::GenEventWeight);
 }
 
 EventWeights::ProviderPtr EventWeights::GetProvider(WeightType weightType) const
 {
-    if(!providers.count(weightType))
+    auto iter = slots.find(weightType);
+    if(iter == slots.end())
         throw exception("Weight provider not found for %1% weight.") % weightType;
-    return providers.at(weightType);
+    ProviderSlot& slot = *iter->second;
+    // If the factory throws, the flag is not set and the next call retries the construction.
+    std::call_once(slot.load_flag, [&slot]() {
+        const auto start = clock::now();
+        slot.provider = slot.factory();
+        slot.load_time = std::chrono::duration<double>(clock::now() - start).count();
+        slot.loaded = true;
+    });
+    return slot.provider;
+}
+
+void EventWeights::LoadProviders(const WeightingMode& mode, size_t n_threads) const
+{
+    std::vector<WeightType> to_load;
+    for(const auto& [weightType, slot] : slots) {
+        if((mode.empty() || mode.count(weightType)) && !slot->loaded)
+            to_load.push_back(weightType);
+    }
+    if(to_load.empty()) return;
+
+    n_threads = std::max<size_t>(std::min(n_threads, to_load.size()), 1);
+    if(n_threads == 1) {
+        for(WeightType weightType : to_load)
+            GetProvider(weightType);
+        return;
+    }
+
+    ROOT::EnableThreadSafety();
+    std::atomic<size_t> next_index(0);
+    const auto load = [&]() {
+        for(size_t n = next_index++; n < to_load.size(); n = next_index++)
+            GetProvider(to_load.at(n));
+    };
+    std::vector<std::future<void>> loaders;
+    for(size_t n = 0; n < n_threads; ++n)
+        loaders.push_back(std::async(std::launch::async, load));
+    for(auto& loader : loaders)
+        loader.get();
+}
+
+void EventWeights::PrintLoadTimes(std::ostream& os) const
+{
+    const auto prev_precision = os.precision(3);
+    os << "Weight provider load times:\n";
+    double total = 0;
+    for(const auto& [weightType, slot] : slots) {
+        if(slot->loaded) {
+            os << "\t" << weightType << ": " << slot->load_time << " s\n";
+            total += slot->load_time;
+        } else {
+            os << "\t" << weightType << ": not loaded\n";
+        }
+    }
+    os << "\ttotal: " << total << " s" << std::endl;
+    os.precision(prev_precision);
+}
+
+void EventWeights::AddFactory(WeightType weightType, ProviderFactory&& factory)
+{
+    auto& slot = slots[weightType];
+    slot = std::make_unique<ProviderSlot>();
+    slot->factory = std::move(factory);
+}
+
+EventWeights::ProviderPtr EventWeights::GetLoadedProvider(WeightType weightType) const
+{
+    auto iter = slots.find(weightType);
+    if(iter == slots.end() || !iter->second->loaded)
+        return ProviderPtr();
+    return iter->second->provider;
+}
+
+EventWeights::ProviderMap EventWeights::GetLoadedProviders() const
+{
+    ProviderMap providers;
+    for(const auto& [weightType, slot] : slots) {
+        if(slot->loaded)
+            providers[weightType] = slot->provider;
+    }
+    return providers;
+}
+
+void EventWeights::AddPileUpProvider(Period period, const std::string& pu_data_file_name,
+                                     const std::string& pu_data_file_up_name,
+                                     const std::string& pu_data_file_down_name, const std::string& pu_mc_file_name,
+                                     const std::string& cfg_file_name, double max_available_pu,
+                                     double default_pu_weight)
+{
+    const std::string table_file_name = GetPileUpTableFileName(period);
+    const std::vector<std::string> source_files = {
+        FullName(pu_data_file_name), FullName(pu_data_file_up_name), FullName(pu_data_file_down_name),
+        FullName(pu_mc_file_name), FullName(cfg_file_name)
+    };
+    AddFactory(WeightType::PileUp, [=]() {
+        return CreatePileUpWeight(table_file_name, source_files, max_available_pu, default_pu_weight);
+    });
 }
 
 double EventWeights::GetWeight(EventInfo& event, WeightType weightType) const
@@ -197,6 +290,30 @@ double EventWeights::GetTotalWeight(const ntuple::ExpressEvent& event, const Wei
     return weight;
 }
 
+EventWeights::ProviderPtr EventWeights::CreatePileUpWeight(const std::string& table_file_name,
+                                                          const std::vector<std::string>& source_files,
+                                                          double max_available_pu, double default_pu_weight)
+{
+    static const std::string path = "h-tautau/McCorrections/data";
+    const std::string table_full_name = path + "/" + table_file_name;
+    if(PileUpWeightEx::IsTableUpToDate(table_full_name, source_files, max_available_pu))
+        return std::make_shared<PileUpWeightEx>(table_full_name, default_pu_weight);
+    return std::make_shared<PileUpWeightEx>(source_files.at(0), source_files.at(1), source_files.at(2),
+                                            source_files.at(3), source_files.at(4), max_available_pu,
+                                            default_pu_weight);
+}
+
+std::string EventWeights::GetPileUpTableFileName(Period period)
+{
+    static const std::map<Period, std::string> years = {
+        { Period::Run2016, "2016" }, { Period::Run2017, "2017" }, { Period::Run2018, "2018" },
+    };
+    const auto iter = years.find(period);
+    if(iter == years.end())
+        throw exception("Pileup weight table is not defined for %1%.") % period;
+    return iter->second + "/pileup_weights_table_" + iter->second + ".txt";
+}
+
 std::string EventWeights::FullName(const std::string& fileName, const std::string& path)
 {
     const std::string name = path + "/" + fileName;
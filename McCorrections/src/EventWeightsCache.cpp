@@ -0,0 +1,210 @@
+/*! Per-event cache of weights for all requested weight types and uncertainty variations.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "h-tautau/McCorrections/include/EventWeightsCache.h"
+
+#include <atomic>
+
+#include "AnalysisTools/Core/include/EventIdentifier.h"
+#include "h-tautau/McCorrections/include/PileUpWeight.h"
+#include "h-tautau/McCorrections/include/BTagWeight.h"
+#include "h-tautau/McCorrections/include/JetPuIdWeights.h"
+
+namespace analysis {
+namespace mc_corrections {
+
+WeightVariation::WeightVariation(WeightType _weight_type, UncertaintySource _unc_source,
+                                 UncertaintyScale _unc_scale) :
+    weight_type(_weight_type), unc_source(_unc_source), unc_scale(_unc_scale)
+{
+}
+
+bool WeightVariation::operator<(const WeightVariation& other) const
+{
+    return std::tie(weight_type, unc_source, unc_scale)
+            < std::tie(other.weight_type, other.unc_source, other.unc_scale);
+}
+
+namespace {
+size_t CreateCacheId()
+{
+    static std::atomic<size_t> next_id(1);
+    return next_id++;
+}
+} // anonymous namespace
+
+EventWeightsCache::EventWeightsCache(const EventWeights& _eventWeights) :
+    id(CreateCacheId()), eventWeights(_eventWeights)
+{
+}
+
+void EventWeightsCache::SetEvaluator(WeightType weight_type, const Evaluator& evaluator,
+                                     const UncSourceSet& affecting_sources)
+{
+    for(const auto& evaluation : evaluations) {
+        if(evaluation.variation.weight_type == weight_type)
+            throw exception("EventWeightsCache: evaluator for %1% weight should be set before adding variations.")
+                % weight_type;
+    }
+    evaluators[weight_type] = EvaluatorEntry{evaluator, affecting_sources, MultiEvaluator()};
+}
+
+size_t EventWeightsCache::AddVariation(WeightType weight_type, UncertaintySource unc_source,
+                                       UncertaintyScale unc_scale)
+{
+    const WeightVariation variation(weight_type, unc_source, unc_scale);
+    auto iter = variation_indices.find(variation);
+    if(iter != variation_indices.end())
+        return iter->second;
+
+    const EvaluatorEntry& entry = GetEvaluator(weight_type);
+    const WeightVariation canonical = GetCanonicalVariation(variation, entry);
+    auto canonical_iter = variation_indices.find(canonical);
+    size_t index;
+    if(canonical_iter != variation_indices.end()) {
+        index = canonical_iter->second;
+    } else {
+        index = evaluations.size();
+        if(entry.multi_evaluator) {
+            evaluations.push_back(Evaluation{canonical, nullptr});
+            auto& multi_evaluation = multi_evaluations[weight_type];
+            multi_evaluation.evaluator = &entry.multi_evaluator;
+            multi_evaluation.variations.push_back(canonical);
+            multi_evaluation.indices.push_back(index);
+        } else {
+            evaluations.push_back(Evaluation{canonical, &entry.evaluator});
+        }
+        variation_indices[canonical] = index;
+    }
+    variation_indices[variation] = index;
+    return index;
+}
+
+size_t EventWeightsCache::GetIndex(WeightType weight_type, UncertaintySource unc_source,
+                                   UncertaintyScale unc_scale) const
+{
+    auto iter = variation_indices.find(WeightVariation(weight_type, unc_source, unc_scale));
+    if(iter == variation_indices.end())
+        throw exception("EventWeightsCache: variation %1% %2% %3% is not registered.")
+            % weight_type % unc_source % unc_scale;
+    return iter->second;
+}
+
+size_t EventWeightsCache::GetNumberOfVariations() const { return variation_indices.size(); }
+size_t EventWeightsCache::GetNumberOfEvaluations() const { return evaluations.size(); }
+
+const std::vector<double>& EventWeightsCache::Evaluate(EventInfo& event) const
+{
+    if(!event.HasWeights(id) || event.GetWeights().size() != evaluations.size()) {
+        std::vector<double> weights(evaluations.size());
+        for(size_t n = 0; n < evaluations.size(); ++n) {
+            const auto& evaluation = evaluations[n];
+            if(evaluation.evaluator)
+                weights[n] = (*evaluation.evaluator)(event, evaluation.variation.unc_source,
+                                                     evaluation.variation.unc_scale);
+        }
+        std::vector<double> multi_weights;
+        for(const auto& [weight_type, multi_evaluation] : multi_evaluations) {
+            (*multi_evaluation.evaluator)(event, multi_evaluation.variations, multi_weights);
+            if(multi_weights.size() != multi_evaluation.variations.size())
+                throw exception("EventWeightsCache: wrong number of %1% weights.") % weight_type;
+            for(size_t n = 0; n < multi_weights.size(); ++n)
+                weights[multi_evaluation.indices[n]] = multi_weights[n];
+        }
+        for(size_t n = 0; n < evaluations.size(); ++n) {
+            const auto& evaluation = evaluations[n];
+            const double weight = weights[n];
+            if(std::isnan(weight) || std::abs(weight) == std::numeric_limits<double>::infinity())
+                throw exception("%1% weight for %2% %3% is nan or infinity for event %4%.")
+                    % evaluation.variation.weight_type % evaluation.variation.unc_source
+                    % evaluation.variation.unc_scale % EventIdentifier(*event);
+        }
+        event.SetWeights(id, std::move(weights));
+    }
+    return event.GetWeights();
+}
+
+double EventWeightsCache::GetWeight(EventInfo& event, WeightType weight_type, UncertaintySource unc_source,
+                                   UncertaintyScale unc_scale) const
+{
+    return Evaluate(event).at(GetIndex(weight_type, unc_source, unc_scale));
+}
+
+double EventWeightsCache::GetTotalWeight(EventInfo& event, const WeightingMode& weightingMode,
+                                         UncertaintySource unc_source, UncertaintyScale unc_scale) const
+{
+    const auto& weights = Evaluate(event);
+    double weight = 1.;
+    for(WeightType weight_type : weightingMode)
+        weight *= weights.at(GetIndex(weight_type, unc_source, unc_scale));
+    return weight;
+}
+
+const EventWeightsCache::EvaluatorEntry& EventWeightsCache::GetEvaluator(WeightType weight_type)
+{
+    auto iter = evaluators.find(weight_type);
+    if(iter == evaluators.end())
+        iter = evaluators.emplace(weight_type, CreateDefaultEvaluator(weight_type)).first;
+    return iter->second;
+}
+
+EventWeightsCache::EvaluatorEntry EventWeightsCache::CreateDefaultEvaluator(WeightType weight_type) const
+{
+    // Providers are resolved and casted only once here, so that the per-event evaluation is a direct call.
+    if(weight_type == WeightType::LeptonTrigIdIso)
+        throw exception("EventWeightsCache: evaluator for %1% weight requires working points and should be"
+                        " provided through SetEvaluator.") % weight_type;
+
+    auto provider = eventWeights.GetProvider(weight_type);
+    if(weight_type == WeightType::PileUp) {
+        auto pu_provider = std::dynamic_pointer_cast<PileUpWeightEx>(provider);
+        if(pu_provider) {
+            const auto evaluator = [pu_provider](EventInfo& event, UncertaintySource unc_source,
+                                                 UncertaintyScale unc_scale) {
+                return pu_provider->Get(event, unc_source == UncertaintySource::PileUp
+                                               ? unc_scale : UncertaintyScale::Central);
+            };
+            return EvaluatorEntry{evaluator, { UncertaintySource::PileUp }, MultiEvaluator()};
+        }
+    } else if(weight_type == WeightType::BTag) {
+        auto btag_provider = eventWeights.GetProviderT<BTagWeight>(weight_type);
+        const auto evaluator = [btag_provider](EventInfo& event, UncertaintySource unc_source,
+                                               UncertaintyScale unc_scale) {
+            return btag_provider->Get(event, btag_provider->GetDefaultWorkingPoint(), unc_source, unc_scale);
+        };
+        // All variations are taken from a single GetAll call per event.
+        const auto multi_evaluator = [btag_provider](EventInfo& event, const std::vector<WeightVariation>& variations,
+                                                     std::vector<double>& weights) {
+            const BTagWeightResults results = btag_provider->GetAll(event);
+            const DiscriminatorWP wp = btag_provider->GetDefaultWorkingPoint();
+            weights.resize(variations.size());
+            for(size_t n = 0; n < variations.size(); ++n)
+                weights[n] = results.Get(wp, variations[n].unc_source, variations[n].unc_scale);
+        };
+        return EvaluatorEntry{evaluator, { UncertaintySource::Eff_b }, multi_evaluator};
+    } else if(weight_type == WeightType::JetPuIdWeights) {
+        auto pu_id_provider = eventWeights.GetProviderT<JetPuIdWeights>(weight_type);
+        const auto evaluator = [pu_id_provider](EventInfo& event, UncertaintySource unc_source,
+                                                UncertaintyScale unc_scale) {
+            return pu_id_provider->GetWeight(event, unc_source, unc_scale);
+        };
+        return EvaluatorEntry{evaluator, { UncertaintySource::PileUpJetId_eff, UncertaintySource::PileUpJetId_mistag },
+                              MultiEvaluator()};
+    }
+
+    const auto evaluator = [provider](EventInfo& event, UncertaintySource, UncertaintyScale) {
+        return provider->Get(event);
+    };
+    return EvaluatorEntry{evaluator, {}, MultiEvaluator()};
+}
+
+WeightVariation EventWeightsCache::GetCanonicalVariation(const WeightVariation& variation,
+                                                         const EvaluatorEntry& entry)
+{
+    if(variation.unc_scale == UncertaintyScale::Central || !entry.affecting_sources.count(variation.unc_source))
+        return WeightVariation(variation.weight_type);
+    return variation;
+}
+
+} // namespace mc_corrections
+} // namespace analysis
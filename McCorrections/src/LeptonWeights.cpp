@@ -87,6 +87,13 @@ MuonScaleFactorPOG::HistPtr MuonScaleFactorPOG::LoadWeight(const std::string& we
     return HistPtr(root_ext::ReadCloneObject<Hist>(*file, hist_name, "", true));
 }
 
+bool TauSFCacheKey::operator<(const TauSFCacheKey& other) const
+{
+    return std::tie(kind, wp, channel, decay_mode, gen_match, scale, pt, eta)
+            < std::tie(other.kind, other.wp, other.channel, other.decay_mode, other.gen_match, other.scale,
+                       other.pt, other.eta);
+}
+
 } // namespace detail
 
 LeptonWeights::LeptonWeights(const std::string& electron_idIsoInput, const std::string& electron_SingletriggerInput,
@@ -152,28 +159,41 @@ double LeptonWeights::GetLegIdIsoWeight(LepCandidate leg, DiscriminatorWP VSe_wp
 
         const std::string scale = current_scale == UncertaintyScale::Central ? "" : ToString(current_scale);
         const int gen_match = static_cast<int>(leg->gen_match());
+        const double pt = leg.GetMomentum().pt();
+        const double abs_eta = std::abs(leg.GetMomentum().eta());
+        const int decay_mode = leg->decayMode();
+
+        const auto makeKey = [&](detail::TauSFKind kind, DiscriminatorWP wp, UncertaintyScale key_scale) {
+            return detail::TauSFCacheKey{kind, wp, -1, decay_mode, gen_match, static_cast<int>(key_scale), pt,
+                                         abs_eta};
+        };
 
         if(leg->gen_match() == GenLeptonMatch::Electron || leg->gen_match() == GenLeptonMatch::TauElectron) {
-            const auto& tauIdWeightVsEle = GetTauIdProvider(TauIdDiscriminator::byDeepTau2017v2p1VSe, VSe_wp);
-            tau_id_weight_vs_ele = tauIdWeightVsEle.getSFvsEta(std::abs(leg.GetMomentum().eta()), gen_match, scale);
+            tau_id_weight_vs_ele = GetCachedTauSF(makeKey(detail::TauSFKind::IdVSe, VSe_wp, current_scale), [&]() {
+                const auto& tauIdWeightVsEle = GetTauIdProvider(TauIdDiscriminator::byDeepTau2017v2p1VSe, VSe_wp);
+                return tauIdWeightVsEle.getSFvsEta(abs_eta, gen_match, scale);
+            });
         } else if(leg->gen_match() == GenLeptonMatch::Muon || leg->gen_match() == GenLeptonMatch::TauMuon) {
-            const auto& tauIdWeightVsMu = GetTauIdProvider(TauIdDiscriminator::byDeepTau2017v2p1VSmu, VSmu_wp);
-            tau_id_weight_vs_mu = tauIdWeightVsMu.getSFvsEta(std::abs(leg.GetMomentum().eta()), gen_match, scale);
+            tau_id_weight_vs_mu = GetCachedTauSF(makeKey(detail::TauSFKind::IdVSmu, VSmu_wp, current_scale), [&]() {
+                const auto& tauIdWeightVsMu = GetTauIdProvider(TauIdDiscriminator::byDeepTau2017v2p1VSmu, VSmu_wp);
+                return tauIdWeightVsMu.getSFvsEta(abs_eta, gen_match, scale);
+            });
         } else if(leg->gen_match() == GenLeptonMatch::Tau) {
-            auto& tauIdWeight = GetTauIdProvider(TauIdDiscriminator::byDeepTau2017v2p1VSjet, VSjet_wp);
-
-            const auto getTauSF = [&](const std::string& scale_str) {
-                return is_dm_binned ? tauIdWeight.getSFvsDM(leg.GetMomentum().pt(), leg->decayMode(),
-                                                            gen_match, scale_str)
-                                    : tauIdWeight.getSFvsPT(leg.GetMomentum().pt(), gen_match, scale_str);
+            const auto getTauSF = [&](UncertaintyScale sf_scale) {
+                return GetCachedTauSF(makeKey(detail::TauSFKind::IdVSjet, VSjet_wp, sf_scale), [&]() {
+                    auto& tauIdWeight = GetTauIdProvider(TauIdDiscriminator::byDeepTau2017v2p1VSjet, VSjet_wp);
+                    const std::string scale_str = sf_scale == UncertaintyScale::Central ? "" : ToString(sf_scale);
+                    return is_dm_binned ? tauIdWeight.getSFvsDM(pt, decay_mode, gen_match, scale_str)
+                                        : tauIdWeight.getSFvsPT(pt, gen_match, scale_str);
+                });
             };
 
-            tau_id_weight = getTauSF(scale);
+            tau_id_weight = getTauSF(current_scale);
             if(current_scale != UncertaintyScale::Central
                     && (VSe_wp < DiscriminatorWP::VLoose || VSmu_wp < DiscriminatorWP::Tight)) {
-                const double tau_id_weight_central = getTauSF("");
+                const double tau_id_weight_central = getTauSF(UncertaintyScale::Central);
                 const double err = std::abs(tau_id_weight_central - tau_id_weight);
-                const double rel_err = leg.GetMomentum().pt() < 100 ? 0.03 : 0.15;
+                const double rel_err = pt < 100 ? 0.03 : 0.15;
                 tau_id_weight = tau_id_weight_central + static_cast<int>(current_scale)
                                 * (err + rel_err * tau_id_weight_central);
             }
@@ -362,7 +382,6 @@ double LeptonWeights::GetTriggerEfficiency(EventInfo& eventInfo, bool isData, Di
         if(pt_iter == tau_min_pt.end() || pt <= pt_iter->second) return 0.f;
         if(vbf && !eventInfo.HasVBFjetPair()) return 0.f;
         if(vbf) return 1.f; // TODO
-        const auto& sf_provider = GetTauTriggerSFProvider(channel, VSjet_wp);
         UncertaintyScale current_scale = UncertaintyScale::Central;
         auto iter = tau_dm_unc.find(unc_source);
         if(iter != tau_dm_unc.end() && (iter->second < 0 || dm == iter->second))
@@ -370,7 +389,12 @@ double LeptonWeights::GetTriggerEfficiency(EventInfo& eventInfo, bool isData, Di
         if(current_scale != UncertaintyScale::Central)
             same_as_central = false;
         const int scale = static_cast<int>(current_scale);
-        return isData ? sf_provider.getEfficiencyData(pt, dm, scale) : sf_provider.getEfficiencyMC(pt, dm, scale);
+        const detail::TauSFCacheKey key{isData ? detail::TauSFKind::TriggerData : detail::TauSFKind::TriggerMC,
+                                        VSjet_wp, static_cast<int>(channel), dm, 0, scale, pt, 0.};
+        return static_cast<float>(GetCachedTauSF(key, [&]() {
+            const auto& sf_provider = GetTauTriggerSFProvider(channel, VSjet_wp);
+            return isData ? sf_provider.getEfficiencyData(pt, dm, scale) : sf_provider.getEfficiencyMC(pt, dm, scale);
+        }));
     };
 
     double efficiency = 0;
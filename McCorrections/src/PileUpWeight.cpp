@@ -4,12 +4,29 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 #include "h-tautau/McCorrections/include/PileUpWeight.h"
 
 #include <fstream>
+#include <iomanip>
 #include "AnalysisTools/Core/include/RootExt.h"
 #include "AnalysisTools/Core/include/TextIO.h"
+#include "h-tautau/Core/include/FileId.h"
 
 namespace analysis {
 namespace mc_corrections {
 
+namespace {
+const std::string table_header = "pileup_weights_table v2";
+
+void ReadSourceIds(std::istream& in, std::vector<PileUpWeightEx::SourceId>& source_ids)
+{
+    size_t n_sources;
+    in >> n_sources;
+    for(size_t n = 0; n < n_sources && in.good(); ++n) {
+        PileUpWeightEx::SourceId id;
+        in >> id.first >> id.second;
+        source_ids.push_back(id);
+    }
+}
+}
+
 PileUpWeight::PileUpWeight(const std::string& pu_reweight_file_name, const std::string& hist_name,
                            double _max_available_pu, double _default_pu_weight) :
     max_available_pu(_max_available_pu), default_pu_weight(_default_pu_weight),
@@ -38,17 +55,60 @@ double PileUpWeight::Get(double nPU) const
     return goodBin ? pu_weights->GetBinContent(bin) : default_pu_weight;
 }
 
+PileUpWeightEntry::PileUpWeightEntry(double value) : central(value), up(value), down(value) {}
+
+double PileUpWeightEntry::Get(UncertaintyScale unc_scale) const
+{
+    if(unc_scale == UncertaintyScale::Central) return central;
+    if(unc_scale == UncertaintyScale::Up) return up;
+    if(unc_scale == UncertaintyScale::Down) return down;
+    throw exception("PileUpWeightEntry: unsupported uncertainty scale %1%.") % unc_scale;
+}
+
 PileUpWeightEx::PileUpWeightEx(const std::string& pu_data_file_name, const std::string& pu_data_file_up_name,
                                const std::string& pu_data_file_down_name, const std::string& pu_mc_file_name,
                                const std::string& cfg_file_name, double _max_available_pu,
                                double _default_pu_weight) :
-    max_available_pu(_max_available_pu), default_pu_weight(_default_pu_weight)
+    max_available_pu(_max_available_pu), default_entry(_default_pu_weight), n_bins(0), max_bin(0), x_min(0),
+    x_max(0)
 {
+    std::map<UncertaintyScale, std::string> data_files;
     data_files[UncertaintyScale::Central] = pu_data_file_name;
     data_files[UncertaintyScale::Up] = pu_data_file_up_name;
     data_files[UncertaintyScale::Down] = pu_data_file_down_name;
 
-    LoadPUWeights(pu_mc_file_name, cfg_file_name);
+    LoadPUWeights(data_files, pu_mc_file_name, cfg_file_name);
+    for(const std::string& file_name : { pu_data_file_name, pu_data_file_up_name, pu_data_file_down_name,
+                                         pu_mc_file_name, cfg_file_name })
+        source_ids.push_back(GetSourceId(file_name));
+}
+
+PileUpWeightEx::PileUpWeightEx(const std::string& table_file_name, double _default_pu_weight) :
+    max_available_pu(0), default_entry(_default_pu_weight), n_bins(0), max_bin(0), x_min(0), x_max(0)
+{
+    LoadTable(table_file_name);
+}
+
+bool PileUpWeightEx::IsTableUpToDate(const std::string& table_file_name, const std::vector<std::string>& source_files,
+                                     double max_available_pu)
+{
+    std::ifstream in(table_file_name);
+    if(in.fail()) return false;
+    std::string header;
+    std::getline(in, header);
+    if(header != table_header) return false;
+    std::vector<SourceId> table_source_ids;
+    ReadSourceIds(in, table_source_ids);
+    int n_bins, max_bin;
+    double x_min, x_max, table_max_available_pu;
+    in >> n_bins >> x_min >> x_max >> max_bin >> table_max_available_pu;
+    if(in.fail() || table_source_ids.size() != source_files.size() || table_max_available_pu != max_available_pu)
+        return false;
+    for(size_t n = 0; n < source_files.size(); ++n) {
+        if(GetSourceId(source_files.at(n)) != table_source_ids.at(n))
+            return false;
+    }
+    return true;
 }
 
 void PileUpWeightEx::SetActiveDataset(const std::string& active_dataset)
@@ -60,7 +120,8 @@ void PileUpWeightEx::SetActiveDataset(const std::string& active_dataset)
     active_group = datasets.at(active_dataset_full_name);
 }
 
-void PileUpWeightEx::LoadPUWeights(const std::string& pu_mc_file_name, const std::string& cfg_file_name)
+void PileUpWeightEx::LoadPUWeights(const std::map<UncertaintyScale, std::string>& data_files,
+                                   const std::string& pu_mc_file_name, const std::string& cfg_file_name)
 {
     auto mc_pileup_file = root_ext::OpenRootFile(pu_mc_file_name);
 
@@ -74,14 +135,17 @@ void PileUpWeightEx::LoadPUWeights(const std::string& pu_mc_file_name, const std
         if(!line.empty())
             lines.push_back(line);
     }
+    if(lines.empty())
+        throw exception("No dataset groups are defined in '%1%'.") % cfg_file_name;
 
+    std::map<UncertaintyScale, std::vector<HistPtr>> pu_weights_map;
     for(const auto& [unc_scale, data_file] : data_files) {
         auto data_pileup_file = root_ext::OpenRootFile(data_file);
         auto pu_data = std::shared_ptr<TH1D>(root_ext::ReadObject<TH1D>(*data_pileup_file, "pileup"));
         auto data_norm = std::shared_ptr<TH1D>(root_ext::CloneObject(*pu_data));
-        const int max_bin = pu_data->FindBin(max_available_pu);
+        const int max_data_bin = pu_data->FindBin(max_available_pu);
 
-        for(int i = max_bin + 1; i <= pu_data->GetNbinsX(); ++i){
+        for(int i = max_data_bin + 1; i <= pu_data->GetNbinsX(); ++i){
             data_norm->SetBinContent(i,0);
             data_norm->SetBinError(i,0);
         }
@@ -103,7 +167,7 @@ void PileUpWeightEx::LoadPUWeights(const std::string& pu_mc_file_name, const std
                 pu_mc->Add(&(*hist), 1);
             }
             auto mc_norm = std::shared_ptr<TH1D>(root_ext::CloneObject(*pu_mc));
-            for(int i = max_bin + 1; i <= pu_data->GetNbinsX(); ++i){
+            for(int i = max_data_bin + 1; i <= pu_data->GetNbinsX(); ++i){
                 mc_norm->SetBinContent(i,0);
                 mc_norm->SetBinError(i,0);
             }
@@ -115,30 +179,147 @@ void PileUpWeightEx::LoadPUWeights(const std::string& pu_mc_file_name, const std
         }
         pu_weights_map[unc_scale] = pu_weights;
     }
+
+    // Materialize weights into dense per-group tables indexed by the nPU bin.
+    const Hist& ref_hist = *pu_weights_map.at(UncertaintyScale::Central).at(0);
+    if(ref_hist.GetXaxis()->IsVariableBinSize())
+        throw exception("PileUpWeightEx: variable bin size of the pileup distributions is not supported.");
+    n_bins = ref_hist.GetNbinsX();
+    x_min = ref_hist.GetXaxis()->GetXmin();
+    x_max = ref_hist.GetXaxis()->GetXmax();
+    max_bin = ref_hist.FindBin(max_available_pu);
+
+    for(const auto& [unc_scale, pu_weights] : pu_weights_map) {
+        for(const auto& hist : pu_weights) {
+            if(hist->GetNbinsX() != n_bins || hist->GetXaxis()->GetXmin() != x_min
+                    || hist->GetXaxis()->GetXmax() != x_max)
+                throw exception("PileUpWeightEx: inconsistent binning of the pileup distributions for %1% scale.")
+                    % unc_scale;
+        }
+    }
+
+    weight_tables.resize(lines.size());
+    for(size_t id = 0; id < lines.size(); ++id) {
+        const Hist& w_central = *pu_weights_map.at(UncertaintyScale::Central).at(id);
+        const Hist& w_up = *pu_weights_map.at(UncertaintyScale::Up).at(id);
+        const Hist& w_down = *pu_weights_map.at(UncertaintyScale::Down).at(id);
+        WeightTable& table = weight_tables.at(id);
+        table.resize(static_cast<size_t>(std::max(max_bin, 0)));
+        for(int bin = 1; bin <= max_bin; ++bin) {
+            PileUpWeightEntry& entry = table.at(static_cast<size_t>(bin - 1));
+            entry.central = w_central.GetBinContent(bin);
+            entry.up = w_up.GetBinContent(bin);
+            entry.down = w_down.GetBinContent(bin);
+        }
+    }
 }
 
-double PileUpWeightEx::Get(EventInfo& eventInfo) const
+void PileUpWeightEx::SaveTable(const std::string& table_file_name) const
 {
-    return Get(eventInfo->npu);
+    std::ofstream out(table_file_name);
+    if(out.fail())
+        throw exception("Failed to create pileup weight table '%1%'.") % table_file_name;
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << table_header << "\n";
+    out << source_ids.size();
+    for(const auto& [size, hash] : source_ids)
+        out << " " << size << " " << hash;
+    out << "\n";
+    out << n_bins << " " << x_min << " " << x_max << " " << max_bin << " " << max_available_pu << "\n";
+    out << datasets.size() << "\n";
+    for(const auto& [name, group] : datasets)
+        out << name << " " << group << "\n";
+    out << weight_tables.size() << "\n";
+    for(const auto& table : weight_tables) {
+        for(const auto& entry : table)
+            out << entry.central << " " << entry.up << " " << entry.down << "\n";
+    }
+    if(out.fail())
+        throw exception("Failed to write pileup weight table '%1%'.") % table_file_name;
+}
+
+void PileUpWeightEx::LoadTable(const std::string& table_file_name)
+{
+    std::ifstream in(table_file_name);
+    if(in.fail())
+        throw exception("Failed to open pileup weight table '%1%'.") % table_file_name;
+    std::string header;
+    std::getline(in, header);
+    if(header != table_header)
+        throw exception("Unsupported format of the pileup weight table '%1%'.") % table_file_name;
+
+    ReadSourceIds(in, source_ids);
+    size_t n_datasets, n_groups;
+    in >> n_bins >> x_min >> x_max >> max_bin >> max_available_pu >> n_datasets;
+    for(size_t n = 0; n < n_datasets && in.good(); ++n) {
+        std::string name;
+        size_t group;
+        in >> name >> group;
+        datasets[name] = group;
+    }
+    in >> n_groups;
+    if(in.fail() || n_bins <= 0 || !(x_max > x_min) || max_bin < 0 || max_bin > n_bins + 1)
+        throw exception("Invalid pileup weight table '%1%'.") % table_file_name;
+    weight_tables.resize(n_groups);
+    for(auto& table : weight_tables) {
+        table.resize(static_cast<size_t>(max_bin));
+        for(auto& entry : table)
+            in >> entry.central >> entry.up >> entry.down;
+    }
+    if(in.fail())
+        throw exception("Pileup weight table '%1%' is truncated.") % table_file_name;
+    for(const auto& [name, group] : datasets) {
+        if(group >= weight_tables.size())
+            throw exception("Invalid group index for dataset '%1%' in pileup weight table '%2%'.")
+                % name % table_file_name;
+    }
 }
-double PileUpWeightEx::Get(const ntuple::ExpressEvent& event) const { return Get(event.npu); }
 
-double PileUpWeightEx::Get(const ntuple::ExpressEvent& event, UncertaintyScale unc_scale) const { return Get(event.npu, unc_scale); }
+// Same file id as in the binary cache of the JEC parameters: the size and a 64-bit FNV-1a hash of the content.
+PileUpWeightEx::SourceId PileUpWeightEx::GetSourceId(const std::string& file_name)
+{
+    SourceId id;
+    if(!GetFileId(file_name, id.first, id.second))
+        throw exception("Failed to open pileup source file '%1%'.") % file_name;
+    return id;
+}
 
-double PileUpWeightEx::Get(double nPU, UncertaintyScale unc_scale) const
+const PileUpWeightEntry& PileUpWeightEx::FindEntry(double nPU) const
 {
     if(!active_group.is_initialized())
          throw exception("active group isn't initialized");
-    auto w_hist = pu_weights_map.at(unc_scale).at(*active_group);
-    const Int_t bin = w_hist->FindBin(nPU);
-    const Int_t maxBin = w_hist->FindBin(max_available_pu);
-    const bool goodBin = bin >= 1 && bin <= maxBin;
-    return goodBin ? w_hist->GetBinContent(bin) : default_pu_weight;
+    // Same bin definition as TAxis::FindBin for a fixed-width binning.
+    int bin;
+    if(nPU < x_min)
+        bin = 0;
+    else if(!(nPU < x_max))
+        bin = n_bins + 1;
+    else
+        bin = 1 + static_cast<int>(n_bins * (nPU - x_min) / (x_max - x_min));
+    const bool goodBin = bin >= 1 && bin <= max_bin;
+    return goodBin ? weight_tables[*active_group][static_cast<size_t>(bin - 1)] : default_entry;
+}
+
+double PileUpWeightEx::Get(EventInfo& eventInfo) const
+{
+    return FindEntry(eventInfo->npu).central;
+}
+double PileUpWeightEx::Get(const ntuple::ExpressEvent& event) const { return FindEntry(event.npu).central; }
+
+double PileUpWeightEx::Get(const ntuple::ExpressEvent& event, UncertaintyScale unc_scale) const
+{
+    return FindEntry(event.npu).Get(unc_scale);
 }
 
 double PileUpWeightEx::Get(EventInfo& eventInfo, UncertaintyScale unc_scale) const
 {
-    return Get(eventInfo->npu, unc_scale);
+    return FindEntry(eventInfo->npu).Get(unc_scale);
+}
+
+const PileUpWeightEntry& PileUpWeightEx::GetAll(EventInfo& eventInfo) const { return FindEntry(eventInfo->npu); }
+const PileUpWeightEntry& PileUpWeightEx::GetAll(const ntuple::ExpressEvent& event) const
+{
+    return FindEntry(event.npu);
 }
 
 } // namespace mc_corrections
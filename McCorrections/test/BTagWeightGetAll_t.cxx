@@ -0,0 +1,81 @@
+/*! Check that the b tag weights for all working points and scales from BTagWeight::GetAll are identical to Get.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "h-tautau/Analysis/include/EventInfo.h"
+#include "h-tautau/Analysis/include/SignalObjectSelector.h"
+#include "h-tautau/McCorrections/include/BTagWeight.h"
+#include "h-tautau/McCorrections/include/EventWeights.h"
+
+struct Arguments {
+    run::Argument<std::string> input_file{"input_file", "EventTuple file with MC events"};
+    run::Argument<analysis::Channel> channel{"channel", "channel", analysis::Channel::TauTau};
+    run::Argument<analysis::Period> period{"period", "period", analysis::Period::Run2018};
+    run::Argument<analysis::BTaggerKind> btagger{"btagger", "b tagger", analysis::BTaggerKind::DeepFlavour};
+    run::Argument<analysis::SignalMode> mode{"mode", "signal mode", analysis::SignalMode::HH};
+    run::Argument<Long64_t> max_events{"max_events", "maximal number of events to check", 1000};
+};
+
+namespace analysis {
+
+class BTagWeightGetAll_t {
+public:
+    using EventWeights = mc_corrections::EventWeights;
+    using BTagWeight = mc_corrections::BTagWeight;
+
+    BTagWeightGetAll_t(const Arguments& _args) :
+        args(_args), signalObjectSelector(args.mode()), bTagger(args.period(), args.btagger()),
+        eventWeights(args.period(), bTagger, { mc_corrections::WeightType::BTag })
+    {
+    }
+
+    void Run()
+    {
+        static const std::vector<DiscriminatorWP> working_points = {
+            DiscriminatorWP::Loose, DiscriminatorWP::Medium, DiscriminatorWP::Tight
+        };
+        static const std::vector<UncertaintyScale> unc_scales = {
+            UncertaintyScale::Central, UncertaintyScale::Up, UncertaintyScale::Down
+        };
+
+        const auto bTagWeight = eventWeights.GetProviderT<BTagWeight>(mc_corrections::WeightType::BTag);
+        auto file = root_ext::OpenRootFile(args.input_file());
+        auto tuple = ntuple::CreateEventTuple(ToString(args.channel()), file.get(), true, ntuple::TreeState::Full);
+        size_t n_events = 0;
+        const Long64_t n_entries = std::min(tuple->GetEntries(), args.max_events());
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            tuple->GetEntry(entry);
+            auto event_info = EventInfo::Create(tuple->data(), signalObjectSelector, bTagger,
+                                                DiscriminatorWP::Medium);
+            if(!event_info) continue;
+            const auto all_weights = bTagWeight->GetAll(*event_info);
+            for(DiscriminatorWP wp : working_points) {
+                if(all_weights.Get(wp) != bTagWeight->Get(*event_info, wp))
+                    throw exception("Entry %1%: different central weights for %2% working point.") % entry % wp;
+                for(UncertaintyScale unc_scale : unc_scales) {
+                    const double weight = all_weights.Get(wp, UncertaintySource::Eff_b, unc_scale);
+                    const double ref_weight = bTagWeight->Get(*event_info, wp, UncertaintySource::Eff_b, unc_scale);
+                    if(weight != ref_weight)
+                        throw exception("Entry %1%: GetAll = %2% and Get = %3% for %4% working point and %5% scale.")
+                            % entry % weight % ref_weight % wp % unc_scale;
+                }
+            }
+            ++n_events;
+        }
+
+        if(!n_events)
+            throw exception("No events are selected in '%1%'.") % args.input_file();
+        std::cout << "BTagWeight: GetAll is identical to Get for " << n_events << " events." << std::endl;
+    }
+
+private:
+    Arguments args;
+    SignalObjectSelector signalObjectSelector;
+    BTagger bTagger;
+    EventWeights eventWeights;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::BTagWeightGetAll_t, Arguments)
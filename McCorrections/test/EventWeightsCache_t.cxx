@@ -0,0 +1,127 @@
+/*! Check that the weights cached in EventInfo are evaluated once and never shared between EventWeightsCache instances.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "h-tautau/Analysis/include/EventInfo.h"
+#include "h-tautau/Analysis/include/SignalObjectSelector.h"
+#include "h-tautau/McCorrections/include/EventWeightsCache.h"
+
+struct Arguments {
+    run::Argument<std::string> input_file{"input_file", "EventTuple file, e.g. produced by SyntheticTupleGenerator"};
+    run::Argument<analysis::Channel> channel{"channel", "channel", analysis::Channel::TauTau};
+    run::Argument<analysis::SignalMode> mode{"mode", "signal mode", analysis::SignalMode::HH};
+    run::Argument<Long64_t> max_events{"max_events", "maximal number of events to check", 1000};
+};
+
+namespace analysis {
+
+class EventWeightsCache_t {
+public:
+    using EventWeights = mc_corrections::EventWeights;
+    using EventWeightsCache = mc_corrections::EventWeightsCache;
+    using WeightType = mc_corrections::WeightType;
+
+    EventWeightsCache_t(const Arguments& _args) :
+        args(_args), signalObjectSelector(args.mode()), bTagger(Period::Run2018, BTaggerKind::DeepFlavour),
+        eventWeights(Period::Run2018, bTagger, { WeightType::GenEventWeight })
+    {
+    }
+
+    void Run()
+    {
+        // Two caches with different variation sets, so the same index refers to different weights.
+        EventWeightsCache cache_a(eventWeights), cache_b(eventWeights);
+        size_t n_calls_a = 0, n_calls_b = 0;
+        cache_a.SetEvaluator(WeightType::TopPt, CreateEvaluator(1., n_calls_a), { UncertaintySource::TopPt });
+        cache_b.SetEvaluator(WeightType::TopPt, CreateEvaluator(10., n_calls_b), { UncertaintySource::TopPt });
+        cache_b.SetEvaluator(WeightType::DY, CreateEvaluator(100., n_calls_b), {});
+
+        const size_t a_central = cache_a.AddVariation(WeightType::TopPt);
+        const size_t a_up = cache_a.AddVariation(WeightType::TopPt, UncertaintySource::TopPt, UncertaintyScale::Up);
+        const size_t a_gen = cache_a.AddVariation(WeightType::GenEventWeight);
+        const size_t b_dy = cache_b.AddVariation(WeightType::DY);
+        const size_t b_down = cache_b.AddVariation(WeightType::TopPt, UncertaintySource::TopPt,
+                                                   UncertaintyScale::Down);
+        // Variations of the sources that do not affect the weight are aliased to the central value.
+        if(cache_a.AddVariation(WeightType::TopPt, UncertaintySource::PileUp, UncertaintyScale::Up) != a_central)
+            throw exception("Variation of a not affecting source is not aliased to the central value.");
+        if(cache_a.GetId() == cache_b.GetId())
+            throw exception("Two caches have the same id.");
+
+        auto file = root_ext::OpenRootFile(args.input_file());
+        auto tuple = ntuple::CreateEventTuple(ToString(args.channel()), file.get(), true, ntuple::TreeState::Full);
+        size_t n_events = 0;
+        const Long64_t n_entries = std::min(tuple->GetEntries(), args.max_events());
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            tuple->GetEntry(entry);
+            auto event_info = EventInfo::Create(tuple->data(), signalObjectSelector, bTagger,
+                                                DiscriminatorWP::Medium);
+            if(!event_info) continue;
+            EventInfo& event = *event_info;
+            const double gen_weight = eventWeights.GetWeight(event, WeightType::GenEventWeight);
+
+            const size_t n_calls_a_before = n_calls_a, n_calls_b_before = n_calls_b;
+            for(size_t n = 0; n < 2; ++n) {
+                Check(cache_a.Evaluate(event), { { a_central, 2. }, { a_up, 3. }, { a_gen, gen_weight } }, "a");
+                Check(cache_b.Evaluate(event), { { b_dy, 200. }, { b_down, 10. } }, "b");
+            }
+            if(n_calls_a - n_calls_a_before != 4 || n_calls_b - n_calls_b_before != 4)
+                throw exception("Entry %1%: weights are evaluated %2% and %3% times instead of 4.") % entry
+                    % (n_calls_a - n_calls_a_before) % (n_calls_b - n_calls_b_before);
+            if(cache_a.GetWeight(event, WeightType::TopPt, UncertaintySource::TopPt, UncertaintyScale::Up) != 3.)
+                throw exception("Entry %1%: wrong weight for the registered variation.") % entry;
+
+            // The weights stored by the cache are reused until another cache evaluates the event.
+            const size_t n_calls_a_cached = n_calls_a;
+            cache_a.Evaluate(event);
+            if(n_calls_a != n_calls_a_cached)
+                throw exception("Entry %1%: cached weights are not reused.") % entry;
+            ++n_events;
+        }
+
+        // Variations added after the evaluation extend the layout, so the stored weights are recomputed.
+        tuple->GetEntry(0);
+        auto event_info = EventInfo::Create(tuple->data(), signalObjectSelector, bTagger, DiscriminatorWP::Medium);
+        if(event_info) {
+            cache_a.Evaluate(*event_info);
+            const size_t a_down = cache_a.AddVariation(WeightType::TopPt, UncertaintySource::TopPt,
+                                                       UncertaintyScale::Down);
+            Check(cache_a.Evaluate(*event_info), { { a_central, 2. }, { a_up, 3. }, { a_down, 1. } }, "a");
+        }
+
+        if(!n_events)
+            throw exception("No events are selected in '%1%'.") % args.input_file();
+        std::cout << "EventWeightsCache: weights of two caches are consistent for " << n_events << " events."
+                  << std::endl;
+    }
+
+private:
+    // The weight is central_value * (2 + unc_scale), so all variations have different values.
+    static EventWeightsCache::Evaluator CreateEvaluator(double central_value, size_t& n_calls)
+    {
+        return [central_value, &n_calls](EventInfo&, UncertaintySource, UncertaintyScale unc_scale) {
+            ++n_calls;
+            return central_value * (2 + static_cast<int>(unc_scale));
+        };
+    }
+
+    static void Check(const std::vector<double>& weights, const std::map<size_t, double>& expected,
+                      const std::string& cache_name)
+    {
+        for(const auto& [index, value] : expected) {
+            if(index >= weights.size() || weights.at(index) != value)
+                throw exception("Cache %1%: wrong weight at index %2%, expected %3%.") % cache_name % index % value;
+        }
+    }
+
+private:
+    Arguments args;
+    SignalObjectSelector signalObjectSelector;
+    BTagger bTagger;
+    EventWeights eventWeights;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::EventWeightsCache_t, Arguments)
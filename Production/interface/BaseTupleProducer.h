@@ -17,6 +17,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "AnalysisTools/Core/include/AnalyzerData.h"
 #include "h-tautau/Core/include/EventTuple.h"
+#include "h-tautau/Core/include/ReducedPrecision.h"
 #include "h-tautau/Cuts/include/eleID_Run2.h"
 
 #include "SelectionResults.h"
@@ -136,6 +137,7 @@ protected:
     const bool isMC, applyTriggerMatch, applyTriggerMatchCut, applyTriggerCut, storeLHEinfo;
     const int nJetsRecoilCorr;
     const bool saveGenTopInfo, saveGenBosonInfo, saveGenJetInfo, saveGenParticleInfo, isEmbedded;
+    const bool reducedGenPrecision;
     ntuple::EventTuple& eventTuple;
     analysis::TriggerTools triggerTools;
 
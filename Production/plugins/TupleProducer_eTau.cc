@@ -116,6 +116,8 @@ void TupleProducer_eTau::FillEventTuple(const SelectionResultsBase& selection)
     BaseTupleProducer::FillTau(selection);
     BaseTupleProducer::FillHiggsDaughtersIndexes(selection,selection.electrons.size());
 
+    if(reducedGenPrecision)
+        ntuple::ReduceEventPrecision(eventTuple());
     eventTuple.Fill();
 }
 
@@ -126,6 +126,8 @@ void TupleProducer_muMu::FillEventTuple(const SelectionResultsBase& selection)
     BaseTupleProducer::FillMuon(selection);
     BaseTupleProducer::FillHiggsDaughtersIndexes(selection,0);
 
+    if(reducedGenPrecision)
+        ntuple::ReduceEventPrecision(eventTuple());
     eventTuple.Fill();
 }
 
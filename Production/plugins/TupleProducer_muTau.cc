@@ -115,6 +115,8 @@ void TupleProducer_muTau::FillEventTuple(const SelectionResultsBase& selection)
     BaseTupleProducer::FillTau(selection);
     BaseTupleProducer::FillHiggsDaughtersIndexes(selection,selection.muons.size());
 
+    if(reducedGenPrecision)
+        ntuple::ReduceEventPrecision(eventTuple());
     eventTuple.Fill();
 }
 
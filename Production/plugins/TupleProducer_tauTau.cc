@@ -85,6 +85,8 @@ void TupleProducer_tauTau::FillEventTuple(const SelectionResultsBase& selection)
     BaseTupleProducer::FillTau(selection);
     BaseTupleProducer::FillHiggsDaughtersIndexes(selection,0);
 
+    if(reducedGenPrecision)
+        ntuple::ReduceEventPrecision(eventTuple());
     eventTuple.Fill();
 }
 
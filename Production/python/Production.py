@@ -39,6 +39,8 @@ options.register('saveGenJetInfo', True, VarParsing.multiplicity.singleton, VarP
                         "Save generator-level information for jets.")
 options.register('saveGenParticleInfo', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
                         "Save generator-level information for particles.")
+options.register('reducedGenPrecision', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
+                        "Store gen-level 4-momenta with reduced precision.")
 options.register('isEmbedded', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
                         "Is DY embedded sample.")
 options.register('dumpPython', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
@@ -344,6 +346,7 @@ for channel in channels:
         saveGenJetInfo          = cms.bool(options.saveGenJetInfo),
         saveGenParticleInfo     = cms.bool(options.saveGenParticleInfo),
         isEmbedded              = cms.bool(options.isEmbedded),
+        reducedGenPrecision     = cms.bool(options.reducedGenPrecision),
         rho                     = cms.InputTag('fixedGridRhoAll'),
         customMetFilters        = customMetFilters,
         updatedPileupJetIdDiscr = cms.InputTag('updatedPileupJetId', 'fullDiscriminant'),
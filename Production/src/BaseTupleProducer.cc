@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "h-tautau/Production/interface/BaseTupleProducer.h"
 
+#include <unordered_map>
 #include "AnalysisTools/Core/include/EventIdentifier.h"
 #include "h-tautau/Analysis/include/MetFilters.h"
 #include "h-tautau/Cuts/include/hh_bbtautau_Run2.h"
@@ -56,6 +57,7 @@ BaseTupleProducer::BaseTupleProducer(const edm::ParameterSet& cfg, analysis::Cha
     saveGenJetInfo(cfg.getParameter<bool>("saveGenJetInfo")),
     saveGenParticleInfo(cfg.getParameter<bool>("saveGenParticleInfo")),
     isEmbedded(cfg.getParameter<bool>("isEmbedded")),
+    reducedGenPrecision(cfg.getParameter<bool>("reducedGenPrecision")),
     eventTuple(TupleStore::GetTuple()),
     triggerTools(mayConsume<edm::TriggerResults>(edm::InputTag("TriggerResults", "", "SIM")),
                  mayConsume<edm::TriggerResults>(edm::InputTag("TriggerResults", "", "HLT")),
@@ -438,19 +440,20 @@ void BaseTupleProducer::FillGenJetInfo()
 
     if(!saveGenJetInfo) return;
 
+    // Flavour of the first reco jet matched to each gen jet.
+    std::unordered_map<const reco::GenJet*, int> gen_jet_flavours;
+    for(const JetCandidate& reco_jet : jets) {
+        if(reco_jet->genJet())
+            gen_jet_flavours.emplace(reco_jet->genJet(), reco_jet->hadronFlavour());
+    }
+
     for(const reco::GenJet& gen_jet : *genJets) {
         if(gen_jet.pt() <= pt_cut) continue;
         eventTuple().genJets_p4.push_back(ntuple::LorentzVectorE(gen_jet.p4()));
 
-        const auto findRecoJetFlavour = [&]() {
-            for(const JetCandidate& reco_jet : jets) {
-                if(reco_jet->genJet() == &gen_jet)
-                    return reco_jet->hadronFlavour();
-            }
-            return ntuple::DefaultFillValue<int>();
-        };
-
-        const auto flavour = findRecoJetFlavour();
+        const auto flavour_iter = gen_jet_flavours.find(&gen_jet);
+        const int flavour = flavour_iter != gen_jet_flavours.end() ? flavour_iter->second
+                                                                    : ntuple::DefaultFillValue<int>();
         eventTuple().genJets_hadronFlavour.push_back(flavour);
     }
 }
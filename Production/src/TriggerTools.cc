@@ -209,6 +209,22 @@ TriggerTools::VectorTriggerObjectSet TriggerTools::FindMatchingTriggerObjects(
     const double deltaR2 = std::pow(deltaR_Limit, 2);
     const auto& descriptor = triggerDescriptors->at(index);
 
+    // The L1 tau match depends only on the candidate, so it is evaluated at most once per call.
+    boost::optional<bool> l1_tau_match;
+    const auto hasL1TauMatch = [&]() {
+        if(!l1_tau_match.is_initialized()) {
+            static const double deltaR2_l1 = std::pow(0.5, 2);
+            const BXVector<l1t::Tau>& l1taus_elements = *l1Taus.product();
+            l1_tau_match = false;
+            for (unsigned k = 0; k < l1taus_elements.size(0) && !*l1_tau_match; ++k){
+                const l1t::Tau& l1tau = l1taus_elements.at(0,k);
+                l1_tau_match = l1tau.hwIso() > 0.5 && l1tau.et() > 32 &&
+                               ROOT::Math::VectorUtil::DeltaR2(l1tau.p4(), candidateMomentum) < deltaR2_l1;
+            }
+        }
+        return *l1_tau_match;
+    };
+
     for(size_t n = 0; n < legId_triggerObjPtr_vector.size(); ++n) {
         const auto& triggerObjectSet = legId_triggerObjPtr_vector.at(n);
         const TriggerDescriptorCollection::Leg& leg = descriptor.lepton_legs.at(n);
@@ -217,16 +233,7 @@ TriggerTools::VectorTriggerObjectSet TriggerTools::FindMatchingTriggerObjects(
             if(ROOT::Math::VectorUtil::DeltaR2(triggerObject->polarP4(), candidateMomentum) >= deltaR2) continue;
             if(leg.eta.is_initialized() && std::abs(candidateMomentum.Eta()) >= leg.eta ) continue;
             //if(candidateMomentum.Pt() <= leg.pt + deltaPt_map.at(leg.type)) continue;
-            static const double deltaR2_l1 = std::pow(0.5, 2);
-            bool found_l1_match = false;
-            if(leg.applyL1match){
-                const BXVector<l1t::Tau>& l1taus_elements = *l1Taus.product();
-                for (unsigned n = 0; n < l1taus_elements.size(0) && !found_l1_match; ++n){
-                    const l1t::Tau& l1tau = l1taus_elements.at(0,n);
-                    found_l1_match = l1tau.hwIso() > 0.5 && l1tau.et() > 32 && leg.type == analysis::LegType::tau &&
-                                     ROOT::Math::VectorUtil::DeltaR2(l1tau.p4(), candidateMomentum) < deltaR2_l1;
-                }
-            }
+            const bool found_l1_match = leg.applyL1match && leg.type == analysis::LegType::tau && hasL1TauMatch();
             if (!leg.applyL1match || found_l1_match) matched_legId_triggerObjectSet_vector.at(n).insert(triggerObject);
         }
     }